@@ -0,0 +1,202 @@
+//
+//  bench_helper.cc
+//  nth
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <utility>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include "bench_helper.h"
+
+// Every allocation is counted, so that benchmarks can report how many a
+// piece of work makes
+static std::atomic<size_t> allocationCount(0);
+
+void *operator new(size_t size) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+  free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+  free(p);
+}
+
+namespace bench {
+
+size_t allocations() {
+  return allocationCount.load(std::memory_order_relaxed);
+}
+
+static std::vector<std::pair<const char*, BenchmarkFunction>> &registry() {
+  static std::vector<std::pair<const char*, BenchmarkFunction>> benchmarks;
+  return benchmarks;
+}
+
+Registration::Registration(const char *name, BenchmarkFunction fn) {
+  registry().push_back(std::make_pair(name, fn));
+}
+
+void runBenchmarks(const std::string &filter) {
+  for (auto &benchmark : registry()) {
+    if (std::string(benchmark.first).find(filter) == std::string::npos) {
+      continue;
+    }
+    std::cout << "== " << benchmark.first << '\n';
+    benchmark.second();
+    std::cout << '\n';
+  }
+}
+
+double measure(std::function<void()> fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+long countCacheMisses(std::function<void()> fn) {
+#ifdef __linux__
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = PERF_COUNT_HW_CACHE_MISSES;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  int fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  if (fd >= 0) {
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    fn();
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    long long misses = 0;
+    bool counted = read(fd, &misses, sizeof(misses)) == sizeof(misses);
+    close(fd);
+    return counted ? (long)misses : -1;
+  }
+#endif
+  fn();
+  return -1;
+}
+
+Measurement measureIsolated(std::function<bool()> fn) {
+  Measurement m = { 0, 0, false };
+
+  int fds[2];
+  if (pipe(fds) < 0) return m;
+
+  std::cout.flush();
+  pid_t pid = fork();
+  if (pid < 0) return m;
+
+  if (pid == 0) {
+    close(fds[0]);
+    bool ok = true;
+    double seconds = measure([&]() { ok = fn(); });
+    ssize_t written = write(fds[1], &seconds, sizeof(seconds));
+    _exit(ok && written == sizeof(seconds) ? 0 : 1);
+  }
+
+  close(fds[1]);
+  double seconds = 0;
+  bool received = read(fds[0], &seconds, sizeof(seconds)) == sizeof(seconds);
+  close(fds[0]);
+
+  int status;
+  struct rusage usage;
+  if (wait4(pid, &status, 0, &usage) < 0) return m;
+
+  m.seconds = seconds;
+#ifdef __APPLE__
+  m.peakRSSKilobytes = usage.ru_maxrss / 1024; // reported in bytes
+#else
+  m.peakRSSKilobytes = usage.ru_maxrss;
+#endif
+  m.succeeded = received && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+  return m;
+}
+
+void report(const std::string &label, size_t bytes, const Measurement &m) {
+  std::cout << "  " << std::left << std::setw(36) << label << std::right;
+  if (!m.succeeded) {
+    std::cout << "FAILED\n";
+    return;
+  }
+  std::cout << std::fixed << std::setprecision(3)
+            << std::setw(9) << m.seconds * 1000 << " ms"
+            << std::setw(10) << std::setprecision(1)
+            << (bytes / m.seconds) / (1024 * 1024) << " MB/s";
+  if (m.peakRSSKilobytes) {
+    std::cout << std::setw(10) << m.peakRSSKilobytes / 1024 << " MB peak RSS";
+  }
+  std::cout << '\n';
+}
+
+double scale() {
+  const char *env = getenv("NTH_BENCH_SCALE");
+  double s = env ? atof(env) : 1.0;
+  return s > 0 ? s : 1.0;
+}
+
+std::string generateSource(size_t approximateBytes) {
+  std::stringstream ss;
+  for (int n = 0; ss.tellp() < static_cast<std::streamoff>(approximateBytes); ++n) {
+    ss << "// statement group " << n << "\n"
+       << "val alpha" << n << ": Int = " << n << " + " << n << " * 2\n"
+       << "def function" << n << "(x: Int, y: (Int, String)): Int {\n"
+       << "  x * " << n << " + y.0\n"
+       << "}\n"
+       << "/* a block\n   comment */\n"
+       << "[1, 2, " << n << ", 0x" << std::hex << n << std::dec << "]\n"
+       << "\"a string literal " << n << "\"\n"
+       << "{\"key" << n << "\": " << n << ".25}\n"
+       << "function" << n << "(alpha" << n << ", (1, \"two\"))\n";
+  }
+  return ss.str();
+}
+
+std::string writeTempFile(const std::string &contents) {
+  char path[] = "/tmp/nth-bench-XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    perror("mkstemp");
+    exit(EXIT_FAILURE);
+  }
+  size_t offset = 0;
+  while (offset < contents.size()) {
+    ssize_t n = write(fd, contents.data() + offset, contents.size() - offset);
+    if (n <= 0) {
+      perror("write");
+      exit(EXIT_FAILURE);
+    }
+    offset += n;
+  }
+  close(fd);
+  return path;
+}
+
+}
@@ -0,0 +1,64 @@
+//
+//  bench_helper.h
+//  nth
+//
+
+#ifndef __nth__bench_helper__
+#define __nth__bench_helper__
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+namespace bench {
+
+typedef void (*BenchmarkFunction)();
+
+struct Registration {
+  Registration(const char *name, BenchmarkFunction fn);
+};
+
+// Defines a benchmark which main() runs when its name matches the filter
+#define BENCHMARK(name) \
+  static void name(); \
+  static bench::Registration name##_registration(#name, name); \
+  static void name()
+
+void runBenchmarks(const std::string &filter);
+
+struct Measurement {
+  double seconds;
+  long peakRSSKilobytes;
+  bool succeeded;
+};
+
+// Runs fn in a child process so that its peak resident set size is not
+// polluted by earlier runs. fn returns false to report a failure.
+Measurement measureIsolated(std::function<bool()> fn);
+
+// Runs fn in this process and returns elapsed wall time in seconds
+double measure(std::function<void()> fn);
+
+// Cache misses counted by the CPU while fn runs, or -1 where the counter
+// can't be read, as on macOS and in many virtual machines
+long countCacheMisses(std::function<void()> fn);
+
+// Prints a row: label, time, throughput over bytes and peak RSS
+void report(const std::string &label, size_t bytes, const Measurement &m);
+
+// Calls to operator new so far in this process
+size_t allocations();
+
+// Scale factor for input sizes, taken from NTH_BENCH_SCALE (default 1)
+double scale();
+
+// Synthetic nth source of roughly the requested size built from
+// statements that cover most of the grammar
+std::string generateSource(size_t approximateBytes);
+
+// Writes contents to a new temporary file and returns its path
+std::string writeTempFile(const std::string &contents);
+
+}
+
+#endif /* defined(__nth__bench_helper__) */
@@ -0,0 +1,205 @@
+//
+//  flat_ast_bench.cc
+//  nth
+//
+//  Walking a parsed tree's pointer nodes with a Visitor, by a virtual call
+//  per node, and with a StaticVisitor, by a switch on its kind, against
+//  walking the same tree as a FlatAST; and telling expressions from the
+//  other nodes by RTTI, against by kind.
+//
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ast.h"
+#include "bench_helper.h"
+#include "driver.h"
+#include "flat_ast.h"
+#include "static_visitor.h"
+
+namespace {
+
+// What each walk works out, so that they can be checked against each other
+struct Tally {
+  long integers;
+  size_t identifiers;
+
+  bool operator==(const Tally &other) const {
+    return integers == other.integers && identifiers == other.identifiers;
+  }
+};
+
+class TallyVisitor : public nth::Visitor {
+ public:
+  TallyVisitor() : tally{0, 0} {}
+
+  void visit(nth::Integer *integer) { tally.integers += integer->getValue(); }
+  void visit(nth::Identifier *ident) { tally.identifiers++; }
+
+  Tally tally;
+};
+
+Tally walkPointers(nth::ASTNode *root) {
+  TallyVisitor visitor;
+  root->accept(visitor);
+  return visitor.tally;
+}
+
+class TallyStaticVisitor : public nth::StaticVisitor<TallyStaticVisitor> {
+ public:
+  TallyStaticVisitor() : tally{0, 0} {}
+
+  void visitInteger(nth::Integer *integer) { tally.integers += integer->getValue(); }
+  void visitIdentifier(nth::Identifier *ident) { tally.identifiers++; }
+
+  Tally tally;
+};
+
+// Gathers every node of a tree, in the order dispatch() comes to them
+class NodeCollector : public nth::StaticVisitor<NodeCollector> {
+ public:
+  void dispatch(nth::ASTNode *node) {
+    nodes.push_back(node);
+    StaticVisitor::dispatch(node);
+  }
+  std::vector<nth::ASTNode*> nodes;
+};
+
+Tally dispatchPointers(nth::ASTNode *root) {
+  TallyStaticVisitor visitor;
+  visitor.dispatch(root);
+  return visitor.tally;
+}
+
+// Every node in turn, as a pass that doesn't care about structure would
+Tally scanFlat(const nth::FlatAST &flat) {
+  Tally tally = { 0, 0 };
+  for (nth::FlatAST::Index node = 0; node < flat.size(); node++) {
+    switch (flat.getKind(node)) {
+      case nth::FlatAST::Kind::Integer: tally.integers += flat.getInteger(node); break;
+      case nth::FlatAST::Kind::Identifier: tally.identifiers++; break;
+      default: break;
+    }
+  }
+  return tally;
+}
+
+// Child by child, as a pass that does would
+void walkFlat(const nth::FlatAST &flat, nth::FlatAST::Index node, Tally &tally) {
+  switch (flat.getKind(node)) {
+    case nth::FlatAST::Kind::Integer: tally.integers += flat.getInteger(node); return;
+    case nth::FlatAST::Kind::Identifier: tally.identifiers++; return;
+    default: break;
+  }
+  for (auto child = node + 1; child < flat.getEnd(node); child = flat.getEnd(child)) {
+    walkFlat(flat, child, tally);
+  }
+}
+
+void reportWalk(const std::string &label, size_t bytes, int passes,
+                const Tally &expected, std::function<Tally()> walk) {
+  bool agreed = true;
+  bench::Measurement m;
+  long misses = 0;
+  m.seconds = bench::measure([&]() {
+    misses = bench::countCacheMisses([&]() {
+      for (int i = 0; i < passes; i++) agreed = walk() == expected && agreed;
+    });
+  });
+  m.peakRSSKilobytes = 0;
+  m.succeeded = agreed;
+  bench::report(label, bytes * passes, m);
+  if (misses >= 0) std::cout << "    " << misses << " cache misses\n";
+}
+
+}
+
+BENCHMARK(FlatTraversal) {
+  // A large parse walked several times over, each way. The parser's nodes
+  // come out of an ASTContext and are mostly in order; the same tree
+  // rebuilt on the heap stands in for one that has been edited and
+  // reallocated. Cache misses are counted where the CPU allows.
+  const int kPasses = 10;
+  std::string source = bench::generateSource(4 * 1024 * 1024 * bench::scale());
+
+  nth::Driver driver;
+  driver.should_use_simd_lexer = true;
+  if (driver.parseString(source) != 0) {
+    std::cout << "  parse failed\n";
+    return;
+  }
+  nth::ASTNode *parsed = driver.result;
+
+  nth::FlatAST *flat = nullptr;
+  bench::Measurement m;
+  m.seconds = bench::measure([&]() { flat = new nth::FlatAST(parsed); });
+  m.peakRSSKilobytes = 0;
+  m.succeeded = true;
+  bench::report("flatten", source.size(), m);
+  std::cout << "    " << flat->size() << " nodes\n";
+
+  nth::ASTNode *heap = flat->inflate();
+  Tally expected = walkPointers(parsed);
+
+  reportWalk("visitor, parsed nodes", source.size(), kPasses, expected,
+             [&]() { return walkPointers(parsed); });
+  reportWalk("visitor, heap nodes", source.size(), kPasses, expected,
+             [&]() { return walkPointers(heap); });
+  reportWalk("static visitor, parsed nodes", source.size(), kPasses, expected,
+             [&]() { return dispatchPointers(parsed); });
+  reportWalk("flat, in order", source.size(), kPasses, expected,
+             [&]() { return scanFlat(*flat); });
+  reportWalk("flat, child by child", source.size(), kPasses, expected,
+             [&]() {
+               Tally tally = { 0, 0 };
+               walkFlat(*flat, 0, tally);
+               return tally;
+             });
+
+  delete heap;
+  delete flat;
+  delete parsed;
+}
+
+BENCHMARK(KindTests) {
+  // Every node of a large parse asked whether it's an Expression, as the
+  // type checker asks of each statement in a block
+  const int kPasses = 20;
+  std::string source = bench::generateSource(4 * 1024 * 1024 * bench::scale());
+
+  nth::Driver driver;
+  driver.should_use_simd_lexer = true;
+  if (driver.parseString(source) != 0) {
+    std::cout << "  parse failed\n";
+    return;
+  }
+  NodeCollector collector;
+  collector.dispatch(driver.result);
+  const std::vector<nth::ASTNode*> &nodes = collector.nodes;
+
+  size_t byRTTI = 0, byKind = 0;
+  bench::Measurement m;
+  m.peakRSSKilobytes = 0;
+  m.seconds = bench::measure([&]() {
+    for (int i = 0; i < kPasses; i++) {
+      for (nth::ASTNode *node : nodes) {
+        if (dynamic_cast<nth::Expression*>(node)) byRTTI++;
+      }
+    }
+  });
+  m.succeeded = true;
+  bench::report("dynamic_cast", source.size() * kPasses, m);
+
+  m.seconds = bench::measure([&]() {
+    for (int i = 0; i < kPasses; i++) {
+      for (nth::ASTNode *node : nodes) {
+        if (nth::dyn_cast<nth::Expression>(node)) byKind++;
+      }
+    }
+  });
+  m.succeeded = byKind == byRTTI;
+  bench::report("dyn_cast", source.size() * kPasses, m);
+  std::cout << "    " << nodes.size() << " nodes\n";
+  delete driver.result;
+}
@@ -0,0 +1,90 @@
+//
+//  input_bench.cc
+//  nth
+//
+//  Compares the ways input reaches the scanner: stdio reads, a mapped
+//  file, caller-owned memory, a stream parsed a statement at a time, and
+//  the same input pushed to the parser as it's read.
+//
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+#include "bench_helper.h"
+#include "driver.h"
+
+BENCHMARK(InputPaths) {
+  size_t size;
+  std::string path;
+  {
+    // Don't keep the source around in this process: forked children would
+    // count its pages towards their own peak RSS.
+    std::string source = bench::generateSource(32 * 1024 * 1024 * bench::scale());
+    size = source.size();
+    path = bench::writeTempFile(source);
+  }
+
+  bench::report("parse() via stdio", size, bench::measureIsolated([&]() {
+    nth::Driver driver;
+    driver.should_map_input = false;
+    return driver.parse(path) == 0;
+  }));
+
+  bench::report("parse() via mmap", size, bench::measureIsolated([&]() {
+    nth::Driver driver;
+    return driver.parse(path) == 0;
+  }));
+
+  // Includes reading the file into memory, as any caller would have to
+  bench::report("parseBuffer() of caller memory", size, bench::measureIsolated([&]() {
+    std::ifstream in(path);
+    std::stringstream contents;
+    contents << in.rdbuf();
+    std::string buffer = contents.str();
+
+    nth::Driver driver;
+    return driver.parseBuffer(buffer.data(), buffer.size()) == 0;
+  }));
+
+  // Peak RSS should stay flat however large the input
+  for (int simd = 0; simd < 2; ++simd) {
+    std::string label = simd ? "parseStream() via Lexer" : "parseStream() via flex";
+    bench::report(label, size, bench::measureIsolated([&]() {
+      FILE *in = fopen(path.c_str(), "r");
+      if (!in) return false;
+
+      nth::Driver driver;
+      driver.should_use_simd_lexer = simd;
+      size_t statements = 0;
+      int ret = driver.parseStream(in, [&](nth::ASTNode *) { ++statements; });
+      fclose(in);
+      return ret == 0 && statements > 0;
+    }));
+  }
+
+  // The caller reads and hands over each chunk, as an event loop would
+  for (int simd = 0; simd < 2; ++simd) {
+    std::string label = simd ? "feed() via Lexer" : "feed() via flex";
+    bench::report(label, size, bench::measureIsolated([&]() {
+      FILE *in = fopen(path.c_str(), "r");
+      if (!in) return false;
+
+      nth::Driver driver;
+      driver.should_use_simd_lexer = simd;
+      size_t statements = 0;
+      driver.pushBegin([&](nth::ASTNode *) { ++statements; });
+      char chunk[64 * 1024];
+      size_t n;
+      while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+        driver.feed(chunk, n);
+      }
+      fclose(in);
+      return driver.finish() == 0 && statements > 0;
+    }));
+  }
+
+  unlink(path.c_str());
+}
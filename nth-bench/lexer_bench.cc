@@ -0,0 +1,286 @@
+//
+//  lexer_bench.cc
+//  nth
+//
+//  Token throughput of the flex scanner against the hand-written Lexer,
+//  without the parser, and whole parses with each.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_helper.h"
+#include "driver.h"
+#include "numeric_literal.h"
+#include "utf8.h"
+
+namespace {
+
+size_t countTokens(nth::Driver &driver, const std::string &source) {
+  size_t tokens = 0;
+  driver.scanBuffer(source.data(), source.size());
+  while (driver.lex().kind() != yy::parser::symbol_kind::S_YYEOF) {
+    ++tokens;
+  }
+  driver.scanEnd();
+  return tokens;
+}
+
+}
+
+BENCHMARK(Lexers) {
+  std::string source = bench::generateSource(64 * 1024 * 1024 * bench::scale());
+
+  for (int simd = 0; simd < 2; ++simd) {
+    nth::Driver driver;
+    driver.should_use_simd_lexer = simd;
+
+    size_t tokens = 0;
+    bench::Measurement m;
+    m.seconds = bench::measure([&]() { tokens = countTokens(driver, source); });
+    m.peakRSSKilobytes = 0;
+    m.succeeded = tokens > 0;
+    bench::report(simd ? "tokens via Lexer" : "tokens via flex", source.size(), m);
+  }
+
+  for (int simd = 0; simd < 2; ++simd) {
+    nth::Driver driver;
+    driver.should_use_simd_lexer = simd;
+
+    int ret = 1;
+    bench::Measurement m;
+    m.seconds = bench::measure([&]() {
+      ret = driver.parseBuffer(source.data(), source.size());
+    });
+    m.peakRSSKilobytes = 0;
+    m.succeeded = ret == 0;
+    bench::report(simd ? "parseBuffer() via Lexer" : "parseBuffer() via flex",
+                  source.size(), m);
+  }
+}
+
+BENCHMARK(ParallelLexer) {
+  // Lexer split across threads, up to one per core
+  std::string source = bench::generateSource(64 * 1024 * 1024 * bench::scale());
+  unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+
+  for (unsigned threads = 1;; threads = std::min(threads * 2, cores)) {
+    nth::Driver driver;
+    driver.should_use_simd_lexer = true;
+    driver.lexer_threads = threads;
+
+    size_t tokens = 0;
+    bench::Measurement m;
+    m.seconds = bench::measure([&]() { tokens = countTokens(driver, source); });
+    m.peakRSSKilobytes = 0;
+    m.succeeded = tokens > 0;
+    bench::report("tokens via Lexer on " + std::to_string(threads) + " threads",
+                  source.size(), m);
+    if (threads == cores) break;
+  }
+}
+
+BENCHMARK(EscapedStrings) {
+  // Long data strings dense with escapes, the worst case for scanners
+  // that rescan a literal at each escaped quote
+  std::string literal = "\"";
+  for (int i = 0; i < 16 * 1024; ++i) {
+    literal += i % 2 ? "\\\"q" : "\\n\\t";
+  }
+  literal += "\"\n";
+
+  std::string source;
+  size_t target = 16 * 1024 * 1024 * bench::scale();
+  while (source.size() < target) {
+    source += literal;
+  }
+
+  for (int simd = 0; simd < 2; ++simd) {
+    nth::Driver driver;
+    driver.should_use_simd_lexer = simd;
+
+    size_t tokens = 0;
+    bench::Measurement m;
+    m.seconds = bench::measure([&]() { tokens = countTokens(driver, source); });
+    m.peakRSSKilobytes = 0;
+    m.succeeded = tokens > 0;
+    bench::report(simd ? "string tokens via Lexer" : "string tokens via flex",
+                  source.size(), m);
+  }
+}
+
+BENCHMARK(NumericLiterals) {
+  // Data tables: arrays of integers, hex constants and floats of the
+  // lengths measurements and generated code tend to have
+  std::mt19937_64 random(42);
+  std::vector<std::string> floats, integers;
+  std::string source;
+  size_t target = 16 * 1024 * 1024 * bench::scale();
+  while (source.size() < target) {
+    source += "val table: Array = [";
+    for (int i = 0; i < 16; ++i) {
+      char text[64];
+      switch (i % 4) {
+        case 0:
+          snprintf(text, sizeof(text), "%ld", static_cast<long>(random() >> (random() % 64)));
+          integers.push_back(text);
+          break;
+        case 1:
+          snprintf(text, sizeof(text), "0x%llx", static_cast<unsigned long long>(random() >> 1));
+          break;
+        case 2:
+          snprintf(text, sizeof(text), "%.6f", (random() % 1000000) / 997.0);
+          floats.push_back(text);
+          break;
+        default:
+          snprintf(text, sizeof(text), "%.17g", (random() % 1000000) * 1.234567e-7 + 1);
+          floats.push_back(text);
+          break;
+      }
+      source += i ? ", " : "";
+      source += text;
+    }
+    source += "]\n";
+  }
+
+  for (int simd = 0; simd < 2; ++simd) {
+    nth::Driver driver;
+    driver.should_use_simd_lexer = simd;
+
+    size_t tokens = 0;
+    bench::Measurement m;
+    m.seconds = bench::measure([&]() { tokens = countTokens(driver, source); });
+    m.peakRSSKilobytes = 0;
+    m.succeeded = tokens > 0;
+    bench::report(simd ? "numeric tokens via Lexer" : "numeric tokens via flex",
+                  source.size(), m);
+  }
+
+  {
+    nth::Driver driver;
+    driver.should_use_simd_lexer = true;
+
+    int ret = 1;
+    bench::Measurement m;
+    m.seconds = bench::measure([&]() {
+      ret = driver.parseBuffer(source.data(), source.size());
+    });
+    m.peakRSSKilobytes = 0;
+    m.succeeded = ret == 0;
+    bench::report("parseBuffer() via Lexer", source.size(), m);
+  }
+
+  // The conversions alone, against the strtol/strtod calls they replaced
+  size_t bytes = 0;
+  for (const std::string &f : floats) bytes += f.size();
+  for (const std::string &i : integers) bytes += i.size();
+
+  for (int library = 0; library < 2; ++library) {
+    double sum = 0;
+    bench::Measurement m;
+    m.seconds = bench::measure([&]() {
+      for (const std::string &f : floats) {
+        double value;
+        if (library) {
+          value = strtod(f.c_str(), NULL);
+        } else {
+          nth::decodeFloat(f.data(), f.data() + f.size(), value);
+        }
+        sum += value;
+      }
+      for (const std::string &i : integers) {
+        long value;
+        if (library) {
+          value = strtol(i.c_str(), NULL, 10);
+        } else {
+          nth::decodeInteger(i.data(), i.data() + i.size(), 10, value);
+        }
+        sum += value;
+      }
+    });
+    m.peakRSSKilobytes = 0;
+    m.succeeded = sum != 0;
+    bench::report(library ? "values via strtol/strtod" : "values via decodeInteger/decodeFloat",
+                  bytes, m);
+  }
+}
+
+BENCHMARK(MixedScript) {
+  // Identifiers, strings and comments in several scripts among ASCII
+  // punctuation and keywords, as in code written in languages other than
+  // English
+  const char *names[] = {
+    "total", "caf\xc3\xa9", "\xce\xb1\xce\xbd\xce\xb8\xcf\x81\xcf\x89\xcf\x80\xce\xbf\xcf\x82",
+    "\xd0\xb8\xd0\xbc\xd1\x8f", "\xe5\x90\x8d\xe5\x89\x8d", "\xe5\x90\x88\xe8\xa8\x88",
+    "\xd8\xb9\xd8\xaf\xd8\xaf", "na\xc3\xafve_1",
+  };
+  const char *words[] = {
+    "hello", "\xe4\xb8\x96\xe7\x95\x8c", "\xd0\xbc\xd0\xb8\xd1\x80", "\xe2\x82\xac 5",
+    "\xf0\x9f\x98\x80", "\xce\xba\xcf\x8c\xcf\x83\xce\xbc\xce\xb5",
+  };
+  std::mt19937 random(10);
+  std::string source;
+  size_t target = 16 * 1024 * 1024 * bench::scale();
+  while (source.size() < target) {
+    const char *name = names[random() % 8];
+    source += "val ";
+    source += name;
+    source += ": String = \"";
+    source += words[random() % 6];
+    source += " ";
+    source += words[random() % 6];
+    source += "\" // ";
+    source += words[random() % 6];
+    source += "\n";
+    source += names[random() % 8];
+    source += " = ";
+    source += name;
+    source += " + ";
+    source += names[random() % 8];
+    source += "\n";
+  }
+
+  for (int simd = 0; simd < 2; ++simd) {
+    nth::Driver driver;
+    driver.should_use_simd_lexer = simd;
+
+    size_t tokens = 0;
+    bench::Measurement m;
+    m.seconds = bench::measure([&]() { tokens = countTokens(driver, source); });
+    m.peakRSSKilobytes = 0;
+    m.succeeded = tokens > 0;
+    bench::report(simd ? "mixed-script tokens via Lexer" : "mixed-script tokens via flex",
+                  source.size(), m);
+  }
+
+  // Validation alone, on this and on ASCII source, against decoding a
+  // character at a time
+  std::string ascii = bench::generateSource(source.size());
+  for (int input = 0; input < 2; ++input) {
+    const std::string &text = input ? ascii : source;
+    for (int vector = 0; vector < 2; ++vector) {
+      const char *stop = nullptr;
+      bench::Measurement m;
+      m.seconds = bench::measure([&]() {
+        const char *p = text.data(), *end = p + text.size();
+        if (vector) {
+          stop = nth::findInvalidUtf8(p, end);
+          return;
+        }
+        uint32_t c;
+        size_t length;
+        while (p < end && (length = nth::decodeUtf8(p, end, c))) p += length;
+        stop = p;
+      });
+      m.peakRSSKilobytes = 0;
+      m.succeeded = stop == text.data() + text.size();
+      std::string label = vector ? "findInvalidUtf8()" : "decodeUtf8() loop";
+      bench::report(label + (input ? " on ASCII" : " on mixed script"), text.size(), m);
+    }
+  }
+}
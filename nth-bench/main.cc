@@ -0,0 +1,13 @@
+//
+//  main.cc
+//  nth
+//
+
+#include <string>
+#include "bench_helper.h"
+
+// Usage: nth-bench [name-filter]
+int main(int argc, char *argv[]) {
+  bench::runBenchmarks(argc > 1 ? argv[1] : "");
+  return 0;
+}
@@ -0,0 +1,572 @@
+//
+//  parser_bench.cc
+//  nth
+//
+//  Edit-and-rerun cycles needed to clear a file of syntax errors, now that
+//  the parser recovers and reports every one, against stopping at the first,
+//  the cost of parsing very long lists, parsing groups of top-level
+//  statements on several threads, reparsing a file after each keystroke,
+//  checking syntax without building a tree, outlining modules for
+//  indexing, the hand-written PrattParser against bison's, packed arrays
+//  of constants, the memory held by the trees of repeated literals, and
+//  allocating nodes from an ASTContext.
+//
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ast.h"
+#include "bench_helper.h"
+#include "driver.h"
+#include "statement_splitter.h"
+
+namespace {
+
+std::vector<std::string> splitLines(const std::string &source) {
+  std::vector<std::string> lines;
+  std::istringstream in(source);
+  std::string line;
+  while (std::getline(in, line)) lines.push_back(line);
+  return lines;
+}
+
+// Breaks a line the way a hurried edit might, or returns it unchanged if
+// it isn't one of the kinds of statement handled
+std::string breakLine(const std::string &line) {
+  size_t at;
+  if (line.compare(0, 4, "val ") == 0 && (at = line.find("= ")) != std::string::npos) {
+    return line.substr(0, at + 2) + ") " + line.substr(at + 2);   // stray paren
+  }
+  if (line[0] == '[' && (at = line.find(", ")) != std::string::npos) {
+    return line.substr(0, at) + ", ," + line.substr(at + 1);      // missing element
+  }
+  if (line.compare(0, 8, "function") == 0) {
+    return line.substr(0, line.size() - 1);                       // unclosed call
+  }
+  return line;
+}
+
+// Lines of the syntax errors reported by parsing source
+std::set<int> reportedLines(nth::Driver &driver, const std::string &source, int &ret) {
+  std::ostringstream errors;
+  std::streambuf *saved = std::cerr.rdbuf(errors.rdbuf());
+  ret = driver.parseString(source);
+  std::cerr.rdbuf(saved);
+
+  std::set<int> lines;
+  std::istringstream in(errors.str());
+  std::string message;
+  while (std::getline(in, message)) lines.insert(atoi(message.c_str()));
+  return lines;
+}
+
+// The example file repeated, which is read from one directory up, as
+// benchmarks are run from nth-bench
+std::string repeatedExample(size_t copies) {
+  std::ifstream in("../nth.nth");
+  std::stringstream example;
+  example << in.rdbuf() << "\n";
+  std::string text = example.str(), source;
+  source.reserve(text.size() * copies);
+  for (size_t i = 0; i < copies; ++i) source += text;
+  return source;
+}
+
+}
+
+BENCHMARK(SeededErrors) {
+  std::vector<std::string> lines = splitLines(bench::generateSource(1024 * 1024 * bench::scale()));
+  std::vector<std::string> broken = lines;
+
+  // Errors a few statements apart, on lines that can be told from each
+  // other by where they're reported
+  std::mt19937 random(11);
+  std::set<size_t> seeded;
+  for (size_t i = random() % 32; i < lines.size(); i += 8 + random() % 48) {
+    std::string line = breakLine(lines[i]);
+    if (line == lines[i]) continue;
+    broken[i] = line;
+    seeded.insert(i);
+  }
+
+  auto join = [](const std::vector<std::string> &lines) {
+    std::string source;
+    for (const std::string &line : lines) source += line + '\n';
+    return source;
+  };
+
+  // Fixes every seeded error that a report points at, taking the nearest
+  // one at most a statement above each reported line, until the file parses cleanly. A
+  // run that doesn't lead to any of them still fixes the first. Stopping
+  // at the first error took one run per error, and one more to confirm.
+  size_t seededCount = seeded.size(), firstReported = 0, bytes = 0;
+  int runs = 0, ret = 1;
+  bench::Measurement m = { 0, 0, true };
+  while (ret && m.succeeded) {
+    std::string source = join(broken);
+    nth::Driver driver;
+    std::set<int> reported;
+    m.seconds += bench::measure([&]() { reported = reportedLines(driver, source, ret); });
+    bytes += source.size();
+    if (++runs == 1) firstReported = reported.size();
+
+    bool fixed = false;
+    for (int line : reported) {
+      auto it = seeded.upper_bound(line - 1);
+      if (it == seeded.begin() || *--it + 3 < static_cast<size_t>(line)) continue;
+      broken[*it] = lines[*it];
+      seeded.erase(it);
+      fixed = true;
+    }
+    if (!fixed && !seeded.empty()) {
+      broken[*seeded.begin()] = lines[*seeded.begin()];
+      seeded.erase(seeded.begin());
+    }
+    m.succeeded = runs <= static_cast<int>(seededCount) + 1;
+  }
+
+  bench::report("parses until clean", bytes, m);
+  std::cout << "  " << seededCount << " seeded errors, " << firstReported
+            << " reported by the first run: " << runs << " runs to a clean parse, against "
+            << seededCount + 1 << " stopping at the first\n";
+}
+
+BENCHMARK(LongLists) {
+  // Functions with thousands of parameters and calls with as many
+  // arguments, and literals and types with a great many elements
+  const int kArguments = 4000, kElements = 100000 * bench::scale();
+  std::string signature = "def f(", call = "f(", type = "type T = (",
+              array = "val a: Array = [", map = "{";
+  for (int i = 0; i < kArguments; ++i) {
+    std::string n = std::to_string(i);
+    signature += (i ? ", a" : "a") + n + ": Int";
+    call += (i ? ", " : "") + n;
+    type += (i ? ", Int" : "Int");
+  }
+  signature += "): Int { a0 }\n";
+  call += ")\n";
+  type += ") => Int\n";
+  for (int i = 0; i < kElements; ++i) {
+    std::string n = std::to_string(i);
+    array += (i ? ", " : "") + n;
+    map += (i ? ", \"k" : "\"k") + n + "\": " + n;
+  }
+  array += "]\n";
+  map += "}\n";
+
+  struct { const char *label; std::string source; size_t elements; } cases[] = {
+    { "4000-parameter functions", std::string(), kArguments },
+    { "4000-argument calls", std::string(), kArguments },
+    { "4000-parameter function types", std::string(), kArguments },
+    { "100k-element arrays", std::string(), static_cast<size_t>(kElements) },
+    { "100k-entry maps", std::string(), static_cast<size_t>(kElements) },
+  };
+  const std::string *pieces[] = { &signature, &call, &type, &array, &map };
+  for (int i = 0; i < 5; ++i) {
+    while (cases[i].source.size() < 4 * 1024 * 1024 * bench::scale()) {
+      cases[i].source += *pieces[i];
+    }
+  }
+
+  for (auto &test : cases) {
+    nth::Driver driver;
+    int ret = 1;
+    size_t before = bench::allocations();
+    bench::Measurement m;
+    m.seconds = bench::measure([&]() {
+      ret = driver.parseString(test.source);
+    });
+    m.peakRSSKilobytes = 0;
+    m.succeeded = ret == 0;
+    size_t lists = test.source.size() / (test.source.find('\n') + 1);
+    bench::report(test.label, test.source.size(), m);
+    std::cout << "    " << (bench::allocations() - before) / static_cast<double>(lists * test.elements)
+              << " allocations per element\n";
+    delete driver.result;
+  }
+}
+
+BENCHMARK(ParallelParse) {
+  // One very large generated module, parsed a group of statements per
+  // thread, up to one per core (and at least four, so that the cost of
+  // splitting shows even where there's nothing to gain)
+  std::string source = bench::generateSource(64 * 1024 * 1024 * bench::scale());
+  unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+
+  // The pass that finds where to cut, alone
+  {
+    size_t groups = 0;
+    bench::Measurement m;
+    m.seconds = bench::measure([&]() {
+      groups = nth::splitTopLevel(source.data(), source.data() + source.size(), 64).size();
+    });
+    m.peakRSSKilobytes = 0;
+    m.succeeded = groups == 64;
+    bench::report("splitTopLevel() into 64 groups", source.size(), m);
+  }
+
+  for (unsigned threads = 1;; threads = std::min(threads * 2, std::max(cores, 4u))) {
+    nth::Driver driver;
+    driver.should_use_simd_lexer = true;
+    driver.parser_threads = threads;
+
+    int ret = 1;
+    bench::Measurement m;
+    m.seconds = bench::measure([&]() {
+      ret = driver.parseBuffer(source.data(), source.size());
+    });
+    m.peakRSSKilobytes = 0;
+    m.succeeded = ret == 0;
+    bench::report("parseBuffer() on " + std::to_string(threads) + " threads",
+                  source.size(), m);
+    delete driver.result;
+    if (threads >= std::max(cores, 4u)) break;
+  }
+
+  // The same groups parsed alone, one after another. Their total against
+  // the parse on one thread is the work that splitting adds; the longest
+  // is how fast the parse could be with a core for each group.
+  {
+    unsigned count = std::max(cores, 4u);
+    std::vector<nth::StatementGroup> groups =
+      nth::splitTopLevel(source.data(), source.data() + source.size(), count);
+    bench::Measurement total = { 0, 0, true }, longest = { 0, 0, true };
+    for (const nth::StatementGroup &group : groups) {
+      nth::Driver driver;
+      driver.should_use_simd_lexer = true;
+      int ret = 1;
+      double seconds = bench::measure([&]() {
+        ret = driver.parseBuffer(group.begin, group.end - group.begin);
+      });
+      delete driver.result;
+      total.seconds += seconds;
+      total.succeeded = total.succeeded && ret == 0;
+      longest.seconds = std::max(longest.seconds, seconds);
+    }
+    longest.succeeded = total.succeeded;
+    bench::report(std::to_string(groups.size()) + " groups one after another",
+                  source.size(), total);
+    bench::report("longest of them alone", source.size(), longest);
+  }
+}
+
+BENCHMARK(IncrementalReparse) {
+  // Single-character edits to a 100k-line file, each made and then undone:
+  // a digit changed in place, and a newline added before a statement, which
+  // moves every line after it
+  std::string text = bench::generateSource(64 * 1024 * bench::scale());
+  while (std::count(text.begin(), text.end(), '\n') < 100000 * bench::scale()) {
+    text += bench::generateSource(64 * 1024);
+  }
+  std::vector<size_t> digits, lineStarts;
+  for (size_t i = 0; i < text.size(); ++i) {
+    // The first digit of a decimal number (not the 0 of 0x)
+    if (text[i] >= '0' && text[i] <= '9' && text[i - 1] == ' ' && !isalpha(text[i + 1])) {
+      digits.push_back(i);
+    }
+    if (i && text[i - 1] == '\n' && nth::startsStatement(&text[i], &text[i] + 1)) {
+      lineStarts.push_back(i);
+    }
+  }
+
+  // Positions are found outside the timed part, as an editor would know them
+  auto positionOf = [&](size_t offset) {
+    yy::position position;
+    const char *p = text.data(), *end = p + offset;
+    for (const char *newline; (newline = static_cast<const char *>(memchr(p, '\n', end - p)));
+         p = newline + 1) {
+      position.lines(1);
+    }
+    position.columns(static_cast<int>(end - p));
+    return position;
+  };
+  auto replace = [&](size_t offset, size_t removed, const std::string &inserted) {
+    nth::Driver::Edit edit = { positionOf(offset), positionOf(offset + removed), inserted.size() };
+    text.replace(offset, removed, inserted);
+    return edit;
+  };
+
+  const int kEdits = 100;
+  std::mt19937 random(15);
+  for (int newlines = 0; newlines < 2; ++newlines) {
+    nth::Driver incremental;
+    int ret = incremental.parseString(text);
+    bench::Measurement reparse = { 0, 0, ret == 0 }, whole = { 0, 0, ret == 0 };
+
+    for (int i = 0; i < kEdits; ++i) {
+      size_t offset;
+      std::string edited, original;
+      if (newlines) {
+        offset = lineStarts[random() % lineStarts.size()];
+        edited = "\n";
+      } else {
+        offset = digits[random() % digits.size()];
+        original = text.substr(offset, 1);
+        edited = std::string(1, '0' + (original[0] - '0' + 1) % 10);
+      }
+
+      for (int undo = 0; undo < 2; ++undo) {
+        nth::Driver::Edit edit = undo ? replace(offset, edited.size(), original)
+                                      : replace(offset, original.size(), edited);
+        reparse.seconds += bench::measure([&]() {
+          ret = incremental.reparse(incremental.result, text.data(), text.size(), edit);
+        });
+        reparse.succeeded = reparse.succeeded && ret == 0;
+
+        nth::Driver driver;
+        whole.seconds += bench::measure([&]() { ret = driver.parseString(text); });
+        whole.succeeded = whole.succeeded && ret == 0;
+        delete driver.result;
+      }
+    }
+    delete incremental.result;
+
+    std::string kind = newlines ? "newline" : "digit";
+    bench::report("reparse(), " + kind + " edits", text.size() * 2 * kEdits, reparse);
+    bench::report("parseString(), " + kind + " edits", text.size() * 2 * kEdits, whole);
+    std::cout << "    " << reparse.seconds * 1000 / (2 * kEdits) << " ms against "
+              << whole.seconds * 1000 / (2 * kEdits) << " ms per edit\n";
+  }
+}
+
+BENCHMARK(SyntaxOnly) {
+  // Scanning alone, then parses that check syntax only and that build the
+  // tree, with each scanner
+  std::string source = bench::generateSource(64 * 1024 * 1024 * bench::scale());
+
+  for (int simd = 0; simd < 2; ++simd) {
+    std::string scanner = simd ? " with Lexer" : " with flex";
+    {
+      nth::Driver driver;
+      driver.should_use_simd_lexer = simd;
+      size_t tokens = 0;
+      bench::Measurement m;
+      m.seconds = bench::measure([&]() {
+        driver.scanBuffer(source.data(), source.size());
+        while (driver.lex().kind() != yy::parser::symbol_kind::S_YYEOF) ++tokens;
+        driver.scanEnd();
+      });
+      m.peakRSSKilobytes = 0;
+      m.succeeded = tokens > 0;
+      bench::report("scan only" + scanner, source.size(), m);
+    }
+
+    for (int build = 0; build < 2; ++build) {
+      nth::Driver driver;
+      driver.should_use_simd_lexer = simd;
+      driver.should_build_ast = build;
+      int ret = 1;
+      size_t before = bench::allocations();
+      bench::Measurement m;
+      m.seconds = bench::measure([&]() {
+        ret = driver.parseBuffer(source.data(), source.size());
+      });
+      m.peakRSSKilobytes = 0;
+      m.succeeded = ret == 0;
+      bench::report((build ? "full parse" : "syntax only") + scanner, source.size(), m);
+      std::cout << "    " << bench::allocations() - before << " allocations\n";
+      delete driver.result;
+    }
+  }
+}
+
+BENCHMARK(Outline) {
+  // A module of function definitions with bodies of some length, as an
+  // indexer would see, scanned, outlined and parsed in full
+  std::stringstream ss;
+  for (int n = 0; ss.tellp() < static_cast<std::streamoff>(64 * 1024 * 1024 * bench::scale()); ++n) {
+    ss << "type Pair" << n << " = (Int, String)\n"
+       << "val limit" << n << ": Int = " << n << " * 4\n"
+       << "def handle" << n << "(x: Int, p: Pair" << n << ", f: (Int) => Int): Int {\n"
+       << "  val total: Int = x * " << n << " + p.0\n"
+       << "  val label: String = \"item #{p.1} of #{total}\"\n"
+       << "  val parts: Array = [x, total, f(x), " << n << "]\n"
+       << "  if (total > limit" << n << ") {\n"
+       << "    log(label, {\"total\": total, \"limit\": limit" << n << "})\n"
+       << "    f(total - limit" << n << ")\n"
+       << "  } else {\n"
+       << "    parts[2] + (total << 2) % 7\n"
+       << "  }\n"
+       << "}\n";
+  }
+  std::string source = ss.str();
+
+  for (int simd = 0; simd < 2; ++simd) {
+    std::string scanner = simd ? " with Lexer" : " with flex";
+    {
+      nth::Driver driver;
+      driver.should_use_simd_lexer = simd;
+      size_t tokens = 0;
+      bench::Measurement m;
+      m.seconds = bench::measure([&]() {
+        driver.scanBuffer(source.data(), source.size());
+        while (driver.lex().kind() != yy::parser::symbol_kind::S_YYEOF) ++tokens;
+        driver.scanEnd();
+      });
+      m.peakRSSKilobytes = 0;
+      m.succeeded = tokens > 0;
+      bench::report("scan only" + scanner, source.size(), m);
+    }
+
+    for (int outline = 1; outline >= 0; --outline) {
+      nth::Driver driver;
+      driver.should_use_simd_lexer = simd;
+      driver.should_outline = outline;
+      int ret = 1;
+      bench::Measurement m;
+      m.seconds = bench::measure([&]() {
+        ret = driver.parseBuffer(source.data(), source.size());
+      });
+      m.peakRSSKilobytes = 0;
+      m.succeeded = ret == 0;
+      bench::report((outline ? "outline" : "full parse") + scanner, source.size(), m);
+
+      if (outline) {
+        // And the cost of going back for every block after all
+        m.seconds += bench::measure([&]() {
+          for (nth::ASTNode *node : driver.result->getNodes()) {
+            nth::FunctionDef *function = dynamic_cast<nth::FunctionDef *>(node);
+            if (function) function->getBlock();
+          }
+        });
+        bench::report("outline, then blocks" + scanner, source.size(), m);
+      }
+      delete driver.result;
+    }
+  }
+}
+
+BENCHMARK(PrattParser) {
+  // bison's parser against the hand-written one, on input that's mostly
+  // operators, mostly calls, and the usual mix. Lexer does the scanning,
+  // as it's the cheaper.
+  size_t size = 32 * 1024 * 1024 * bench::scale();
+  std::stringstream arithmetic, calls;
+  for (int n = 0; arithmetic.tellp() < static_cast<std::streamoff>(size); ++n) {
+    arithmetic << "val v" << n << ": Int = a * " << n << " + (b - c) / d % 7 - e * f * "
+               << n % 13 << " + (g << 2) & h | i ^ 3 < j + k && l || !m\n";
+  }
+  for (int n = 0; calls.tellp() < static_cast<std::streamoff>(size); ++n) {
+    calls << "f" << n % 97 << "(g(x, " << n << "), h(y)[2], z.w(3).v, k(), m(n(o(p))))\n";
+  }
+  const std::pair<const char *, std::string> inputs[] = {
+    {"arithmetic", arithmetic.str()},
+    {"calls", calls.str()},
+    {"generated", bench::generateSource(size)},
+  };
+
+  for (const auto &input : inputs) {
+    for (int pratt = 0; pratt < 2; ++pratt) {
+      nth::Driver driver;
+      driver.should_use_simd_lexer = true;
+      driver.should_use_pratt_parser = pratt;
+      int ret = 1;
+      bench::Measurement m;
+      m.seconds = bench::measure([&]() {
+        ret = driver.parseBuffer(input.second.data(), input.second.size());
+      });
+      m.peakRSSKilobytes = 0;
+      m.succeeded = ret == 0;
+      bench::report(std::string(pratt ? "PrattParser, " : "bison, ") + input.first,
+                    input.second.size(), m);
+      delete driver.result;
+    }
+  }
+}
+
+BENCHMARK(ConstantTables) {
+  // Array literals of millions of constants, which are packed, against
+  // the same with an identifier among them, which keeps a node apiece. The
+  // source is made in the measured process, so that peak RSS is its own.
+  const size_t kElements = 2 * 1000 * 1000 * bench::scale();
+  const char *kinds[] = {"integers", "floats", "strings"};
+  auto element = [](int kind, size_t i) {
+    std::string n = std::to_string(i);
+    return kind == 0 ? n : kind == 1 ? n + ".5" : "\"k" + n + "\"";
+  };
+
+  for (int kind = 0; kind < 3; ++kind) {
+    for (int packed = 1; packed >= 0; --packed) {
+      std::string head = packed ? "[" : "[x, ";
+      size_t size = head.size() + 2;
+      for (size_t i = 0; i < kElements; ++i) {
+        size += (i ? 2 : 0) + element(kind, i).size();
+      }
+
+      bench::report(std::string(packed ? "packed " : "unpacked ") + kinds[kind], size,
+                    bench::measureIsolated([&]() {
+        std::string source = head;
+        for (size_t i = 0; i < kElements; ++i) {
+          source += (i ? ", " : "") + element(kind, i);
+        }
+        source += "]\n";
+
+        nth::Driver driver;
+        driver.should_use_simd_lexer = true;
+        bool ok = driver.parseString(source) == 0;
+        delete driver.result;
+        return ok;
+      }));
+    }
+  }
+}
+
+BENCHMARK(LiteralPool) {
+  // The example file, which has a literal in every other statement, many
+  // times over. String and big integer literals share their values through
+  // the driver's ConstantPool; compare peak RSS across revisions.
+  const size_t kCopies = 10000 * bench::scale();
+  const size_t size = repeatedExample(1).size() * kCopies;
+
+  bench::report("nth.nth x " + std::to_string(kCopies), size,
+                bench::measureIsolated([&]() {
+    std::string source = repeatedExample(kCopies);
+    nth::Driver driver;
+    driver.should_use_simd_lexer = true;
+    bool ok = driver.parseString(source) == 0;
+    delete driver.result;
+    return ok;
+  }));
+}
+
+BENCHMARK(NodeAllocation) {
+  // Nodes come out of the parse's ASTContext rather than one malloc
+  // apiece; compare allocations and time across revisions. Streamed
+  // statements still go to the heap, for contrast.
+  std::string source = repeatedExample(1000 * bench::scale());
+
+  nth::Driver driver;
+  driver.should_use_simd_lexer = true;
+  int ret = 1;
+  size_t before = bench::allocations();
+  bench::Measurement m;
+  m.seconds = bench::measure([&]() { ret = driver.parseString(source); });
+  m.peakRSSKilobytes = 0;
+  m.succeeded = ret == 0;
+  bench::report("parse", source.size(), m);
+  std::cout << "    " << bench::allocations() - before << " allocations\n";
+
+  m.seconds = bench::measure([&]() { delete driver.result; });
+  bench::report("delete", source.size(), m);
+
+  FILE *in = fmemopen(&source[0], source.size(), "r");
+  before = bench::allocations();
+  m.seconds = bench::measure([&]() {
+    ret = driver.parseStream(in, [](nth::ASTNode *) {});
+  });
+  m.succeeded = ret == 0;
+  fclose(in);
+  bench::report("streamed", source.size(), m);
+  std::cout << "    " << bench::allocations() - before << " allocations\n";
+}
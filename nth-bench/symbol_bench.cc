@@ -0,0 +1,116 @@
+//
+//  symbol_bench.cc
+//  nth
+//
+//  Looking identifiers up in nested symbol tables, as the scope and type
+//  checkers do for every reference, and type checking code nested
+//  thousands deep.
+//
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ast.h"
+#include "bench_helper.h"
+#include "symbol_table.h"
+#include "type.h"
+#include "type_checker.h"
+
+BENCHMARK(SymbolLookup) {
+  // 64 scopes of 32 symbols each, with names that share a long prefix so
+  // that comparing spellings has to read most of them. Each lookup finds
+  // its symbol somewhere up the chain, or misses altogether.
+  const int kDepth = 64, kPerScope = 32;
+  const size_t kLookups = 200000 * bench::scale();
+
+  std::vector<nth::Identifier *> idents;
+  nth::SymbolTable *table = new nth::SymbolTable();
+  for (int depth = 0; depth < kDepth; depth++) {
+    if (depth > 0) table = table->beget();
+    for (int i = 0; i < kPerScope; i++) {
+      idents.push_back(new nth::Identifier(
+          "some_rather_long_identifier_" + std::to_string(depth * kPerScope + i)));
+      table->addSymbol(idents.back());
+    }
+  }
+  for (int i = 0; i < kPerScope; i++) {
+    idents.push_back(new nth::Identifier(
+        "some_rather_long_identifier_missing_" + std::to_string(i)));
+  }
+
+  size_t found = 0;
+  bench::Measurement m;
+  m.seconds = bench::measure([&]() {
+    for (size_t i = 0; i < kLookups; i++) {
+      if (table->findSymbol(idents[(i * 7919) % idents.size()])) ++found;
+    }
+  });
+  m.peakRSSKilobytes = 0;
+  m.succeeded = found > 0;
+  bench::report(std::to_string(kLookups) + " lookups", 0, m);
+}
+
+namespace {
+
+nth::Type &addType(nth::SymbolTable &table, const std::string &name, nth::Type *parent) {
+  nth::Identifier *ident = new nth::Identifier(name);
+  nth::Type *type = new nth::SimpleType(ident, nth::VariableSet(), nth::MethodSet(), parent);
+  table.addSymbol(ident).setType(*type);
+  return *type;
+}
+
+void reportCheck(const std::string &label, nth::Block *block, std::function<bool()> check) {
+  nth::TypeChecker checker;
+  bench::Measurement m;
+  m.seconds = bench::measure([&]() { block->accept(checker); });
+  m.peakRSSKilobytes = 0;
+  m.succeeded = check();
+  bench::report(label, 0, m);
+}
+
+}
+
+BENCHMARK(DeepNesting) {
+  // Arrays nested 10k deep, which all share their block's scope, and
+  // if-blocks nested as deep, each with a scope of its own as the scope
+  // checker would give it and an integer in it. Checking either shouldn't
+  // cost more per node the deeper it goes.
+  const int kDepth = 10000 * bench::scale();
+
+  nth::SymbolTable root;
+  nth::Type &objectType = addType(root, "Object", nullptr);
+  nth::Type &integerType = addType(root, "Integer", &objectType);
+  addType(root, "Boolean", &objectType);
+  nth::Identifier *arrayIdent = new nth::Identifier("Array");
+  root.addSymbol(arrayIdent).setType(*new nth::TemplatedType(
+    arrayIdent, nth::VariableSet(), nth::MethodSet(), &objectType, nth::TypeList()));
+
+  nth::Integer *deepest = new nth::Integer(1);
+  nth::Expression *array = deepest;
+  for (int depth = 0; depth < kDepth; depth++) {
+    array = new nth::Array(nth::ExpressionList{ array });
+  }
+  nth::Block *arrays = new nth::Block;
+  arrays->insertAfter(array);
+  arrays->setSymbolTable(root.beget());
+  reportCheck(std::to_string(kDepth) + " nested arrays", arrays,
+              [&]() { return deepest->getType() == &integerType; });
+  delete arrays;
+
+  nth::Block *ifs = new nth::Block;
+  ifs->setSymbolTable(root.beget());
+  nth::Block *block = ifs;
+  for (int depth = 0; depth < kDepth; depth++) {
+    nth::Block *inner = new nth::Block;
+    inner->setSymbolTable(block->getSymbolTable()->beget());
+    block->insertAfter(new nth::Integer(depth));
+    block->insertAfter(new nth::IfElse(new nth::True, inner, nullptr));
+    block = inner;
+  }
+  deepest = new nth::Integer(kDepth);
+  block->insertAfter(deepest);
+  reportCheck(std::to_string(kDepth) + " nested if-blocks", ifs,
+              [&]() { return deepest->getType() == &integerType; });
+  delete ifs;
+}
@@ -0,0 +1,91 @@
+//
+//  token_cache_bench.cc
+//  nth
+//
+//  Parses of a file that has to be scanned against parses that replay its
+//  tokens from the .ntok cache.
+//
+
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+
+#include "bench_helper.h"
+#include "driver.h"
+
+namespace {
+
+size_t countTokens(nth::Driver &driver, const std::string &source) {
+  size_t tokens = 0;
+  driver.scanBuffer(source.data(), source.size());
+  while (driver.lex().kind() != yy::parser::symbol_kind::S_YYEOF) {
+    ++tokens;
+  }
+  driver.scanEnd();
+  return tokens;
+}
+
+}
+
+BENCHMARK(TokenCache) {
+  size_t size;
+  std::string path;
+  {
+    std::string source = bench::generateSource(32 * 1024 * 1024 * bench::scale());
+    size = source.size();
+    path = bench::writeTempFile(source);
+  }
+  std::string dir = path + ".ntok.d";
+
+  for (int simd = 0; simd < 2; ++simd) {
+    std::string scanner = simd ? "Lexer" : "flex";
+
+    bench::report("parse() via " + scanner, size, bench::measureIsolated([&]() {
+      nth::Driver driver;
+      driver.should_use_simd_lexer = simd;
+      return driver.parse(path) == 0;
+    }));
+
+    // Cold: scans, then writes the cache
+    std::string command = "rm -rf " + dir;
+    if (system(command.c_str()) != 0) return;
+    bench::report("parse() via " + scanner + ", cache miss", size,
+                  bench::measureIsolated([&]() {
+      nth::Driver driver;
+      driver.should_use_simd_lexer = simd;
+      driver.token_cache_dir = dir;
+      return driver.parse(path) == 0;
+    }));
+  }
+
+  // Warm: the scanner is never run
+  bench::report("parse() via cache hit", size, bench::measureIsolated([&]() {
+    nth::Driver driver;
+    driver.token_cache_dir = dir;
+    return driver.parse(path) == 0;
+  }));
+
+  std::string command = "rm -rf " + dir;
+  if (system(command.c_str()) != 0) return;
+  unlink(path.c_str());
+
+  // The token stream alone, without the parser's work on top
+  std::string source = bench::generateSource(32 * 1024 * 1024 * bench::scale());
+  const char *labels[] = {
+    "tokens via Lexer", "tokens via Lexer, cache miss", "tokens via cache hit"
+  };
+  for (int i = 0; i < 3; ++i) {
+    nth::Driver driver;
+    driver.should_use_simd_lexer = true;
+    if (i > 0) driver.token_cache_dir = dir;
+
+    size_t tokens = 0;
+    bench::Measurement m;
+    m.seconds = bench::measure([&]() { tokens = countTokens(driver, source); });
+    m.peakRSSKilobytes = 0;
+    m.succeeded = tokens > 0;
+    bench::report(labels[i], source.size(), m);
+  }
+
+  if (system(command.c_str()) != 0) return;
+}
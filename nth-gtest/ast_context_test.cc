@@ -0,0 +1,123 @@
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "ast.h"
+#include "ast_context.h"
+#include "driver.h"
+#include "scope_checker.h"
+#include "symbol_table.h"
+
+class ASTContextTest : public ::testing::Test {
+protected:
+  virtual void SetUp() {}
+};
+
+TEST_F(ASTContextTest, ReusesDeletedNodes) {
+  nth::ASTContext *context = new nth::ASTContext;
+  nth::Integer *first = new (context) nth::Integer(1);
+  void *storage = first;
+  delete first;
+
+  nth::Integer *second = new (context) nth::Integer(2);
+  EXPECT_EQ(storage, static_cast<void*>(second));
+  nth::Block *root = new (context) nth::Block();
+  root->insertAfter(second);
+  root->insertAfter(new (context) nth::Float(3.5));
+  EXPECT_EQ(3u, context->getNodeCount());
+
+  // The tree takes over the creator's hold, and deleting it frees the
+  // context
+  size_t contexts = nth::ASTContext::count();
+  context->release(root);
+  EXPECT_EQ(2, *second);
+  delete root;
+  EXPECT_EQ(contexts - 1, nth::ASTContext::count());
+}
+
+TEST_F(ASTContextTest, MixesWithHeapNodes) {
+  nth::ASTContext *context = new nth::ASTContext;
+  nth::Block *block = new (context) nth::Block();
+  block->insertAfter(new nth::Integer(1));
+  block->insertAfter(new (context) nth::String("two"));
+  context->release(block);
+
+  nth::Block *outer = new nth::Block(block);
+  EXPECT_EQ(2u, block->getNodes().size());
+  delete outer;
+}
+
+TEST_F(ASTContextTest, HoldsAdoptedContextsUntilFreed) {
+  size_t contexts = nth::ASTContext::count();
+  nth::ASTContext *context = new nth::ASTContext, *other = new nth::ASTContext;
+  nth::Block *root = new (context) nth::Block();
+  nth::Block *otherRoot = new (other) nth::Block();
+  otherRoot->insertAfter(new (other) nth::Integer(1));
+  context->release(root);
+  other->release(otherRoot);
+
+  // A statement moved from one tree to the other keeps its context
+  root->getContext()->adopt(otherRoot->getContext());
+  root->insertAfter(otherRoot->getNodes()[0]);
+  otherRoot->getNodes().clear();
+  delete otherRoot;
+  EXPECT_EQ(contexts + 2, nth::ASTContext::count());
+  EXPECT_EQ(1u, other->getNodeCount());
+
+  delete root;
+  EXPECT_EQ(contexts, nth::ASTContext::count());
+}
+
+TEST_F(ASTContextTest, TreesOutliveTheirDriver) {
+  std::unique_ptr<nth::Block> result;
+  {
+    nth::Driver driver;
+    EXPECT_EQ(0, driver.parseString("val x: Int = 1\nf([x, 2, \"z\"])"));
+    EXPECT_EQ(nullptr, driver.context);
+    result.reset(driver.result);
+  }
+  EXPECT_EQ(2u, result->getNodes().size());
+}
+
+namespace {
+
+// Notes the order in which it's destroyed
+struct Made {
+  Made(std::vector<int> &destroyed, int n) : destroyed(destroyed), n(n) {}
+  ~Made() { destroyed.push_back(n); }
+  std::vector<int> &destroyed;
+  int n;
+};
+
+}
+
+TEST_F(ASTContextTest, DestroysWhatItMadeWithItself) {
+  std::vector<int> destroyed;
+  nth::ASTContext *context = new nth::ASTContext;
+  nth::Integer *node = new (context) nth::Integer(1);
+  EXPECT_EQ(context, node->getContext());
+  context->make<Made>(destroyed, 1);
+  context->make<Made>(destroyed, 2);
+
+  context->release(node);
+  EXPECT_TRUE(destroyed.empty());
+  delete node;
+  EXPECT_EQ(std::vector<int>({ 2, 1 }), destroyed);
+}
+
+TEST_F(ASTContextTest, ScopesAreMadeInTheTreesContext) {
+  nth::Driver driver;
+  ASSERT_EQ(0, driver.parseString("val x: Int = 1\nif (true) { val y: Int = x }\n"));
+  std::unique_ptr<nth::Block> result(driver.result);
+  nth::IfElse *ifElse = nth::dyn_cast<nth::IfElse>(result->getNodes()[1]);
+  ASSERT_NE(nullptr, ifElse);
+  nth::Block *inner = ifElse->getIfBlock();
+  EXPECT_NE(nullptr, inner->getContext());
+
+  nth::SymbolTable builtins({ new nth::Identifier("Int") });
+  nth::ScopeChecker checker(builtins);
+  EXPECT_TRUE(checker.run(result.get()));
+  ASSERT_NE(nullptr, inner->getSymbolTable());
+  EXPECT_NE(nullptr, inner->getSymbolTable()->findSymbol(nth::Name("y")));
+  EXPECT_NE(nullptr, inner->getSymbolTable()->findSymbol(nth::Name("x")));
+}
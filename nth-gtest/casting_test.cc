@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include "driver.h"
+#include "static_visitor.h"
+#include "type.h"
+
+class CastingTest : public ::testing::Test {
+protected:
+  virtual void SetUp() {}
+};
+
+TEST_F(CastingTest, CastsNodesByKind) {
+  nth::Block block;
+  block.insertAfter(new nth::Integer(1));
+  block.insertAfter(new nth::Add(nth::ExpressionPtr(new nth::Integer(2)),
+                                 nth::ExpressionPtr(new nth::Float(3.5))));
+  block.insertAfter(new nth::SimpleTypeRef(new nth::Identifier("Int")));
+
+  nth::ASTNode *integer = block.getNodes()[0];
+  EXPECT_EQ(nth::ASTNode::Kind::Integer, integer->getKind());
+  EXPECT_TRUE(nth::isa<nth::Expression>(integer));
+  EXPECT_EQ(1, *nth::cast<nth::Integer>(integer));
+  EXPECT_EQ(nullptr, nth::dyn_cast<nth::Float>(integer));
+
+  nth::ASTNode *add = block.getNodes()[1];
+  EXPECT_TRUE(nth::isa<nth::BinaryOperation>(add));
+  EXPECT_FALSE(nth::isa<nth::UnaryOperation>(add));
+  EXPECT_NE(nullptr, nth::dyn_cast<nth::Add>(add));
+
+  nth::ASTNode *type = block.getNodes()[2];
+  EXPECT_FALSE(nth::isa<nth::Expression>(type));
+  EXPECT_TRUE(nth::isa<nth::TypeRef>(type));
+  EXPECT_FALSE(nth::isa<nth::TypeDef>(type));
+  EXPECT_EQ(nullptr, nth::dyn_cast_or_null<nth::Expression>(static_cast<nth::ASTNode*>(nullptr)));
+}
+
+TEST_F(CastingTest, CastsTypesByKind) {
+  nth::Type *function = new nth::FunctionType({}, nth::Type::objectType());
+  EXPECT_TRUE(nth::isa<nth::TemplatedType>(function));
+  EXPECT_TRUE(nth::isa<nth::FunctionType>(function));
+  EXPECT_FALSE(nth::isa<nth::SimpleType>(function));
+  EXPECT_EQ(nullptr, nth::dyn_cast<nth::FunctionType>(nth::Type::objectType()));
+}
+
+namespace {
+
+// Counts what the Visitor would come to, through dispatch() alone
+class CountingVisitor : public nth::StaticVisitor<CountingVisitor> {
+ public:
+  CountingVisitor() : identifiers(0), operations(0) {}
+
+  void visitIdentifier(nth::Identifier *ident) { identifiers++; }
+  void visitBinaryOperation(nth::BinaryOperation *bin_op) {
+    operations++;
+    StaticVisitor::visitBinaryOperation(bin_op);
+  }
+
+  int identifiers;
+  int operations;
+};
+
+}
+
+TEST_F(CastingTest, DispatchesOnKind) {
+  nth::Driver d;
+  ASSERT_EQ(0, d.parseString("def f(a: Int): Int { a * (b + 1) }\nf(c.d)"));
+
+  CountingVisitor visitor;
+  visitor.dispatch(d.result);
+  // f, a, Int, Int, a, b in the definition, then f, c and d
+  EXPECT_EQ(9, visitor.identifiers);
+  EXPECT_EQ(3, visitor.operations);
+  delete d.result;
+}
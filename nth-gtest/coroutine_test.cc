@@ -0,0 +1,79 @@
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "coroutine.h"
+
+class CoroutineTest : public ::testing::Test {
+protected:
+  virtual void SetUp() {}
+};
+
+TEST_F(CoroutineTest, RunsUntilEachYield) {
+  std::vector<int> steps;
+  nth::Coroutine *self = nullptr;
+  nth::Coroutine coroutine([&]() {
+    for (int i = 0; i < 3; ++i) {
+      steps.push_back(i);
+      self->yield();
+    }
+  });
+  self = &coroutine;
+
+  EXPECT_TRUE(steps.empty());
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(coroutine.resume());
+    EXPECT_EQ(static_cast<size_t>(i + 1), steps.size());
+  }
+  EXPECT_FALSE(coroutine.resume());
+  EXPECT_TRUE(coroutine.isDone());
+  EXPECT_FALSE(coroutine.resume());
+}
+
+TEST_F(CoroutineTest, InterleavesWithOthers) {
+  std::string trace;
+  std::vector<nth::Coroutine*> coroutines;
+  for (char name : { 'a', 'b' }) {
+    nth::Coroutine **self = new nth::Coroutine*;
+    coroutines.push_back(new nth::Coroutine([&trace, name, self]() {
+      for (int i = 0; i < 2; ++i) {
+        trace += name;
+        (*self)->yield();
+      }
+      delete self;
+    }));
+    *self = coroutines.back();
+  }
+
+  while (coroutines[0]->resume() | coroutines[1]->resume()) {}
+  EXPECT_EQ("abab", trace);
+  for (nth::Coroutine *coroutine : coroutines) delete coroutine;
+}
+
+TEST_F(CoroutineTest, UnwindsWhenAbandoned) {
+  struct Guard {
+    bool &released;
+    ~Guard() { released = true; }
+  };
+  bool released = false, resumed = false;
+  {
+    nth::Coroutine *self = nullptr;
+    nth::Coroutine coroutine([&]() {
+      Guard guard{released};
+      self->yield();
+      resumed = true;
+    });
+    self = &coroutine;
+    EXPECT_TRUE(coroutine.resume());
+    EXPECT_FALSE(released);
+  }
+  EXPECT_TRUE(released);
+  EXPECT_FALSE(resumed);
+}
+
+TEST_F(CoroutineTest, RethrowsToCaller) {
+  nth::Coroutine coroutine([]() { throw std::runtime_error("failed"); });
+  EXPECT_THROW(coroutine.resume(), std::runtime_error);
+  EXPECT_TRUE(coroutine.isDone());
+}
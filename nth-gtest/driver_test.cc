@@ -1,11 +1,685 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
 #include <gtest/gtest.h>
 #include "test_helper.h"
+#include "ast.h"
+#include "ast_string_printer.h"
 #include "driver.h"
+#include "statement_splitter.h"
 
 class DriverTest : public ::testing::Test {
 protected:
   virtual void SetUp() {}
 };
 
-// TODO: figure out how to test Driver
-// looks challenging...
+namespace {
+
+// Produces a small program which exercises most of the grammar and
+// varies with n so that each generated file has a distinct parse tree.
+std::string generateSource(int n) {
+  std::stringstream ss;
+  ss << "// generated " << n << "\n"
+     << "val a" << n << ": Int = " << n << " + " << n << " * 2\n"
+     << "def f" << n << "[T](x: Int, y: (Int, String)): Int {\n"
+     << "  x * " << n << " + y.0\n"
+     << "}\n"
+     << "/* block\n   comment */\n"
+     << "[1, 2, " << n << "]\n"
+     << "\"string " << n << "\"\n"
+     << "{\"k" << n << "\": " << n << ".5}\n"
+     << "val g" << n << ": (Int) => Int = (z: Int): Int => z << " << (n % 8) << "\n"
+     << "if (a" << n << " > " << n << ") { f" << n << "(1, (2, \"s\")) } else { 0x" << std::hex << n << std::dec << " }\n"
+     << "type L" << n << " = List[Int]\n";
+  return ss.str();
+}
+
+std::string printResult(nth::Driver &d) {
+  if (!d.result) return "<no result>";
+  nth::AstStringPrinter printer;
+  d.result->accept(printer);
+  return printer.getOutput();
+}
+
+}
+
+TEST_F(DriverTest, ConcurrentParsesMatchSequential) {
+  const int kFileCount = 400;
+
+  char dirTemplate[] = "/tmp/nth-driver-test-XXXXXX";
+  ASSERT_NE(nullptr, mkdtemp(dirTemplate));
+  std::string dir(dirTemplate);
+
+  std::vector<std::string> sources;
+  std::vector<std::string> paths;
+  for (int i=0; i<kFileCount; ++i) {
+    sources.push_back(generateSource(i));
+    paths.push_back(dir + "/" + std::to_string(i) + ".nth");
+    std::ofstream out(paths.back());
+    out << sources.back();
+  }
+
+  // Single-threaded reference run
+  std::vector<std::string> expected;
+  for (int i=0; i<kFileCount; ++i) {
+    nth::Driver d;
+    ASSERT_EQ(0, d.parse(paths[i]));
+    expected.push_back(printResult(d));
+  }
+
+  // Alternate between files and in-memory strings so both entry points
+  // are exercised while other threads are scanning.
+  std::vector<std::string> actual(kFileCount);
+  std::vector<int> statuses(kFileCount, -1);
+  std::atomic<int> next(0);
+
+  unsigned threadCount = std::max(4u, std::thread::hardware_concurrency());
+  std::vector<std::thread> threads;
+  for (unsigned t=0; t<threadCount; ++t) {
+    threads.emplace_back([&]() {
+      int i;
+      while ((i = next++) < kFileCount) {
+        nth::Driver d;
+        statuses[i] = (i % 2) ? d.parse(paths[i]) : d.parseString(sources[i]);
+        actual[i] = printResult(d);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  for (int i=0; i<kFileCount; ++i) {
+    EXPECT_EQ(0, statuses[i]) << paths[i];
+    EXPECT_EQ(expected[i], actual[i]) << paths[i];
+    unlink(paths[i].c_str());
+  }
+  rmdir(dir.c_str());
+}
+
+TEST_F(DriverTest, SequentialParsesDoNotShareLocations) {
+  nth::Driver first;
+  nth::Driver second;
+
+  first.parseString("1\n2\n3\n");
+  second.parseString("4");
+
+  // Each driver's scanner tracks its own position
+  EXPECT_EQ(4u, first.location.end.line);
+  EXPECT_EQ(1u, second.location.end.line);
+}
+
+TEST_F(DriverTest, ParseBufferReadsOnlyGivenBytes) {
+  // Deliberately not NUL-terminated after the first statement
+  const char source[] = { '1', '0', '\n', '2', '0' };
+
+  nth::Driver d;
+  EXPECT_EQ(0, d.parseBuffer(source, 3));
+  EXPECT_EQ("block(integer(10))", printResult(d));
+
+  EXPECT_EQ(0, d.parseBuffer(source, sizeof(source)));
+  EXPECT_EQ("block(integer(10),integer(20))", printResult(d));
+}
+
+TEST_F(DriverTest, MappedAndStreamedFilesParseAlike) {
+  std::string path = getResourcePath() + "/nth.nth";
+
+  nth::Driver mapped;
+  ASSERT_EQ(0, mapped.parse(path));
+
+  nth::Driver streamed;
+  streamed.should_map_input = false;
+  ASSERT_EQ(0, streamed.parse(path));
+
+  EXPECT_EQ(printResult(streamed), printResult(mapped));
+  EXPECT_EQ(streamed.location.end.line, mapped.location.end.line);
+}
+
+TEST_F(DriverTest, TokenTextOutlivesScannerBuffer) {
+  // Far more input than flex's buffer holds, so token text it hands out
+  // early has been overwritten by the time scanning ends
+  std::stringstream ss;
+  for (int i = 0; i < 20000; ++i) {
+    ss << "identifier" << i << " \"string\\t" << i << "\"\n";
+  }
+  std::string source = ss.str();
+
+  for (int simd = 0; simd < 2; ++simd) {
+    nth::Driver d;
+    d.should_use_simd_lexer = simd;
+    d.scanBuffer(source.data(), source.size());
+
+    std::vector<nth::StringRef> text;
+    for (;;) {
+      yy::parser::symbol_type symbol = d.lex();
+      if (symbol.kind() == yy::parser::symbol_kind::S_YYEOF) break;
+      text.push_back(symbol.value.as<nth::StringRef>());
+    }
+
+    ASSERT_EQ(40000u, text.size());
+    for (int i = 0; i < 20000; ++i) {
+      EXPECT_EQ("identifier" + std::to_string(i), text[2 * i].str());
+      EXPECT_EQ("string\t" + std::to_string(i), text[2 * i + 1].str());
+    }
+    d.scanEnd();
+  }
+}
+
+TEST_F(DriverTest, StreamedStatementsMatchWholeParse) {
+  std::string source;
+  for (int i = 0; i < 50; ++i) {
+    source += generateSource(i);
+  }
+
+  nth::Driver whole;
+  ASSERT_EQ(0, whole.parseString(source));
+  std::vector<std::string> expected;
+  for (nth::ASTNode *statement : whole.result->getNodes()) {
+    nth::AstStringPrinter printer;
+    statement->accept(printer);
+    expected.push_back(printer.getOutput());
+  }
+
+  for (int simd = 0; simd < 2; ++simd) {
+    for (size_t chunkSize : { 1, 7, 4096 }) {
+      FILE *in = fmemopen(const_cast<char*>(source.data()), source.size(), "r");
+      ASSERT_NE(nullptr, in);
+
+      nth::Driver d;
+      d.should_use_simd_lexer = simd;
+      d.stream_chunk_size = chunkSize;
+      std::vector<std::string> actual;
+      EXPECT_EQ(0, d.parseStream(in, [&](nth::ASTNode *statement) {
+        nth::AstStringPrinter printer;
+        statement->accept(printer);
+        actual.push_back(printer.getOutput());
+      }));
+      fclose(in);
+
+      EXPECT_EQ(expected, actual) << "chunk size " << chunkSize;
+      EXPECT_EQ(whole.location.end.line, d.location.end.line);
+      ASSERT_NE(nullptr, d.result);
+      EXPECT_TRUE(d.result->getNodes().empty());
+    }
+  }
+}
+
+TEST_F(DriverTest, StreamedStatementsArriveBeforeInputEnds) {
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  FILE *in = fdopen(fds[0], "r");
+  ASSERT_NE(nullptr, in);
+
+  // Fills whole chunks, including enough of the next statement to show
+  // where the first one ends
+  std::string first = "val a: Int = 1\n2";
+  first.resize(32, ' ');
+  std::string rest = "\n3\n";
+
+  std::mutex mutex;
+  std::condition_variable arrived;
+  int count = 0;
+  bool deliveredEarly = false;
+
+  std::thread writer([&]() {
+    EXPECT_EQ(static_cast<ssize_t>(first.size()), write(fds[1], first.data(), first.size()));
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      deliveredEarly = arrived.wait_for(lock, std::chrono::seconds(10),
+                                        [&]() { return count > 0; });
+    }
+    EXPECT_EQ(static_cast<ssize_t>(rest.size()), write(fds[1], rest.data(), rest.size()));
+    close(fds[1]);
+  });
+
+  nth::Driver d;
+  d.stream_chunk_size = 8;
+  EXPECT_EQ(0, d.parseStream(in, [&](nth::ASTNode *) {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++count;
+    arrived.notify_all();
+  }));
+  writer.join();
+  fclose(in);
+
+  EXPECT_TRUE(deliveredEarly);
+  EXPECT_EQ(3, count);
+}
+
+TEST_F(DriverTest, StreamedNamesAreLetGoAsTheyGo) {
+  std::string source;
+  for (int i = 0; i < 2000; ++i) {
+    source += "val n" + std::to_string(i) + ": Int = m" + std::to_string(i) + "\n";
+  }
+  FILE *in = fmemopen(const_cast<char*>(source.data()), source.size(), "r");
+  ASSERT_NE(nullptr, in);
+
+  // No more than the last two statements' names are held at a time
+  size_t before = nth::Name::count();
+  size_t most = 0;
+  nth::Driver d;
+  d.stream_chunk_size = 64;
+  EXPECT_EQ(0, d.parseStream(in, [&](nth::ASTNode *) {
+    most = std::max(most, nth::Name::count() - before);
+  }));
+  fclose(in);
+
+  EXPECT_LE(most, 6u);
+  EXPECT_EQ(before, nth::Name::count());
+  delete d.result;
+}
+
+TEST_F(DriverTest, PushedStatementsMatchWholeParse) {
+  std::string source;
+  for (int i = 0; i < 50; ++i) {
+    source += generateSource(i);
+  }
+
+  nth::Driver whole;
+  ASSERT_EQ(0, whole.parseString(source));
+  std::vector<std::string> expected;
+  for (nth::ASTNode *statement : whole.result->getNodes()) {
+    nth::AstStringPrinter printer;
+    statement->accept(printer);
+    expected.push_back(printer.getOutput());
+  }
+
+  for (int simd = 0; simd < 2; ++simd) {
+    for (size_t chunkSize : { 1, 7, 4096 }) {
+      nth::Driver d;
+      d.should_use_simd_lexer = simd;
+      std::vector<std::string> actual;
+      d.pushBegin([&](nth::ASTNode *statement) {
+        nth::AstStringPrinter printer;
+        statement->accept(printer);
+        actual.push_back(printer.getOutput());
+      });
+
+      for (size_t i = 0; i < source.size(); i += chunkSize) {
+        // Each chunk is gone once it's been fed
+        std::string chunk = source.substr(i, chunkSize);
+        d.feed(chunk.data(), chunk.size());
+        chunk.assign(chunk.size(), '#');
+      }
+      // All but the last statement, which could yet go on
+      EXPECT_EQ(expected.size() - 1, actual.size()) << "chunk size " << chunkSize;
+
+      EXPECT_EQ(0, d.finish());
+      EXPECT_EQ(expected, actual) << "chunk size " << chunkSize;
+      EXPECT_EQ(whole.location.end.line, d.location.end.line);
+    }
+  }
+}
+
+TEST_F(DriverTest, PushesManyInputsOnOneThread) {
+  // Interleaved feeds to separate drivers, as from connections served by
+  // one event loop
+  const int kInputs = 20;
+  std::vector<std::string> sources;
+  std::vector<std::unique_ptr<nth::Driver>> drivers;
+  std::vector<int> counts(kInputs);
+  for (int i = 0; i < kInputs; ++i) {
+    sources.push_back(generateSource(i));
+    bool simd = i % 2;
+    drivers.emplace_back(new nth::Driver);
+    drivers[i]->should_use_simd_lexer = simd;
+    drivers[i]->pushBegin([&counts, i](nth::ASTNode *) { ++counts[i]; });
+  }
+
+  for (size_t offset = 0; offset < sources[0].size() + 100; offset += 3) {
+    for (int i = 0; i < kInputs; ++i) {
+      if (offset < sources[i].size()) {
+        size_t size = std::min<size_t>(3, sources[i].size() - offset);
+        drivers[i]->feed(sources[i].data() + offset, size);
+      }
+    }
+  }
+  for (int i = 0; i < kInputs; ++i) {
+    EXPECT_EQ(0, drivers[i]->finish());
+    EXPECT_EQ(8, counts[i]) << "input " << i;
+  }
+}
+
+TEST_F(DriverTest, PushReportsErrorsAndCanBeAbandoned) {
+  nth::Driver d;
+  int count = 0;
+  d.pushBegin([&](nth::ASTNode *) { ++count; });
+  std::string source = "val a: Int = )\n1\n2\n";
+  testing::internal::CaptureStderr();
+  d.feed(source.data(), source.size());
+  EXPECT_EQ(1, d.finish());
+  EXPECT_EQ("1.14: syntax error, unexpected )\n", testing::internal::GetCapturedStderr());
+  EXPECT_EQ(2, count);
+
+  // Left part way through a statement, then started over
+  d.pushBegin([&](nth::ASTNode *) { ++count; });
+  d.feed("def f(x: Int): Int { x +", 24);
+  d.pushBegin([&](nth::ASTNode *) { ++count; });
+  d.feed("3\n4", 3);
+  EXPECT_EQ(0, d.finish());
+  EXPECT_EQ(4, count);
+}
+
+namespace {
+
+// Lines of the type names of the top-level vals, which are about the only
+// nodes that keep their location
+std::vector<int> valTypeLines(nth::Driver &d) {
+  std::vector<int> lines;
+  for (nth::ASTNode *node : d.result->getNodes()) {
+    nth::VariableDef *val = dynamic_cast<nth::VariableDef *>(node);
+    nth::SimpleTypeRef *type = val ? dynamic_cast<nth::SimpleTypeRef *>(val->getVarType()) : nullptr;
+    if (type) lines.push_back(type->getName()->getLocation().begin.line);
+  }
+  return lines;
+}
+
+}
+
+TEST_F(DriverTest, ParallelParseMatchesSequential) {
+  std::string source;
+  for (int i = 0; source.size() < 4 * nth::kMinimumStatementGroupSize; ++i) {
+    source += generateSource(i);
+  }
+
+  nth::Driver sequential;
+  ASSERT_EQ(0, sequential.parseString(source));
+
+  nth::Driver parallel;
+  parallel.parser_threads = 4;
+  ASSERT_EQ(0, parallel.parseString(source));
+  EXPECT_EQ(printResult(sequential), printResult(parallel));
+  EXPECT_EQ(valTypeLines(sequential), valTypeLines(parallel));
+  EXPECT_EQ(sequential.location.end.line, parallel.location.end.line);
+  EXPECT_EQ(sequential.location.end.column, parallel.location.end.column);
+
+  char path[] = "/tmp/nth-parallel-test-XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_NE(-1, fd);
+  ASSERT_EQ(static_cast<ssize_t>(source.size()), write(fd, source.data(), source.size()));
+  close(fd);
+  nth::Driver mapped;
+  mapped.parser_threads = 4;
+  EXPECT_EQ(0, mapped.parse(path));
+  EXPECT_EQ(printResult(sequential), printResult(mapped));
+  unlink(path);
+}
+
+TEST_F(DriverTest, ParallelParseReportsErrorsAsSequential) {
+  std::string source;
+  for (int i = 0; source.size() < 4 * nth::kMinimumStatementGroupSize; ++i) {
+    source += generateSource(i);
+    // A statement cut across a line at the top level, and errors
+    if (i == 1000) source += "val broken: Int =\n  1 + 2\n";
+    if (i == 2000) source += "val a: Int = )\n";
+    if (i == 3000) source += "[1, 2\n";
+  }
+
+  nth::Driver sequential;
+  testing::internal::CaptureStderr();
+  int expectedStatus = sequential.parseString(source);
+  std::string expectedErrors = testing::internal::GetCapturedStderr();
+
+  nth::Driver parallel;
+  parallel.parser_threads = 4;
+  testing::internal::CaptureStderr();
+  EXPECT_EQ(expectedStatus, parallel.parseString(source));
+  EXPECT_EQ(expectedErrors, testing::internal::GetCapturedStderr());
+  EXPECT_EQ(printResult(sequential), printResult(parallel));
+  EXPECT_EQ(sequential.getErrorCount(), parallel.getErrorCount());
+}
+
+namespace {
+
+// Replaces removed bytes of text at offset with inserted, returning the
+// edit as reparse takes it
+nth::Driver::Edit applyEdit(std::string &text, size_t offset, size_t removed,
+                            const std::string &inserted) {
+  auto positionOf = [&](size_t offset) {
+    yy::position position;
+    for (size_t i = 0; i < offset; ++i) {
+      if (text[i] == '\n') {
+        position.lines(1);
+      } else {
+        position.columns(1);
+      }
+    }
+    return position;
+  };
+  nth::Driver::Edit edit = { positionOf(offset), positionOf(offset + removed), inserted.size() };
+  text.replace(offset, removed, inserted);
+  return edit;
+}
+
+}
+
+TEST_F(DriverTest, ReparseKeepsUntouchedStatements) {
+  std::string text = "val a: Int = 11\nval b: Int = 22\nval c: Int = 33\nval d: Int = 44\n";
+  nth::Driver d;
+  ASSERT_EQ(0, d.parseString(text));
+  nth::NodeList before = d.result->getNodes();
+
+  // Within b's value, and then a new line ahead of c
+  EXPECT_EQ(0, d.reparse(d.result, text.data(), text.size(), applyEdit(text, 29, 1, "20")));
+  nth::NodeList after = d.result->getNodes();
+  ASSERT_EQ(4u, after.size());
+  EXPECT_EQ(before[0], after[0]);
+  EXPECT_NE(before[1], after[1]);
+  EXPECT_EQ(before[2], after[2]);
+  EXPECT_EQ(before[3], after[3]);
+  EXPECT_EQ(std::vector<int>({ 1, 2, 3, 4 }), valTypeLines(d));
+
+  EXPECT_EQ(0, d.reparse(d.result, text.data(), text.size(), applyEdit(text, 32, 0, "\n\n")));
+  EXPECT_EQ(before[3], d.result->getNodes()[3]);
+  EXPECT_EQ(std::vector<int>({ 1, 2, 5, 6 }), valTypeLines(d));
+
+  nth::Driver whole;
+  ASSERT_EQ(0, whole.parseString(text));
+  EXPECT_EQ(printResult(whole), printResult(d));
+  delete d.result;
+}
+
+TEST_F(DriverTest, ReparseMatchesWholeParse) {
+  std::string text;
+  for (int i = 0; i < 20; ++i) {
+    text += generateSource(i);
+  }
+  nth::Driver incremental;
+  ASSERT_EQ(0, incremental.parseString(text));
+
+  // Random edits, each followed by its undoing, so that most begin from
+  // input free of errors
+  const char *pieces[] = {
+    "x", "1", " ", "\n", "(", ")", "{", "}", "[", "]", "\"", ",", "+", "!", "else",
+    "/*", "*/", "//", "#{", "val v: Int = 9\n", "\n(1)", "\n[2]",
+  };
+  std::mt19937 random(15);
+  for (int round = 0; round < 600; ++round) {
+    size_t offset = random() % (text.size() + 1);
+    size_t removed = std::min<size_t>(random() % 3 ? 0 : random() % 6, text.size() - offset);
+    std::string inserted = removed && random() % 2 ? "" : pieces[random() % 22];
+    std::string original = text.substr(offset, removed);
+
+    for (int undo = 0; undo < 2; ++undo) {
+      nth::Driver::Edit edit = undo ? applyEdit(text, offset, inserted.size(), original)
+                                    : applyEdit(text, offset, removed, inserted);
+      testing::internal::CaptureStderr();
+      int status = incremental.reparse(incremental.result, text.data(), text.size(), edit);
+      std::string errors = testing::internal::GetCapturedStderr();
+
+      nth::Driver whole;
+      testing::internal::CaptureStderr();
+      EXPECT_EQ(whole.parseString(text), status) << text;
+      EXPECT_EQ(testing::internal::GetCapturedStderr(), errors) << text;
+      ASSERT_EQ(printResult(whole), printResult(incremental)) << text;
+      if (whole.result) {
+        ASSERT_EQ(valTypeLines(whole), valTypeLines(incremental)) << text;
+      }
+      delete whole.result;
+    }
+  }
+  delete incremental.result;
+}
+
+TEST_F(DriverTest, SyntaxOnlyReportsErrorsAsFullParse) {
+  std::string clean, broken;
+  for (int i = 0; clean.size() < 4 * nth::kMinimumStatementGroupSize; ++i) {
+    clean += generateSource(i);
+  }
+  broken = clean + "val a: Int = )\n[1, 2\nif (x) { def f(: Int { 1 } }\n";
+
+  for (const std::string *source : { &clean, &broken }) {
+    nth::Driver full;
+    testing::internal::CaptureStderr();
+    int expectedStatus = full.parseString(*source);
+    std::string expectedErrors = testing::internal::GetCapturedStderr();
+    delete full.result;
+
+    for (unsigned threads = 1; threads <= 4; threads *= 4) {
+      nth::Driver check;
+      check.should_build_ast = false;
+      check.parser_threads = threads;
+      testing::internal::CaptureStderr();
+      EXPECT_EQ(expectedStatus, check.parseString(*source)) << threads;
+      EXPECT_EQ(expectedErrors, testing::internal::GetCapturedStderr()) << threads;
+      EXPECT_EQ(full.getErrorCount(), check.getErrorCount()) << threads;
+      EXPECT_EQ(nullptr, check.result) << threads;
+    }
+  }
+}
+
+namespace {
+
+std::vector<nth::FunctionDef *> topLevelFunctions(nth::Block *block) {
+  std::vector<nth::FunctionDef *> functions;
+  for (nth::ASTNode *node : block->getNodes()) {
+    nth::FunctionDef *function = dynamic_cast<nth::FunctionDef *>(node);
+    if (function) functions.push_back(function);
+  }
+  return functions;
+}
+
+}
+
+TEST_F(DriverTest, OutlineParsesFunctionBlocksOnDemand) {
+  std::string source;
+  for (int i = 0; i < 10; ++i) {
+    source += generateSource(i);
+  }
+  source +=
+    "def braces(): String {\n"
+    "  val s: String = \"} #{ {\"k\": 1}[\"k\"] } {\"\n"
+    "  // }\n"
+    "  /* { */\n"
+    "  def inner(): Int { {\"a\": 1}[\"a\"] }\n"
+    "  s\n"
+    "}\n";
+
+  nth::Driver full;
+  ASSERT_EQ(0, full.parseString(source));
+
+  nth::Driver outline;
+  outline.should_outline = true;
+  ASSERT_EQ(0, outline.parseString(source));
+  std::vector<nth::FunctionDef *> functions = topLevelFunctions(outline.result);
+  ASSERT_EQ(11u, functions.size());
+  for (nth::FunctionDef *function : functions) {
+    EXPECT_FALSE(function->isBlockParsed());
+  }
+
+  // Printing the tree parses every block
+  EXPECT_EQ(printResult(full), printResult(outline));
+  for (nth::FunctionDef *function : functions) {
+    EXPECT_TRUE(function->isBlockParsed());
+  }
+
+  // Locations in a block are where they'd be had it been parsed in place
+  yy::location expected = topLevelFunctions(full.result).back()->getBlock()->getNodes().back()->getLocation();
+  yy::location found = functions.back()->getBlock()->getNodes().back()->getLocation();
+  EXPECT_EQ(expected.begin.line, found.begin.line);
+  EXPECT_EQ(expected.begin.column, found.begin.column);
+
+  // A mapped file stays mapped for the blocks still to be parsed
+  char path[] = "/tmp/nth-outline-test-XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_NE(-1, fd);
+  ASSERT_EQ(static_cast<ssize_t>(source.size()), write(fd, source.data(), source.size()));
+  close(fd);
+  std::unique_ptr<nth::Block> mapped;
+  {
+    nth::Driver driver;
+    driver.should_outline = true;
+    EXPECT_EQ(0, driver.parse(path));
+    mapped.reset(driver.result);
+  }
+  unlink(path);
+  nth::AstStringPrinter printer;
+  mapped->accept(printer);
+  EXPECT_EQ(printResult(full), printer.getOutput());
+}
+
+TEST_F(DriverTest, OutlineReparseFindsBlocksInEditedInput) {
+  std::string text = "def e(): Int { 7 }\nval a: Int = 1\nval b: Int = 2\ndef f(): Int { b }\n";
+  nth::Driver d;
+  d.should_outline = true;
+  ASSERT_EQ(0, d.parseString(text));
+  nth::FunctionDef *f = topLevelFunctions(d.result).back();
+
+  // Ahead of both functions, which reparses e along with the new line, and
+  // then after e with a function of its own, which keeps e
+  EXPECT_EQ(0, d.reparse(d.result, text.data(), text.size(), applyEdit(text, 0, 0, "val z: Int = 0\n")));
+  nth::FunctionDef *e = topLevelFunctions(d.result).front();
+  EXPECT_EQ(0, d.reparse(d.result, text.data(), text.size(),
+                         applyEdit(text, 49, 0, "def g(): Int { 5 }\n")));
+  std::vector<nth::FunctionDef *> functions = topLevelFunctions(d.result);
+  ASSERT_EQ(3u, functions.size());
+  EXPECT_EQ(e, functions[0]);
+  EXPECT_EQ(f, functions[2]);
+  for (nth::FunctionDef *function : functions) {
+    EXPECT_FALSE(function->isBlockParsed());
+  }
+
+  nth::Driver whole;
+  ASSERT_EQ(0, whole.parseString(text));
+  testing::internal::CaptureStderr();
+  EXPECT_EQ(printResult(whole), printResult(d));
+  EXPECT_EQ("", testing::internal::GetCapturedStderr());
+
+  yy::location expected = topLevelFunctions(whole.result).back()->getBlock()->getNodes().back()->getLocation();
+  yy::location found = functions.back()->getBlock()->getNodes().back()->getLocation();
+  EXPECT_EQ(expected.begin.line, found.begin.line);
+  EXPECT_EQ(expected.begin.column, found.begin.column);
+  delete whole.result;
+  delete d.result;
+}
+
+TEST_F(DriverTest, OutlineReportsErrorsInBlocksWhenParsed) {
+  // The blocks are parsed from the input, which has to outlive them
+  std::string source = "def f(): Int {\n  1 +\n}\nval a: Int = 1\n";
+  nth::Driver outline;
+  outline.should_outline = true;
+  testing::internal::CaptureStderr();
+  EXPECT_EQ(0, outline.parseString(source));
+  EXPECT_EQ("", testing::internal::GetCapturedStderr());
+
+  std::vector<nth::FunctionDef *> functions = topLevelFunctions(outline.result);
+  ASSERT_EQ(1u, functions.size());
+  testing::internal::CaptureStderr();
+  ASSERT_NE(nullptr, functions[0]->getBlock());
+  std::string errors = testing::internal::GetCapturedStderr();
+  // Where a whole parse would report it, though at the end of the block's
+  // input rather than its "}"
+  EXPECT_EQ(0u, errors.find("2.6-3.")) << errors;
+}
@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include "driver.h"
+#include "flat_ast.h"
+#include "scope_checker.h"
+
+class FlatASTTest : public ::testing::Test {
+protected:
+  nth::Driver d;
+  virtual void SetUp() {}
+};
+
+TEST_F(FlatASTTest, LaysNodesOutDepthFirst) {
+  ASSERT_EQ(0, d.parseString("1 + x\nf(2.5)"));
+  nth::FlatAST flat(d.result);
+
+  typedef nth::FlatAST::Kind Kind;
+  ASSERT_EQ(7u, flat.size());
+  EXPECT_EQ(Kind::Block, flat.getKind(0));
+  EXPECT_EQ(7u, flat.getEnd(0));
+  EXPECT_EQ(2u, flat.getChildCount(0));
+
+  EXPECT_EQ(1u, flat.getChild(0, 0));
+  EXPECT_EQ(Kind::Add, flat.getKind(1));
+  EXPECT_EQ(4u, flat.getEnd(1));
+  EXPECT_EQ(1, flat.getInteger(2));
+  EXPECT_EQ(nth::Name("x"), flat.getName(3));
+
+  EXPECT_EQ(4u, flat.getChild(0, 1));
+  EXPECT_EQ(Kind::FunctionCall, flat.getKind(4));
+  EXPECT_EQ(nth::Name("f"), flat.getName(flat.getChild(4, 0)));
+  EXPECT_EQ(2.5, flat.getFloat(flat.getChild(4, 1)));
+  delete d.result;
+}
+
+TEST_F(FlatASTTest, KeepsLocations) {
+  ASSERT_EQ(0, d.parseString("a.b"));
+  nth::FlatAST flat(d.result);
+  delete d.result;
+
+  // Only the field's identifier was given a location by the parser
+  ASSERT_EQ(nth::FlatAST::Kind::Identifier, flat.getKind(3));
+  ASSERT_NE(nullptr, flat.getLocation(3));
+  EXPECT_EQ(3u, flat.getLocation(3)->begin.column);
+  EXPECT_EQ(nullptr, flat.getLocation(2));
+
+  nth::ASTNode *inflated = flat.inflate();
+  nth::FieldAccess *access = static_cast<nth::FieldAccess*>(
+    static_cast<nth::Block*>(inflated)->getNodes()[0]);
+  EXPECT_EQ(3u, access->getField().getLocation().begin.column);
+  delete inflated;
+}
+
+TEST_F(FlatASTTest, InflatesForVisitors) {
+  ASSERT_EQ(0, d.parseString("def twice[T](a: T): T { a + b }"));
+  nth::FlatAST flat(d.result);
+  delete d.result;
+
+  nth::ASTContext *context = new nth::ASTContext;
+  nth::ASTNode *inflated = flat.inflate(0, context);
+  context->release(inflated);
+
+  nth::ScopeChecker scopeChecker(*new nth::SymbolTable());
+  scopeChecker.run(static_cast<nth::Block*>(inflated));
+  EXPECT_FALSE(scopeChecker.isValid());
+  ASSERT_EQ(1u, scopeChecker.getUnknownIdentifiers().size());
+  EXPECT_EQ("b", scopeChecker.getUnknownIdentifiers().front()->getValue());
+  delete inflated;
+}
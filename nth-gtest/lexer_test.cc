@@ -0,0 +1,307 @@
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+#include "test_helper.h"
+#include "ast.h"
+#include "ast_string_printer.h"
+#include "driver.h"
+#include "parallel_lexer.h"
+
+class LexerTest : public ::testing::Test {
+protected:
+  virtual void SetUp() {}
+};
+
+namespace {
+
+// Tokens of source read from a stream chunkSize bytes at a time, followed
+// by whatever was reported on stderr along the way
+std::vector<std::string> tokenizeStream(const std::string &source, size_t chunkSize) {
+  FILE *in = fmemopen(const_cast<char*>(source.data()), source.size(), "r");
+  if (source.empty()) in = fopen("/dev/null", "r");
+
+  nth::Driver d;
+  d.should_use_simd_lexer = true;
+  d.stream_chunk_size = chunkSize;
+  testing::internal::CaptureStderr();
+  d.scanStream(in);
+
+  std::vector<std::string> tokens;
+  for (;;) {
+    yy::parser::symbol_type symbol = d.lex();
+    tokens.push_back(describeToken(symbol));
+    if (symbol.kind() == yy::parser::symbol_kind::S_YYEOF) break;
+  }
+  d.scanEnd();
+  tokens.push_back(testing::internal::GetCapturedStderr());
+  fclose(in);
+  return tokens;
+}
+
+// Tokens of source lexed in the given number of chunks at once, followed
+// by whatever was reported on stderr along the way
+std::vector<std::string> tokenizeInParallel(const std::string &source, size_t chunks) {
+  nth::Driver d;
+  testing::internal::CaptureStderr();
+  nth::ParallelLexer lexer(d, source.data(), source.data() + source.size(), chunks);
+
+  std::vector<std::string> tokens;
+  for (;;) {
+    yy::parser::symbol_type symbol = lexer.lex();
+    tokens.push_back(describeToken(symbol));
+    if (symbol.kind() == yy::parser::symbol_kind::S_YYEOF) break;
+  }
+  tokens.push_back(testing::internal::GetCapturedStderr());
+  return tokens;
+}
+
+std::vector<std::string> tokenize(const char *buf, size_t size, bool simd) {
+  nth::Driver d;
+  d.should_use_simd_lexer = simd;
+  d.scanBuffer(buf, size);
+
+  std::vector<std::string> tokens;
+  for (;;) {
+    yy::parser::symbol_type symbol = d.lex();
+    tokens.push_back(describeToken(symbol));
+    if (symbol.kind() == yy::parser::symbol_kind::S_YYEOF) break;
+  }
+  d.scanEnd();
+  return tokens;
+}
+
+void expectSameTokens(const std::string &source) {
+  std::vector<std::string> flex = tokenize(source.data(), source.size(), false);
+  std::vector<std::string> simd = tokenize(source.data(), source.size(), true);
+  ASSERT_EQ(flex.size(), simd.size()) << source;
+  for (size_t i = 0; i < flex.size(); ++i) {
+    ASSERT_EQ(flex[i], simd[i]) << "token " << i << " of:\n" << source;
+  }
+}
+
+std::string readFile(const std::string &path) {
+  std::ifstream in(path);
+  std::stringstream contents;
+  contents << in.rdbuf();
+  return contents.str();
+}
+
+}
+
+TEST_F(LexerTest, MatchesFlexOnExamples) {
+  std::string source = readFile(getResourcePath() + "/nth.nth");
+  ASSERT_FALSE(source.empty());
+  expectSameTokens(source);
+}
+
+TEST_F(LexerTest, MatchesFlexOnTokenEdgeCases) {
+  const char *cases[] = {
+    "", "\n", "   ", "s", "val s: Int = 1",
+    "1 -1 +1 1-1 a-1 0 00 07 08 089.5 0x1f 0xg 0b101 0b2 -0x10",
+    "1.5 1.5e3 1.5E-3 1e5 0e5 1.e5 1..10 1...3 .5 1.2.3 t.0 1e 1e+",
+    "9999999999999999999999 0x7fffffffffffffffff",
+    "9223372036854775807 9223372036854775808 -9223372036854775808 -9223372036854775809",
+    "0x8000000000000000 0b11111111111111111111111111111111111111111111111111111111111111111",
+    "01777777777777777777777 1e308 1e309 1e-400 4.9e-324 0.0e999 1.7976931348623157e308",
+    "a=b a==b a=>b a!=b !a a<b a<=b a<<b a>b a>=b a>>b a&b a&&b a|b a||b",
+    ". .. ... .... ,()[]{}:; ^ % ~ * /",
+    "if else def val class type true false iff elsewhere _a a_1 A9",
+    "\"\" \"abc\" \"a\\\"b\" \"a\\\\\" \"x\" \"line\nbreak\" \"a\\\"b\\\"c\"",
+    "\"unterminated", "\"escaped at end\\\"", "\"a\\\"b", "\"ends in \\",
+    "\"\\n\\t\\r\\0\\'\\#{\\q\\\n\" x", "\"# #x #\"",
+    "\"a#{b}c\" \"#{}\" \"#{1}#{2}\" \"#{ {\"k\": {}} }\"",
+    "\"outer #{\"inner #{x + \"innermost\"}\"} done\"",
+    "\"#{ /* } */ x // }\n}\"", "\"#{x", "\"#{\"", "}",
+    "// line comment\nx // trailing", "//", "a/**/b", "/* multi\nline\n*/x",
+    "/* stars ** * / */ y", "/**/", "/* unterminated\n",
+    "a @ b # c $ \r\n d ` e ? \\ f '",
+    "x\n\n  \t y \n\t\n z",
+    "caf\xc3\xa9 \xce\xb1\xce\xb2 \xe5\x90\x8d\xe5\x89\x8d e\xcc\x81 x\xd9\xa0 if\xc3\xa9",
+    "\xe2\x82\xac \xe2\x82\xacx a\xe2\x82\xac" "b \xcc\x81 \xf0\x9f\x98\x80 _\xc3\xa9 1\xc3\xa9",
+    "\xff \x80" "a \xc3 \xc3( a\xe2\x82 \xed\xa0\x80 \xf4\x90\x80\x80",
+    "\"\xc3\xa9\xff\xe2\x82\xac\" \"\\\xc3\xa9\\\xff\" \"#{\xc3\xa9}\xe2\x82\"",
+    "// \xc3\xa9 \xff \x80\x80\nx /* \xc3\xa9 \xff\n\xe2\x82 */ y",
+  };
+  for (const char *source : cases) {
+    expectSameTokens(source);
+  }
+}
+
+TEST_F(LexerTest, MatchesFlexAcrossVectorWidths) {
+  // Runs of each kind both shorter and longer than a vector, ending at
+  // every offset within one
+  std::stringstream ss;
+  for (int n = 0; n < 70; ++n) {
+    std::string run(n, 'x');
+    ss << "i" << run << "_9 "
+       << std::string(n, ' ') << "\t"
+       << "1" << std::string(n, '0') << " "
+       << "\"" << std::string(n, 's') << "\" "
+       << "// " << run << "\n"
+       << "/* " << run << "*" << run << "\n" << run << " */\n";
+  }
+  expectSameTokens(ss.str());
+}
+
+TEST_F(LexerTest, NeverReadsPastEndOfBuffer) {
+  // Put the source flush against an inaccessible page
+  size_t pageSize = sysconf(_SC_PAGESIZE);
+  char *pages = static_cast<char*>(mmap(nullptr, pageSize * 2, PROT_READ | PROT_WRITE,
+                                        MAP_PRIVATE | MAP_ANON, -1, 0));
+  ASSERT_NE(MAP_FAILED, pages);
+  ASSERT_EQ(0, mprotect(pages + pageSize, pageSize, PROT_NONE));
+
+  const char *sources[] = {
+    "val abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz",
+    "123456789012345678901234567890123456789012345678901234567890",
+    "\"abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz",
+    "/* abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz",
+    "x                                                            ",
+    "1.5e", "0x", "..",
+  };
+  for (const char *source : sources) {
+    size_t size = strlen(source);
+    char *start = pages + pageSize - size;
+    memcpy(start, source, size);
+    std::vector<std::string> tokens = tokenize(start, size, true);
+    EXPECT_EQ(tokens, tokenize(source, size, false));
+  }
+
+  munmap(pages, pageSize * 2);
+}
+
+TEST_F(LexerTest, StreamsAcrossChunkBoundaries) {
+  // Every token and diagnostic the same as when scanned from memory,
+  // wherever the chunks happen to split the input
+  std::vector<std::string> sources = {
+    readFile(getResourcePath() + "/nth.nth"),
+    "", "1.5e+3 1.5e+ 0x1f 0x 1...3 1..2 a.b", "identifier_of_some_length 12345678",
+    "\"a\\\"b#{ {\"k\": \"#{x}\"} }c\" \"# #\\n\" \"\\q\"",
+    "/* comment\n * spanning */ x // line\n$ @ y", "\"unterminated", "/* unterminated",
+    "\xce\xb1\xce\xb2\xce\xb3 \"\xe2\x82\xac\xff\" // \xf0\x9f\x98\x80\xc3\n\xe5\x90\x8d \xe2\x82",
+  };
+  for (const std::string &source : sources) {
+    testing::internal::CaptureStderr();
+    std::vector<std::string> expected = tokenize(source.data(), source.size(), true);
+    expected.push_back(testing::internal::GetCapturedStderr());
+
+    for (size_t chunkSize : { 1, 2, 3, 5, 8, 13, 64, 4096 }) {
+      EXPECT_EQ(expected, tokenizeStream(source, chunkSize))
+        << "chunk size " << chunkSize << " of:\n" << source;
+    }
+  }
+}
+
+TEST_F(LexerTest, LexesInParallelLikeOneThread) {
+  // With enough chunks, some begin inside every kind of comment and string,
+  // including one nested in an interpolation, which no guess covers, and
+  // ones that run through whole chunks
+  std::string source = readFile(getResourcePath() + "/nth.nth") +
+    "/* comment\n spanning\n lines */ x\n"
+    "\"string\nacross #{\"a\"}\nlines\" y\n"
+    "\"outer #{\n\"inner\nstring\" + \"#{\n{ \"k\": 1 }\n}\"\n} tail\"\n"
+    "val a = 1 $ 2 // invalid character\n"
+    "\"escape \\q\n\" 99999999999999999999 1e999\n"
+    "val \xce\xb1 = \"\xe2\x82\xac\xff\" /* \xc3 */ // \xff\n"
+    "/*\n\n\n\n\n\n\n\n\n\n*/ \"\n\n\n\n\n\n\n\n\n\n\"\n"
+    "/* unterminated\n\n";
+
+  testing::internal::CaptureStderr();
+  std::vector<std::string> expected = tokenize(source.data(), source.size(), true);
+  expected.push_back(testing::internal::GetCapturedStderr());
+
+  for (size_t chunks : { 1, 2, 3, 7, 16, 64, 1000 }) {
+    std::vector<std::string> tokens = tokenizeInParallel(source, chunks);
+    ASSERT_EQ(expected.size(), tokens.size()) << chunks << " chunks";
+    for (size_t i = 0; i < expected.size(); ++i) {
+      ASSERT_EQ(expected[i], tokens[i]) << "token " << i << " of " << chunks << " chunks";
+    }
+  }
+}
+
+TEST_F(LexerTest, LexesLargeInputInParallel) {
+  std::string example = readFile(getResourcePath() + "/nth.nth");
+  std::string source;
+  while (source.size() < 3 * nth::ParallelLexer::kMinimumChunkSize) {
+    source += example;
+  }
+  std::vector<std::string> expected = tokenize(source.data(), source.size(), true);
+
+  nth::Driver d;
+  d.should_use_simd_lexer = true;
+  d.lexer_threads = 4;
+  d.scanBuffer(source.data(), source.size());
+  std::vector<std::string> tokens;
+  for (;;) {
+    yy::parser::symbol_type symbol = d.lex();
+    tokens.push_back(describeToken(symbol));
+    if (symbol.kind() == yy::parser::symbol_kind::S_YYEOF) break;
+  }
+  d.scanEnd();
+  EXPECT_EQ(expected, tokens);
+}
+
+TEST_F(LexerTest, AcceptsUnicodeIdentifiers) {
+  std::string source = "caf\xc3\xa9 e\xcc\x81t\xc3\xa9 \xe5\x90\x8d\xe5\x89\x8d x\xd9\xa0";
+  testing::internal::CaptureStderr();
+  std::vector<std::string> tokens = tokenize(source.data(), source.size(), true);
+  EXPECT_EQ("", testing::internal::GetCapturedStderr());
+  std::vector<std::string> expected = {
+    "IDENT(caf\xc3\xa9) @1.1-5", "IDENT(e\xcc\x81t\xc3\xa9) @1.7-12",
+    "IDENT(\xe5\x90\x8d\xe5\x89\x8d) @1.14-19", "IDENT(x\xd9\xa0) @1.21-23", "end of file @1.24",
+  };
+  EXPECT_EQ(expected, tokens);
+}
+
+TEST_F(LexerTest, ReportsEachCharacterOrMalformedByteOnce) {
+  // Characters that can't appear outside strings and comments are
+  // reported whole, and malformed bytes one at a time wherever they are
+  std::string source = "a\xe2\x82\xac\xe2\x82\xac" "b\n"
+                       "\xff\xc3(\n"
+                       "\"x\xffy\"\n"
+                       "// \xc0\xaf\n"
+                       "/* \xed\xa0\x80 */";
+  testing::internal::CaptureStderr();
+  std::vector<std::string> tokens = tokenize(source.data(), source.size(), true);
+  std::string errors = testing::internal::GetCapturedStderr();
+
+  std::vector<std::string> expected = {
+    "IDENT(a) @1.1", "IDENT(b) @1.2-8", "( @1.9-2.3", "STRING(x\xffy) @2.4-3.5",
+    "end of file @4.6-5.9",
+  };
+  EXPECT_EQ(expected, tokens);
+  EXPECT_EQ("1.2-4: invalid character\n"
+            "1.2-7: invalid character\n"
+            "1.9-2.1: invalid UTF-8\n"
+            "1.9-2.2: invalid UTF-8\n"
+            "2.4-3.3: invalid UTF-8\n"
+            "3.6-4.5: invalid UTF-8\n"
+            "3.6-4.5: invalid UTF-8\n"
+            "4.6-5.4: invalid UTF-8\n"
+            "4.6-5.5: invalid UTF-8\n"
+            "4.6-5.6: invalid UTF-8\n", errors);
+}
+
+TEST_F(LexerTest, ParsesLikeFlex) {
+  std::string source = readFile(getResourcePath() + "/nth.nth");
+  nth::AstStringPrinter flexPrinter, simdPrinter;
+
+  nth::Driver flex;
+  ASSERT_EQ(0, flex.parseString(source));
+  ASSERT_NE(nullptr, flex.result);
+  flex.result->accept(flexPrinter);
+
+  nth::Driver simd;
+  simd.should_use_simd_lexer = true;
+  ASSERT_EQ(0, simd.parseString(source));
+  ASSERT_NE(nullptr, simd.result);
+  simd.result->accept(simdPrinter);
+
+  EXPECT_EQ(flexPrinter.getOutput(), simdPrinter.getOutput());
+}
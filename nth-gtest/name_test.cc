@@ -0,0 +1,95 @@
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "ast.h"
+#include "driver.h"
+#include "flat_ast.h"
+#include "name.h"
+
+class NameTest : public ::testing::Test {
+protected:
+  virtual void SetUp() {}
+};
+
+TEST_F(NameTest, InternsSpellings) {
+  nth::Name foo("foo");
+  EXPECT_EQ(foo, nth::Name(std::string("foo")));
+  EXPECT_NE(foo, nth::Name("bar"));
+  EXPECT_STREQ("foo", foo.c_str());
+  EXPECT_EQ(0u, nth::Name().getId());
+  EXPECT_EQ("", nth::Name().str());
+}
+
+TEST_F(NameTest, CachesAgreeWithTheTable) {
+  nth::NameCache cache;
+  nth::Name first = cache.get(nth::StringRef("cached", 6));
+  EXPECT_EQ(nth::Name("cached"), first);
+  EXPECT_EQ(first, cache.get(nth::StringRef("cached", 6)));
+
+  nth::Identifier ident(first);
+  EXPECT_EQ(nth::Identifier("cached"), ident);
+}
+
+TEST_F(NameTest, InternsFromManyThreads) {
+  std::vector<std::vector<nth::Name>> seen(4);
+  std::vector<nth::NameCache> caches(4);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < seen.size(); t++) {
+    threads.emplace_back([&seen, &caches, t]() {
+      for (int i = 0; i < 1000; i++) {
+        std::string text = "threaded" + std::to_string(i);
+        seen[t].push_back(caches[t].get(nth::StringRef(text)));
+      }
+    });
+  }
+  for (auto &thread : threads) thread.join();
+
+  for (int i = 0; i < 1000; i++) {
+    nth::Name expected("threaded" + std::to_string(i));
+    for (auto &names : seen) EXPECT_EQ(expected, names[i]);
+    EXPECT_EQ("threaded" + std::to_string(i), expected.str());
+  }
+}
+
+TEST_F(NameTest, FreesNamesNoCacheHolds) {
+  size_t before = nth::Name::count();
+  nth::Name kept("kept for good");
+  {
+    nth::NameCache first, second;
+    for (int i = 0; i < 1000; i++) {
+      first.get(nth::StringRef("transient" + std::to_string(i)));
+    }
+    second.get(nth::StringRef("transient0"));
+    first.get(nth::StringRef("kept for good"));
+    EXPECT_EQ(before + 1001, nth::Name::count());
+
+    // Still held by the second cache
+    first.clear();
+    EXPECT_EQ(before + 2, nth::Name::count());
+    EXPECT_EQ("transient0", second.get(nth::StringRef("transient0")).str());
+  }
+  EXPECT_EQ(before + 1, nth::Name::count());
+  EXPECT_EQ("kept for good", kept.str());
+
+  // Ids are handed out again, and spellings found as before
+  nth::NameCache cache;
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_EQ("again" + std::to_string(i), cache.get(nth::StringRef("again" + std::to_string(i))).str());
+  }
+  EXPECT_EQ(kept, cache.get(nth::StringRef("kept for good")));
+}
+
+TEST_F(NameTest, TreesHoldTheirNames) {
+  size_t before = nth::Name::count();
+  nth::Driver driver;
+  ASSERT_EQ(0, driver.parseString("val only_in_this_tree: OnlyHereToo = 1\n"));
+  EXPECT_EQ(before + 2, nth::Name::count());
+
+  nth::FlatAST *flat = new nth::FlatAST(driver.result);
+  delete driver.result;
+  EXPECT_EQ(before + 2, nth::Name::count());
+  EXPECT_EQ("only_in_this_tree", flat->getName(2).str());
+  delete flat;
+  EXPECT_EQ(before, nth::Name::count());
+}
@@ -0,0 +1,149 @@
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "numeric_literal.h"
+
+class NumericLiteralTest : public ::testing::Test {
+protected:
+  virtual void SetUp() {}
+};
+
+namespace {
+
+bool decodeInteger(const std::string &digits, int base, long &value) {
+  return nth::decodeInteger(digits.data(), digits.data() + digits.size(), base, value);
+}
+
+bool decodeFloat(const std::string &text, double &value) {
+  return nth::decodeFloat(text.data(), text.data() + text.size(), value);
+}
+
+std::string formatBigInteger(const std::string &text) {
+  bool negative;
+  std::vector<uint32_t> magnitude;
+  nth::decodeBigInteger(text.data(), text.data() + text.size(), negative, magnitude);
+  return nth::formatBigInteger(negative, magnitude);
+}
+
+}
+
+TEST_F(NumericLiteralTest, DecodesIntegersLikeStrtol) {
+  const char *cases[][2] = {
+    { "0", "10" }, { "-0", "10" }, { "+7", "10" }, { "9223372036854775807", "10" },
+    { "-9223372036854775808", "10" }, { "00000000000000000000000042", "10" },
+    { "7fffffffffffffff", "16" }, { "DEADbeef", "16" },
+    { "111111111111111111111111111111111111111111111111111111111111111", "2" },
+    { "0777777777777777777777", "8" }, { "0", "8" },
+  };
+  for (auto &c : cases) {
+    long value = 0;
+    int base = atoi(c[1]);
+    ASSERT_TRUE(decodeInteger(c[0], base, value)) << c[0];
+    EXPECT_EQ(strtol(c[0], NULL, base), value) << c[0];
+  }
+
+  std::mt19937_64 random(42);
+  const int bases[] = { 2, 8, 10, 16 };
+  for (int i = 0; i < 10000; ++i) {
+    uint64_t n = random() >> (random() % 64);
+    int base = bases[i % 4];
+    char text[80];
+    switch (base) {
+      case 2: {
+        char *p = text + sizeof(text) - 1;
+        *p = '\0';
+        do { *--p = '0' + (n & 1); } while (n >>= 1);
+        memmove(text, p, strlen(p) + 1);
+        break;
+      }
+      case 8:  snprintf(text, sizeof(text), "%llo", (unsigned long long)n); break;
+      case 10: snprintf(text, sizeof(text), "%llu", (unsigned long long)n); break;
+      default: snprintf(text, sizeof(text), "%llx", (unsigned long long)n); break;
+    }
+
+    long value = 0;
+    errno = 0;
+    long expected = strtol(text, NULL, base);
+    EXPECT_EQ(errno != ERANGE, decodeInteger(text, base, value)) << text;
+    if (errno != ERANGE) {
+      EXPECT_EQ(expected, value) << text;
+    }
+  }
+}
+
+TEST_F(NumericLiteralTest, RejectsIntegersOutOfRange) {
+  long value;
+  EXPECT_FALSE(decodeInteger("9223372036854775808", 10, value));
+  EXPECT_FALSE(decodeInteger("-9223372036854775809", 10, value));
+  EXPECT_FALSE(decodeInteger("99999999999999999999999999", 10, value));
+  EXPECT_FALSE(decodeInteger("8000000000000000", 16, value));
+  EXPECT_FALSE(decodeInteger("1000000000000000000000", 8, value));
+  EXPECT_FALSE(decodeInteger("1" + std::string(63, '0'), 2, value));
+}
+
+TEST_F(NumericLiteralTest, DecodesFloatsLikeStrtod) {
+  const char *cases[] = {
+    "0.0", "-0.0", "1.5", "10.2340982", "2.234e-3", "1e22", "1e23", "123e25",
+    "9007199254740993.0", "0.1", "0.30000000000000004", "1.7976931348623157e308",
+    "2.2250738585072014e-308", "4.9e-324", "3.14159265358979323846264338327950288",
+    "0.000000000000000000000000000000001", "1e-22", "1e-23", "-5e+10",
+    "12345678901234567890123456789e-10", "100000000000000000000000.0",
+  };
+  for (const char *c : cases) {
+    double value = -1;
+    ASSERT_TRUE(decodeFloat(c, value)) << c;
+    double expected = strtod(c, NULL);
+    EXPECT_EQ(0, memcmp(&expected, &value, sizeof(value))) << c;
+  }
+
+  std::mt19937_64 random(42);
+  for (int i = 0; i < 20000; ++i) {
+    char text[64];
+    int digits = 1 + random() % 20;
+    int point = random() % digits;
+    std::string mantissa;
+    for (int j = 0; j < digits; ++j) {
+      mantissa += static_cast<char>('0' + random() % 10);
+    }
+    int exponent = static_cast<int>(random() % 80) - 40;
+    snprintf(text, sizeof(text), "%s.%se%d", mantissa.substr(0, point + 1).c_str(),
+             point + 1 < digits ? mantissa.substr(point + 1).c_str() : "0", exponent);
+
+    double value = -1;
+    ASSERT_TRUE(decodeFloat(text, value)) << text;
+    double expected = strtod(text, NULL);
+    EXPECT_EQ(0, memcmp(&expected, &value, sizeof(value))) << text;
+  }
+}
+
+TEST_F(NumericLiteralTest, RejectsFloatsOutOfRange) {
+  double value;
+  EXPECT_FALSE(decodeFloat("1e309", value));
+  EXPECT_TRUE(std::isinf(value));
+  EXPECT_FALSE(decodeFloat("-1.8e308", value));
+  EXPECT_FALSE(decodeFloat("1e-400", value));
+  EXPECT_EQ(0, value);
+  EXPECT_FALSE(decodeFloat("1e99999999999999999999", value));
+
+  EXPECT_TRUE(decodeFloat("0e99999", value));
+  EXPECT_EQ(0, value);
+}
+
+TEST_F(NumericLiteralTest, FormatsBigIntegers) {
+  EXPECT_EQ("0", formatBigInteger("0"));
+  EXPECT_EQ("9223372036854775808", formatBigInteger("9223372036854775808"));
+  EXPECT_EQ("-123456789012345678901234567890",
+            formatBigInteger("-123456789012345678901234567890"));
+  EXPECT_EQ("1000000000000000000000000000", formatBigInteger("1000000000000000000000000000"));
+  EXPECT_EQ("18446744073709551616", formatBigInteger("0x10000000000000000"));
+  EXPECT_EQ("36893488147419103232", formatBigInteger("0b1" + std::string(65, '0')));
+  EXPECT_EQ("73786976294838206464", formatBigInteger("0" + std::string(1, '1') + std::string(22, '0')));
+}
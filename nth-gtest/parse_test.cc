@@ -2,6 +2,7 @@
 #include "test_helper.h"
 #include "ast_string_printer.h"
 #include "driver.h"
+#include "flat_ast.h"
 
 class ParseTest : public ::testing::Test {
  protected:
@@ -58,6 +59,32 @@ TEST_F(ParseTest, ParseSomeFloats) {
   EXPECT_AST(block(float(10.2340982), float(0.002234)));
 }
 
+TEST_F(ParseTest, ParseBigIntegers) {
+  int status = d.parseString(
+    "9223372036854775807\n9223372036854775808\n-9223372036854775808\n"
+    "-99999999999999999999\n0xffffffffffffffffff\n0b1" + std::string(64, '0') + "\n"
+    "02000000000000000000000");
+  EXPECT_EQ(0, status);
+  EXPECT_AST(
+    block(
+      integer(9223372036854775807),
+      big_integer(9223372036854775808),
+      integer(-9223372036854775808),
+      big_integer(-99999999999999999999),
+      big_integer(4722366482869645213695),
+      big_integer(18446744073709551616),
+      big_integer(18446744073709551616)));
+}
+
+TEST_F(ParseTest, ParseOutOfRangeFloats) {
+  testing::internal::CaptureStderr();
+  int status = d.parseString("1.5\n 1e400\n  2.5e-400");
+  std::string errors = testing::internal::GetCapturedStderr();
+  EXPECT_EQ(0, status);
+  EXPECT_EQ("2.2-6: float literal out of range\n"
+            "3.3-10: float literal out of range\n", errors);
+}
+
 TEST_F(ParseTest, ParseSomeStrings) {
   int status = d.parseString("\"Hello,\\n\\\"World\\\"!\"   \n \"World: Hello!\"");
 
@@ -76,6 +103,31 @@ TEST_F(ParseTest, ParseEscapedEscapeCharacters) {
   EXPECT_STREQ(R"*(block(string(a\\b)))*", printer.getOutput().c_str());
 }
 
+TEST_F(ParseTest, ParseDecodedEscapes) {
+  d.parseString(R"("tab\tquote\"hash\#{x}\0")");
+  auto str = static_cast<nth::String*>(d.result->getNodes()[0]);
+  EXPECT_EQ(std::string("tab\tquote\"hash#{x}\0", 19), str->getValue());
+}
+
+TEST_F(ParseTest, ParseInterpolatedString) {
+  d.parseString(R"("Hello, #{name}!")");
+  d.result->accept(printer);
+  EXPECT_EQ("block(interpolated_string(string(Hello, ),ident(name),string(!)))",
+            printer.getOutput());
+
+  auto str = static_cast<nth::InterpolatedString*>(d.result->getNodes()[0]);
+  EXPECT_EQ(8u, str->getStaticLength());
+}
+
+TEST_F(ParseTest, ParseNestedInterpolatedStrings) {
+  d.parseString(R"("#{a}, #{"b#{ {"k": c}["k"] }"}")");
+  d.result->accept(printer);
+  EXPECT_EQ("block(interpolated_string(string(),ident(a),string(, ),"
+            "interpolated_string(string(b),"
+            "subscript(map(string(k): ident(c)),string(k)),string()),string()))",
+            printer.getOutput());
+}
+
 TEST_F(ParseTest, ParseSomeBools) {
   int status = d.parseString("true\nfalse");
   EXPECT_EQ(0, status);
@@ -100,6 +152,63 @@ TEST_F(ParseTest, ParseArray) {
   EXPECT_AST(block(array(integer(1), integer(2), integer(3))));
 }
 
+TEST_F(ParseTest, ParsePackedArrays) {
+  // Constants of one kind are packed, and print as any other array would
+  EXPECT_EQ(0, d.parseString("[1, 2, 3]"));
+  auto ints = dynamic_cast<nth::PackedArray*>(d.result->getNodes()[0]);
+  ASSERT_NE(nullptr, ints);
+  EXPECT_EQ(nth::PackedValues::Kind::Integer, ints->getValues().getKind());
+  EXPECT_EQ(3, ints->getValues().size());
+  EXPECT_EQ(2, ints->getValues().getInteger(1));
+  EXPECT_AST(block(array(integer(1), integer(2), integer(3))));
+
+  EXPECT_EQ(0, d.parseString("[1.5, 2.5]"));
+  auto floats = dynamic_cast<nth::PackedArray*>(d.result->getNodes()[0]);
+  ASSERT_NE(nullptr, floats);
+  EXPECT_EQ(2.5, floats->getValues().getFloat(1));
+
+  EXPECT_EQ(0, d.parseString(R"(["a", "", "c"])"));
+  auto strings = dynamic_cast<nth::PackedArray*>(d.result->getNodes()[0]);
+  ASSERT_NE(nullptr, strings);
+  EXPECT_EQ("", strings->getValues().getString(1));
+  EXPECT_EQ("c", strings->getValues().getString(2));
+
+  // Anything else is left as it was
+  EXPECT_EQ(0, d.parseString("[1, 2.5]"));
+  EXPECT_NE(nullptr, dynamic_cast<nth::Array*>(d.result->getNodes()[0]));
+  EXPECT_EQ(0, d.parseString("[1, 2, x, 3]"));
+  EXPECT_NE(nullptr, dynamic_cast<nth::Array*>(d.result->getNodes()[0]));
+  nth::AstStringPrinter mixedPrinter;
+  d.result->accept(mixedPrinter);
+  EXPECT_EQ("block(array(integer(1),integer(2),ident(x),integer(3)))", mixedPrinter.getOutput());
+}
+
+TEST_F(ParseTest, ParseSharesLiteralValues) {
+  // Literals spelled alike share their value, which outlives the driver
+  std::unique_ptr<nth::Block> result;
+  {
+    nth::Driver driver;
+    EXPECT_EQ(0, driver.parseString(
+      R"(f("a", "", {"a": 1}, "", 99999999999999999999, 99999999999999999999))"));
+    result.reset(driver.result);
+  }
+  auto call = dynamic_cast<nth::FunctionCall*>(result->getNodes()[0]);
+  ASSERT_NE(nullptr, call);
+  nth::ExpressionList &args = call->getArguments();
+  auto a = dynamic_cast<nth::String*>(args[0]);
+  auto key = dynamic_cast<nth::Map*>(args[2])->getValues()[0].first;
+  EXPECT_EQ("a", key->getValue());
+  EXPECT_EQ(a->getText().data(), key->getText().data());
+
+  auto empty = dynamic_cast<nth::String*>(args[1]);
+  EXPECT_EQ(empty->getText().data(), dynamic_cast<nth::String*>(args[3])->getText().data());
+  EXPECT_NE(a->getText().data(), empty->getText().data());
+
+  auto big = dynamic_cast<nth::BigInteger*>(args[4]);
+  EXPECT_EQ("99999999999999999999", big->toString());
+  EXPECT_EQ(&big->getMagnitude(), &dynamic_cast<nth::BigInteger*>(args[5])->getMagnitude());
+}
+
 TEST_F(ParseTest, ParseEmptyArray) {
   int status = d.parseString("[]");
   EXPECT_EQ(0, status);
@@ -353,6 +462,11 @@ TEST_F(ParseTest, ParseIfElse) {
 //        block(call(ident(doSomethingElse), arguments())))));
 }
 
+TEST_F(ParseTest, ParseIfWithoutElse) {
+  EXPECT_EQ(0, d.parseString("if (done) { 1 }"));
+  EXPECT_AST(block(ifelse(ident(done), block(integer(1)))));
+}
+
 TEST_F(ParseTest, ParseLambdaDef) {
   d.parseString("(a: Int): Int => a * 2");
   EXPECT_AST(
@@ -431,3 +545,227 @@ TEST_F(ParseTest, ParseTypeAliasDefStatements) {
         ident(List),
         simple_typeref(ident(Expression))))));
 }
+
+TEST_F(ParseTest, ReportsEverySyntaxError) {
+  testing::internal::CaptureStderr();
+  int status = d.parseString(
+    "val a: Int = 1\n"
+    "val b: Int = )\n"
+    "val c: Int = 3\n"
+    "def f(x: Int): Int { x + }\n"
+    "f(c)\n"
+    "def (y: Int): Int { y * }\n"
+    "c\n");
+  std::string errors = testing::internal::GetCapturedStderr();
+
+  EXPECT_EQ(1, status);
+  EXPECT_EQ(4, d.getErrorCount());
+  EXPECT_EQ("2.14: syntax error, unexpected )\n"
+            "4.26: syntax error, unexpected }\n"
+            "6.5: syntax error, unexpected (, expecting IDENT\n"
+            "6.25: syntax error, unexpected }\n", errors);
+
+  // Statements in error are left out, and the rest are all there
+  EXPECT_AST(
+    block(
+      variabledef(name(ident(a)), simple_typeref(ident(Int)), integer(1)),
+      variabledef(name(ident(c)), simple_typeref(ident(Int)), integer(3)),
+      funcdef(
+        name(ident(f)),
+        arglist(argument(ident(x), simple_typeref(ident(Int)))),
+        returning(simple_typeref(ident(Int))),
+        block()),
+      call(ident(f), arguments(ident(c))),
+      ident(c)));
+}
+
+TEST_F(ParseTest, KeepsStatementsBeforeUnexpectedEnd) {
+  testing::internal::CaptureStderr();
+  int status = d.parseString("val a: Int = 1\ndef f(): Int { a +");
+  std::string errors = testing::internal::GetCapturedStderr();
+
+  EXPECT_EQ(1, status);
+  EXPECT_EQ("2.19: syntax error, unexpected end of file\n", errors);
+  EXPECT_AST(block(variabledef(name(ident(a)), simple_typeref(ident(Int)), integer(1))));
+}
+
+TEST_F(ParseTest, FailsOnlyForSyntaxErrors) {
+  // A literal out of range is reported, but nothing is left out for it
+  testing::internal::CaptureStderr();
+  int status = d.parseString("1.5\n 1e400\n  2.5e-400");
+  testing::internal::GetCapturedStderr();
+  EXPECT_EQ(0, status);
+  EXPECT_EQ(2, d.getErrorCount());
+  EXPECT_EQ(3, d.result->getNodes().size());
+
+  testing::internal::CaptureStderr();
+  status = d.parseString("1e400\nval a: Int = )\n");
+  std::string errors = testing::internal::GetCapturedStderr();
+  EXPECT_EQ(1, status);
+  EXPECT_EQ("1.1-5: float literal out of range\n"
+            "2.14: syntax error, unexpected )\n", errors);
+}
+
+TEST_F(ParseTest, FreesWhatErrorRecoveryDrops) {
+  // Between them, these give up on nodes, lists of every kind, arrays,
+  // maps and strings half built, function bodies (skipped when outlining)
+  // and, at the end of the input, a block still open
+  const char *inputs[] = {
+    "val a: Int = [1, 2 +]\nval b: Int = 2",
+    "[1, x, 2.5 *]\n[1, 2, 3 )\n",
+    "{\"k\": 1, \"j\" }\nf(1, 2, )\n(1, 2 +)\n",
+    "def f[T, U](x: Int, y: (Int, String) => T): Int { x + }\n",
+    "def (x: Int): Int { val y: Int = x }\n",
+    "val s: String = \"a#{x}b#{y +}c\"\n",
+    "val t: Map[String, (Int, Int)] = x[1 +\n(a: Int, b: Int): Int => a *\n",
+    "val u: Int = 1\nif (u) { 1 } else { g(u, [1, 2]",
+  };
+  for (bool pratt : { false, true }) {
+    for (bool outline : { false, true }) {
+      for (const char *input : inputs) {
+        SCOPED_TRACE(input);
+        size_t contexts = nth::ASTContext::count();
+        nth::Driver driver;
+        driver.should_use_pratt_parser = pratt;
+        driver.should_outline = outline;
+        testing::internal::CaptureStderr();
+        driver.parseString(input);
+        testing::internal::GetCapturedStderr();
+        ASSERT_NE(nullptr, driver.result);
+
+        // Every node allocated for the tree has been deleted by the time
+        // it's gone, and its context goes with it
+        nth::ASTContext *context = driver.result->getContext();
+        nth::ASTContext *keeper = new nth::ASTContext;
+        keeper->adopt(context);
+        delete driver.result;
+        EXPECT_EQ(0u, context->getNodeCount());
+        keeper->release(nullptr);
+        EXPECT_EQ(contexts, nth::ASTContext::count());
+      }
+    }
+  }
+}
+
+TEST_F(ParseTest, ParseLongLists) {
+  std::string args, params, expected;
+  for (int i = 0; i < 3000; ++i) {
+    args += (i ? ", " : "") + std::to_string(i);
+    params += "a" + std::to_string(i) + ": Int, ";
+    expected += (i ? "," : "") + std::string("integer(") + std::to_string(i) + ")";
+  }
+  // A trailing comma after the last parameter is allowed
+  EXPECT_EQ(0, d.parseString("def f(" + params + "): Int { 0 }\n[" + args + "]\nf(" + args + ")"));
+  ASSERT_EQ(3, d.result->getNodes().size());
+
+  auto def = static_cast<nth::FunctionDef*>(d.result->getNodes()[0]);
+  ASSERT_EQ(3000, def->getArguments().size());
+  EXPECT_EQ("a0", def->getArguments().front()->getName()->getValue());
+  EXPECT_EQ("a2999", def->getArguments().back()->getName()->getValue());
+
+  nth::AstStringPrinter arrayPrinter, callPrinter;
+  d.result->getNodes()[1]->accept(arrayPrinter);
+  EXPECT_EQ("array(" + expected + ")", arrayPrinter.getOutput());
+  d.result->getNodes()[2]->accept(callPrinter);
+  EXPECT_EQ("call(ident(f),arguments(" + expected + "))", callPrinter.getOutput());
+}
+
+// Inputs that both parsers must agree on, and whose trees must survive
+// flattening: the nth "spec" (named by an @), a sample of the grammar,
+// and input with errors of every kind
+class ParseCorpusTest : public ::testing::TestWithParam<const char *> {
+ protected:
+  struct Outcome {
+    int status;
+    std::string errors;
+    std::string tree;
+  };
+
+  static int parse(nth::Driver &driver, const std::string &input) {
+    if (input[0] == '@') return driver.parse(getResourcePath() + "/" + input.substr(1));
+    return driver.parseString(input);
+  }
+
+  static Outcome parseWith(bool pratt, const std::string &input) {
+    nth::Driver driver;
+    driver.should_use_pratt_parser = pratt;
+    Outcome outcome;
+    testing::internal::CaptureStderr();
+    outcome.status = parse(driver, input);
+    outcome.errors = testing::internal::GetCapturedStderr();
+    if (driver.result) {
+      nth::AstStringPrinter printer;
+      driver.result->accept(printer);
+      outcome.tree = printer.getOutput();
+      delete driver.result;
+    }
+    return outcome;
+  }
+};
+
+TEST_P(ParseCorpusTest, ParsersAgree) {
+  Outcome bison = parseWith(false, GetParam()), pratt = parseWith(true, GetParam());
+  EXPECT_EQ(bison.status, pratt.status);
+  EXPECT_EQ(bison.errors, pratt.errors);
+  EXPECT_EQ(bison.tree, pratt.tree);
+}
+
+TEST_P(ParseCorpusTest, FlatASTInflatesToTheSameTree) {
+  nth::Driver driver;
+  testing::internal::CaptureStderr();
+  parse(driver, GetParam());
+  testing::internal::GetCapturedStderr();
+  if (!driver.result) return;
+
+  nth::AstStringPrinter printer;
+  driver.result->accept(printer);
+  nth::FlatAST flat(driver.result);
+  delete driver.result;
+
+  nth::ASTNode *inflated = flat.inflate();
+  nth::AstStringPrinter inflatedPrinter;
+  inflated->accept(inflatedPrinter);
+  EXPECT_EQ(printer.getOutput(), inflatedPrinter.getOutput());
+  delete inflated;
+}
+
+INSTANTIATE_TEST_SUITE_P(Corpus, ParseCorpusTest, ::testing::Values(
+  "@nth.nth",
+  "",
+  "10\n20\n30\n40\n",
+  "0xbaddcafe\n0b101010\n010",
+  "10.2340982\n2.234e-3\n1.5\n 1e400\n  2.5e-400",
+  "9223372036854775807\n18446744073709551616",
+  "\"Hello,\\n\\\"World\\\"!\"   \n \"World: Hello!\"",
+  R"("tab\tquote\"hash\#{x}\0")",
+  R"("#{a}, #{"b#{ {"k": c}["k"] }"}")",
+  "true\nfalse\na",
+  "[1, 2, 3]\n[1.5, 2.5]\n[\"a\", \"\", \"c\"]\n[1, 2.5]\n[1, 2, x, 3]\n[]",
+  "{\"foo\": 10.342,\n\"bar\": 12.34}\nh[\"key1\"]\n{}",
+  "1 + 2 - 3 * 4 / 5 ^ 6 ^ 7 % 8",
+  "0xff00 << 2 >> 3 | 0x0f & 0x3e\n~0b101010",
+  "truth || fiction && !is_defined",
+  "1..10\n-3...3",
+  "(\"name\", 3, foo)\n(\"name\", 3).1",
+  "min_val == 2.3252 != cond\n1.00005 < 1.0001\n4.3 > 3.2\n3 <= 4\n6 >= 4",
+  "3 * (4 + 5)",
+  "def getName(): String { \"Matt\" }",
+  "val a: Boolean = true",
+  "foo(10, 3 + 5)\nstdout.write(\"something\")\nargless()",
+  "if (done) { doSomething() } else { doSomethingElse() }\nif (done) { 1 }",
+  "(a: Int): Int => a * 2",
+  "def makeAdder(a: Int): (Int) => Int { (x: Int): Int => x * a }",
+  "def doWork(callbackFun: () => Int): Int { callbackFun() }",
+  "def drop1[T](list: List[T]): List[T] { list.tail } ",
+  "type ExpressionList = List[Expression]",
+  "val a: Int = 1\nval b: Int = )\nval c: Int = 3\n"
+  "def f(x: Int): Int { x + }\nf(c)\ndef (y: Int): Int { y * }\nc\n",
+  "val a: Int = 1\ndef f(): Int { a +",
+  "val a: Int = [1, 2 +]\nval b: Int = 2",
+  "[1, x, 2.5 *]\n[1, 2, 3 )\n",
+  "{\"k\": 1, \"j\" }\nf(1, 2, )\n(1, 2 +)\n",
+  "def f[T, U](x: Int, y: (Int, String) => T): Int { x + }\n",
+  "val s: String = \"a#{x}b#{y +}c\"\n",
+  "val t: Map[String, (Int, Int)] = x[1 +\n(a: Int, b: Int): Int => a *\n",
+  "val u: Int = 1\nif (u) { 1 } else { g(u, [1, 2]",
+  "a $ b \"unterminated"));
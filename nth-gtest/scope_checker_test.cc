@@ -86,4 +86,17 @@ TEST_F(ScopeCheckerTest, TestOutOfOrderNestedValDecl) {
   d.parseString("def foo(a: Int): Int { val c: Int = b * 10\nval b: Int = 20 }");
   scopeChecker.run(d.result);
   EXPECT_EQ(false, scopeChecker.isValid());
-}
\ No newline at end of file
+}
+TEST_F(ScopeCheckerTest, TestStatementsAroundSyntaxErrors) {
+  testing::internal::CaptureStderr();
+  EXPECT_EQ(1, d.parseString("val a: Int = )\nval b: Int = c\ndef f(x: Int): Int { x + }\nb * d"));
+  testing::internal::GetCapturedStderr();
+
+  scopeChecker.run(d.result);
+  EXPECT_EQ(false, scopeChecker.isValid());
+  ASSERT_EQ(2, scopeChecker.getUnknownIdentifiers().size());
+
+  nth::IdentifierList &list = scopeChecker.getUnknownIdentifiers();
+  EXPECT_EQ("c", list.front()->getValue());
+  EXPECT_EQ("d", list.back()->getValue());
+}
@@ -0,0 +1,84 @@
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "statement_splitter.h"
+
+class StatementSplitterTest : public ::testing::Test {
+protected:
+  virtual void SetUp() {}
+};
+
+namespace {
+
+std::vector<nth::StatementGroup> split(const std::string &source, size_t count) {
+  return nth::splitTopLevel(source.data(), source.data() + source.size(), count);
+}
+
+}
+
+TEST_F(StatementSplitterTest, CutsOnlyBeforeLinesThatBeginStatements) {
+  std::string source =
+    "val a: Int = 1\n"               //  1
+    "\"text\n"                       //  2
+    "def inString\"\n"               //  3
+    "/* comment\n"                   //  4
+    "val inComment: Int = 2 */\n"    //  5
+    "f(1,\n"                         //  6
+    "2)\n"                           //  7
+    "[3]\n"                          //  8
+    "(4)\n"                          //  9
+    "if (a) { 1 }\n"                 // 10
+    "else { 2 }\n"                   // 11
+    "elsewhere\n"                    // 12
+    "\"#{ {\"k\": 1}[\"k\"]\n"       // 13
+    "} #{ \"x#{a}\\\"\" }\"\n"       // 14
+    "  b + 1\n"                      // 15
+    "- 1\n"                          // 16
+    "!c\n"                           // 17
+    "!= d\n"                         // 18
+    "x // \"\n"                      // 19
+    "~1\n";                          // 20
+
+  // Asked for far more groups than there are statements, every line that
+  // can be cut before is
+  std::vector<nth::StatementGroup> groups = split(source, 100);
+  std::vector<int> lines;
+  for (const nth::StatementGroup &group : groups) lines.push_back(group.line);
+  EXPECT_EQ(std::vector<int>({ 1, 2, 4, 6, 10, 12, 13, 15, 17, 19, 20 }), lines);
+
+  // The groups cover the input in order, each from the start of its line
+  const char *p = source.data();
+  int line = 1;
+  for (const nth::StatementGroup &group : groups) {
+    ASSERT_EQ(p, group.begin);
+    for (; p < group.end; ++p) {
+      if (*p == '\n') ++line;
+    }
+    if (&group != &groups.back()) {
+      EXPECT_EQ(line, (&group + 1)->line);
+      EXPECT_EQ('\n', group.end[-1]);
+    }
+  }
+  EXPECT_EQ(source.data() + source.size(), p);
+}
+
+TEST_F(StatementSplitterTest, MakesGroupsOfAboutTheSameSize) {
+  std::string source;
+  while (source.size() < 100000) {
+    source += "val x: Int = " + std::to_string(source.size()) + "\n";
+  }
+
+  for (size_t count = 1; count <= 8; ++count) {
+    std::vector<nth::StatementGroup> groups = split(source, count);
+    ASSERT_EQ(count, groups.size());
+    for (const nth::StatementGroup &group : groups) {
+      size_t size = group.end - group.begin;
+      EXPECT_GT(size, source.size() / count - 64) << count;
+      EXPECT_LT(size, source.size() / count + 64) << count;
+    }
+  }
+
+  // Nothing to cut
+  EXPECT_EQ(1u, split("f(\n" + source + ")", 4).size());
+}
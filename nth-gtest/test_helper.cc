@@ -54,3 +54,30 @@ std::string trimSpaces(const char *s) {
   );
 }
 
+std::string describeToken(const yy::parser::symbol_type &symbol) {
+  std::stringstream ss;
+  ss << symbol.name();
+  switch (symbol.kind()) {
+    case yy::parser::symbol_kind::S_INT:
+      ss << '(' << symbol.value.as<long>() << ')';
+      break;
+    case yy::parser::symbol_kind::S_FLOAT:
+      ss << '(' << symbol.value.as<double>() << ')';
+      break;
+    case yy::parser::symbol_kind::S_STRING:
+    case yy::parser::symbol_kind::S_STRING_HEAD:
+    case yy::parser::symbol_kind::S_STRING_MID:
+    case yy::parser::symbol_kind::S_STRING_TAIL:
+    case yy::parser::symbol_kind::S_IDENT:
+    case yy::parser::symbol_kind::S_BIGINT:
+      ss << '(' << symbol.value.as<nth::StringRef>() << ')';
+      break;
+    case yy::parser::symbol_kind::S_CMP:
+      ss << '(' << static_cast<int>(symbol.value.as<nth::Comparison::Type>()) << ')';
+      break;
+    default:
+      break;
+  }
+  ss << " @" << symbol.location;
+  return ss.str();
+}
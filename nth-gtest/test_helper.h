@@ -11,6 +11,7 @@
 #include <regex>
 
 #include "ast_visitor.h"
+#include "parse.hh"
 
 
 std::string getResourcePath();
@@ -30,6 +31,9 @@ bool compare(U expected, const T &actual) {
 
 std::string trimSpaces(const char *s);
 
+// Token kind, value and location, for comparing token streams
+std::string describeToken(const yy::parser::symbol_type &symbol);
+
 #define EXPECT_AST(ast) if(!d.result) FAIL();\
   d.result->accept(printer);\
   EXPECT_STREQ(trimSpaces(#ast).c_str(), printer.getOutput().c_str())
@@ -0,0 +1,157 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+#include "test_helper.h"
+#include "ast.h"
+#include "ast_string_printer.h"
+#include "driver.h"
+#include "token_cache.h"
+
+class TokenCacheTest : public ::testing::Test {
+protected:
+  virtual void SetUp() {
+    char dirTemplate[] = "/tmp/nth-token-cache-test-XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(dirTemplate));
+    dir = dirTemplate;
+  }
+
+  virtual void TearDown() {
+    std::string command = "rm -rf " + dir;
+    EXPECT_EQ(0, system(command.c_str()));
+  }
+
+  std::vector<std::string> tokenize(const std::string &source, bool cached) {
+    nth::Driver d;
+    if (cached) d.token_cache_dir = dir;
+    d.scanBuffer(source.data(), source.size());
+
+    std::vector<std::string> tokens;
+    for (;;) {
+      yy::parser::symbol_type symbol = d.lex();
+      tokens.push_back(describeToken(symbol));
+      if (symbol.kind() == yy::parser::symbol_kind::S_YYEOF) break;
+    }
+    d.scanEnd();
+    return tokens;
+  }
+
+  std::string cachePath(const std::string &source) {
+    return nth::tokenCachePath(dir, nth::hashSource(source.data(), source.size()));
+  }
+
+  std::string dir;
+};
+
+namespace {
+
+std::string readFile(const std::string &path) {
+  std::ifstream in(path);
+  std::stringstream contents;
+  contents << in.rdbuf();
+  return contents.str();
+}
+
+ino_t inodeOf(const std::string &path) {
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 ? st.st_ino : 0;
+}
+
+std::string printResult(nth::Driver &d) {
+  if (!d.result) return "<no result>";
+  nth::AstStringPrinter printer;
+  d.result->accept(printer);
+  return printer.getOutput();
+}
+
+}
+
+TEST_F(TokenCacheTest, ReplaysTheScannedTokens) {
+  std::vector<std::string> sources = {
+    readFile(getResourcePath() + "/nth.nth"),
+    "", "x", "\n\n  y",
+    "1 -1 0x1f 0b101 017 9999999999999999999999 1.5e-3 -2.25",
+    "a == b != c < d <= e > f >= g && !h || i",
+    "\"plain\" \"esc\\t\\\"aped\\\"\" \"a#{b + \"c#{d}\"}e#{ {\"k\": 1} }f\"",
+    "/* multi\nline */ val x: Int = 1 // trailing\n[1, 2]",
+  };
+  for (const std::string &source : sources) {
+    std::vector<std::string> scanned = tokenize(source, false);
+
+    EXPECT_EQ(scanned, tokenize(source, true)) << source;
+    ino_t written = inodeOf(cachePath(source));
+    ASSERT_NE(0u, written) << source;
+
+    EXPECT_EQ(scanned, tokenize(source, true)) << source;
+    EXPECT_EQ(written, inodeOf(cachePath(source))) << "cache was rewritten";
+  }
+}
+
+TEST_F(TokenCacheTest, ScansWithErrorsAreNotCached) {
+  std::string source = "a $ b \"unterminated";
+  std::vector<std::string> scanned = tokenize(source, false);
+  EXPECT_EQ(scanned, tokenize(source, true));
+  EXPECT_EQ(0u, inodeOf(cachePath(source)));
+}
+
+TEST_F(TokenCacheTest, DamagedCacheIsRescanned) {
+  std::string source = "val x: Int = 42\n\"text\"\n";
+  std::vector<std::string> scanned = tokenize(source, false);
+  tokenize(source, true);
+  std::string path = cachePath(source);
+  std::string contents = readFile(path);
+  ASSERT_FALSE(contents.empty());
+
+  // Flip a byte of the stream, then cut it short
+  std::string damaged = contents;
+  damaged[damaged.size() - 3] ^= 0x40;
+  std::string truncated = contents.substr(0, contents.size() - 1);
+  for (const std::string &bad : { damaged, truncated, std::string("NTOK") }) {
+    {
+      std::ofstream out(path, std::ios::binary | std::ios::trunc);
+      out << bad;
+    }
+    EXPECT_EQ(scanned, tokenize(source, true));
+    EXPECT_EQ(contents, readFile(path));
+  }
+}
+
+TEST_F(TokenCacheTest, UnwritableCacheIsOnlyAWarning) {
+  // A directory can't be made inside a file
+  std::string blocked = dir + "/file";
+  std::ofstream(blocked) << "";
+
+  std::string source = "val x: Int = 42\n";
+  nth::Driver d;
+  d.token_cache_dir = blocked + "/cache";
+  testing::internal::CaptureStderr();
+  int status = d.parseString(source);
+  std::string errors = testing::internal::GetCapturedStderr();
+  EXPECT_EQ(0, status);
+  EXPECT_EQ(0, d.getErrorCount());
+  EXPECT_EQ("warning: cannot write token cache: Not a directory\n", errors);
+  delete d.result;
+}
+
+TEST_F(TokenCacheTest, ParsesFilesFromCache) {
+  std::string path = getResourcePath() + "/nth.nth";
+
+  nth::Driver scanned;
+  ASSERT_EQ(0, scanned.parse(path));
+
+  for (int simd = 0; simd < 2; ++simd) {
+    for (int run = 0; run < 2; ++run) {
+      nth::Driver d;
+      d.should_use_simd_lexer = simd;
+      d.token_cache_dir = dir;
+      ASSERT_EQ(0, d.parse(path));
+      EXPECT_EQ(printResult(scanned), printResult(d));
+    }
+  }
+}
@@ -50,6 +50,64 @@ TEST_F(TypeCheckerTest, testBlock) {
   delete a;
 }
 
+TEST_F(TypeCheckerTest, testPackedArray) {
+  nth::Type &objectType = buildClass("Object", root);
+  nth::Type &floatType = buildClass("Float", root, &objectType);
+  nth::Identifier *arrayIdent = new nth::Identifier("Array");
+  nth::TemplatedType *arrayType = new nth::TemplatedType(
+    arrayIdent, nth::VariableSet(), nth::MethodSet(), &objectType, nth::TypeList());
+  root.addSymbol(arrayIdent).setType(*arrayType);
+
+  nth::ArrayBuilder elements;
+  elements.push_back(new nth::Float(1.5));
+  elements.push_back(new nth::Float(2.5));
+  nth::Block *b = new nth::Block;
+  b->setSymbolTable(root.beget());
+  b->insertAfter(elements.build());
+
+  // Typed as an Array of its elements' type, without a node for each
+  nth::TypeChecker tc;
+  EXPECT_NO_THROW(b->accept(tc));
+  auto array = dynamic_cast<nth::PackedArray*>(b->getNodes()[0]);
+  ASSERT_NE(nullptr, array);
+  auto type = dynamic_cast<nth::TemplatedType*>(array->getType());
+  ASSERT_NE(nullptr, type);
+  ASSERT_EQ(1, type->getSubtypes().size());
+  EXPECT_EQ(&floatType, type->getSubtypes().front());
+  delete b;
+}
+
+TEST_F(TypeCheckerTest, testNestedScopes) {
+  nth::Type &objectType = buildClass("Object", root);
+  nth::Type &integerType = buildClass("Integer", root, &objectType);
+
+  // The inner block's scope is inside one the checker never enters, as a
+  // function's arguments are, which gives Integer a type of its own
+  nth::SymbolTable *outerTable = root.beget();
+  nth::SymbolTable *between = outerTable->beget();
+  nth::Type &shadowType = buildClass("Integer", *between, &objectType);
+
+  nth::Block *outer = new nth::Block;
+  outer->setSymbolTable(outerTable);
+  nth::Block *inner = new nth::Block;
+  inner->setSymbolTable(between->beget());
+
+  nth::Integer *before = new nth::Integer(1);
+  nth::Integer *within = new nth::Integer(2);
+  nth::Integer *after = new nth::Integer(3);
+  outer->insertAfter(before);
+  inner->insertAfter(within);
+  outer->insertAfter(inner);
+  outer->insertAfter(after);
+
+  nth::TypeChecker tc;
+  EXPECT_NO_THROW(outer->accept(tc));
+  EXPECT_EQ(&integerType, before->getType());
+  EXPECT_EQ(&shadowType, within->getType());
+  EXPECT_EQ(&integerType, after->getType());
+  delete outer;
+}
+
 TEST_F(TypeCheckerTest, testBlockWithExpressionsAndStatements) {
   // create block with multiple statements, each with different type
   // assert that type of block is set to type of last expression
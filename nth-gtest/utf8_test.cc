@@ -0,0 +1,121 @@
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "utf8.h"
+
+class Utf8Test : public ::testing::Test {
+protected:
+  virtual void SetUp() {}
+};
+
+namespace {
+
+size_t decode(const std::string &text, uint32_t &c) {
+  return nth::decodeUtf8(text.data(), text.data() + text.size(), c);
+}
+
+// Offset of the first malformed byte, as findInvalidUtf8 reports it
+size_t findInvalid(const std::string &text) {
+  return nth::findInvalidUtf8(text.data(), text.data() + text.size()) - text.data();
+}
+
+// The same, a character at a time
+size_t findInvalidSlowly(const std::string &text) {
+  size_t i = 0;
+  while (i < text.size()) {
+    uint32_t c;
+    size_t length = nth::decodeUtf8(text.data() + i, text.data() + text.size(), c);
+    if (!length) break;
+    i += length;
+  }
+  return i;
+}
+
+size_t identifierLength(const std::string &text) {
+  return nth::identifierLength(text.data(), text.data() + text.size());
+}
+
+}
+
+TEST_F(Utf8Test, DecodesWellFormedSequences) {
+  struct { const char *text; uint32_t c; size_t length; } cases[] = {
+    { "a", 'a', 1 }, { "\x7f", 0x7f, 1 },
+    { "\xc2\x80", 0x80, 2 }, { "\xc3\xa9", 0xe9, 2 }, { "\xdf\xbf", 0x7ff, 2 },
+    { "\xe0\xa0\x80", 0x800, 3 }, { "\xe2\x82\xac", 0x20ac, 3 },
+    { "\xed\x9f\xbf", 0xd7ff, 3 }, { "\xee\x80\x80", 0xe000, 3 },
+    { "\xef\xbf\xbf", 0xffff, 3 }, { "\xf0\x90\x80\x80", 0x10000, 4 },
+    { "\xf0\x9f\x98\x80", 0x1f600, 4 }, { "\xf4\x8f\xbf\xbf", 0x10ffff, 4 },
+  };
+  for (const auto &test : cases) {
+    uint32_t c = 0;
+    EXPECT_EQ(test.length, decode(test.text, c)) << test.text;
+    EXPECT_EQ(test.c, c) << test.text;
+  }
+}
+
+TEST_F(Utf8Test, RejectsMalformedSequences) {
+  const char *cases[] = {
+    "\x80", "\xbf", "\xc0\x80", "\xc1\xbf", "\xc3", "\xc3(", "\xe0\x80\x80",
+    "\xe0\x9f\xbf", "\xed\xa0\x80", "\xed\xbf\xbf", "\xe2\x82", "\xe2(\xac",
+    "\xf0\x80\x80\x80", "\xf0\x8f\xbf\xbf", "\xf4\x90\x80\x80", "\xf5\x80\x80\x80",
+    "\xf8\x88\x80\x80\x80", "\xfe", "\xff", "\xf0\x9f\x98",
+  };
+  for (const char *text : cases) {
+    uint32_t c;
+    EXPECT_EQ(0u, decode(text, c)) << text;
+    EXPECT_EQ(0u, findInvalid(text)) << text;
+  }
+}
+
+TEST_F(Utf8Test, FindsFirstMalformedByteAnywhereInVectors) {
+  // Well-formed text of every sequence length, with one fault put at every
+  // offset across a few vectors' worth
+  const char *pieces[] = { "a", " ", "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80",
+                           "\xe0\xa0\x80", "\xed\x9f\xbf", "\xf4\x8f\xbf\xbf" };
+  const char *faults[] = { "\x80", "\xc3", "\xe2\x82", "\xf0\x9f\x98", "\xc0\xaf",
+                           "\xed\xa0\x80", "\xf4\x90\x80\x80", "\xff" };
+  std::mt19937 random(14);
+  for (int round = 0; round < 20; ++round) {
+    std::string text;
+    while (text.size() < 100) text += pieces[random() % 8];
+    ASSERT_EQ(text.size(), findInvalid(text));
+
+    for (size_t at = 0; at <= text.size(); ++at) {
+      for (const char *fault : faults) {
+        std::string broken = text.substr(0, at) + fault + text.substr(at);
+        ASSERT_EQ(findInvalidSlowly(broken), findInvalid(broken))
+          << "fault " << fault - faults[0] << " at " << at;
+      }
+    }
+  }
+}
+
+TEST_F(Utf8Test, ClassifiesIdentifierCharacters) {
+  EXPECT_TRUE(nth::isIdentifierStart(0xe9));       // é
+  EXPECT_TRUE(nth::isIdentifierStart(0x3b1));      // α
+  EXPECT_TRUE(nth::isIdentifierStart(0x4e2d));     // 中
+  EXPECT_TRUE(nth::isIdentifierStart(0x1d400));    // mathematical bold A
+  EXPECT_FALSE(nth::isIdentifierStart(0x301));     // combining acute accent
+  EXPECT_TRUE(nth::isIdentifierContinue(0x301));
+  EXPECT_FALSE(nth::isIdentifierStart(0x660));     // Arabic-Indic zero
+  EXPECT_TRUE(nth::isIdentifierContinue(0x660));
+  EXPECT_FALSE(nth::isIdentifierStart(0x20ac));    // €
+  EXPECT_FALSE(nth::isIdentifierContinue(0x20ac));
+  EXPECT_FALSE(nth::isIdentifierContinue(0xa0));   // no-break space
+  EXPECT_FALSE(nth::isIdentifierContinue(0x1f600));
+}
+
+TEST_F(Utf8Test, MeasuresIdentifiers) {
+  EXPECT_EQ(3u, identifierLength("abc def"));
+  EXPECT_EQ(0u, identifierLength("_abc"));
+  EXPECT_EQ(4u, identifierLength("a_1_"));
+  EXPECT_EQ(6u, identifierLength("caf\xc3\xa9s"));
+  EXPECT_EQ(6u, identifierLength("\xe5\x90\x8d\xe5\x89\x8d"));
+  EXPECT_EQ(4u, identifierLength("e\xcc\x81x"));
+  EXPECT_EQ(0u, identifierLength("\xcc\x81x"));
+  EXPECT_EQ(1u, identifierLength("a\xe2\x82\xac"));
+  EXPECT_EQ(1u, identifierLength("a\xc3"));
+}
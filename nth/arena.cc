@@ -0,0 +1,57 @@
+//
+//  arena.cc
+//  nth
+//
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#include "arena.h"
+
+using namespace nth;
+
+Arena::~Arena() {
+  reset();
+}
+
+char *Arena::allocate(size_t size) {
+  if (static_cast<size_t>(limit - cursor) < size) {
+    // Oversized requests get a chunk of their own so the current one
+    // can keep filling up
+    size_t chunkSize = size > kChunkSize / 4 ? size : kChunkSize;
+    char *chunk = static_cast<char*>(malloc(chunkSize));
+    if (!chunk) throw std::bad_alloc();
+    chunks.push_back(chunk);
+    if (chunkSize != kChunkSize) return chunk;
+
+    cursor = chunk;
+    limit = chunk + chunkSize;
+  }
+
+  char *result = cursor;
+  cursor += size;
+  return result;
+}
+
+StringRef Arena::copy(const char *text, size_t size) {
+  if (size == 0) return StringRef();
+  char *dest = allocate(size);
+  memcpy(dest, text, size);
+  return StringRef(dest, size);
+}
+
+void Arena::reset() {
+  for (char *chunk : chunks) {
+    free(chunk);
+  }
+  chunks.clear();
+  cursor = limit = nullptr;
+}
+
+void Arena::swap(Arena &other) {
+  chunks.swap(other.chunks);
+  std::swap(cursor, other.cursor);
+  std::swap(limit, other.limit);
+}
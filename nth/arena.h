@@ -0,0 +1,48 @@
+//
+//  arena.h
+//  nth
+//
+
+#ifndef __nth__arena__
+#define __nth__arena__
+
+#include <cstddef>
+#include <vector>
+
+#include "string_ref.h"
+
+namespace nth {
+
+// Bump allocator for data that lives exactly as long as a parse. Memory is
+// carved out of large chunks and released all at once by reset() or the
+// destructor; individual allocations are never freed.
+class Arena {
+ public:
+  Arena() : cursor(nullptr), limit(nullptr) {}
+  ~Arena();
+
+  char *allocate(size_t size);
+
+  // Copies size bytes at text into the arena
+  StringRef copy(const char *text, size_t size);
+
+  // Frees everything allocated so far
+  void reset();
+
+  // Exchanges contents with another arena without copying
+  void swap(Arena &other);
+
+  static const size_t kChunkSize = 64 * 1024;
+
+ protected:
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  std::vector<char*> chunks;
+  char *cursor;
+  char *limit;
+};
+
+}
+
+#endif /* defined(__nth__arena__) */
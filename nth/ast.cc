@@ -7,6 +7,7 @@
 //
 
 #include "ast.h"
+#include "numeric_literal.h"
 #include "type_literal.h"
 
 using namespace nth;
@@ -17,28 +18,32 @@ void ASTNode::setParent(ASTNode *node) {
 }
 
 SymbolTable *ASTNode::getNearestSymbolTable() {
-  SymbolTable *table;
-  if ((table = getSymbolTable())) {
-    return table;
-  }
-  ASTNode *parent;
-  if ((parent = getParent())) {
-    table = parent->getNearestSymbolTable();
-    return table;
+  for (ASTNode *node = this; node; node = node->getParent()) {
+    if (SymbolTable *table = node->getSymbolTable()) return table;
   }
   throw "invalid node: no sybmol table found";
 }
 
 Identifier *Identifier::forTemplatedType(std::string name, size_t subtypeCount) {
-  return new nth::Identifier(name + std::to_string(subtypeCount));
+  return new nth::Identifier(templatedTypeName(name, subtypeCount));
+}
+
+Name Identifier::templatedTypeName(const std::string &name, size_t subtypeCount) {
+  return Name(name + std::to_string(subtypeCount));
 }
 
-Block::Block() {}
+Block::Block() : Expression(Kind::Block) {}
 
-Block::Block(ASTNode *node) {
+Block::Block(ASTNode *node) : Expression(Kind::Block) {
   nodes.push_back(node);
 }
 
+Block::~Block() {
+  for (auto node : nodes) {
+    delete node;
+  }
+}
+
 void Block::insertAfter(ASTNode *node) {
   nodes.push_back(node);
   node->setParent(this);
@@ -48,102 +53,279 @@ NodeList &Block::getNodes() {
   return nodes;
 }
 
-Array::Array(ExpressionList &exprList) : values(exprList) {
-  for (auto expr : exprList) {
+Array::Array(ExpressionList &&exprList)
+  : Expression(Kind::Array), values(std::move(exprList)) {
+  for (auto expr : values) {
     expr->setParent(this);
   }
 }
 
-Map::Map(ExpressionMap &exprmap) : values(exprmap) {
-  for (auto keyValue : exprmap) {
+Array::~Array() {
+  for (auto expr : values) {
+    delete expr;
+  }
+}
+
+bool PackedValues::append(Expression *value) {
+  Integer *integer;
+  Float *flt;
+  String *string;
+  if ((kind == Kind::None || kind == Kind::Integer) && (integer = dyn_cast<Integer>(value))) {
+    kind = Kind::Integer;
+    numbers.push_back(Number());
+    numbers.back().integer = integer->getValue();
+  } else if ((kind == Kind::None || kind == Kind::Float) && (flt = dyn_cast<Float>(value))) {
+    kind = Kind::Float;
+    numbers.push_back(Number());
+    numbers.back().flt = flt->getValue();
+  } else if ((kind == Kind::None || kind == Kind::String) && (string = dyn_cast<String>(value))) {
+    kind = Kind::String;
+    text += string->getValue();
+    stringEnds.push_back(text.size());
+  } else {
+    return false;
+  }
+  return true;
+}
+
+size_t PackedValues::size() const {
+  return kind == Kind::String ? stringEnds.size() : numbers.size();
+}
+
+std::string PackedValues::getString(size_t i) const {
+  size_t begin = i ? stringEnds[i - 1] : 0;
+  return text.substr(begin, stringEnds[i] - begin);
+}
+
+Expression *PackedValues::makeNode(size_t i, ASTContext *context) const {
+  switch (kind) {
+    case Kind::Integer: return new (context) Integer(getInteger(i));
+    case Kind::Float: return new (context) Float(getFloat(i));
+    default: return new (context) String(getString(i));
+  }
+}
+
+void ArrayBuilder::push_back(Expression *value, ASTContext *context) {
+  if (values.empty()) {
+    if (packed.append(value)) {
+      delete value;
+      return;
+    }
+    for (size_t i = 0; i < packed.size(); ++i) {
+      values.push_back(packed.makeNode(i, context));
+    }
+    packed = PackedValues();
+  }
+  values.push_back(value);
+}
+
+Expression *ArrayBuilder::build(ASTContext *context) {
+  if (!values.empty()) return new (context) Array(std::move(values));
+  if (packed.size() == 0) return new (context) Array();
+  return new (context) PackedArray(std::move(packed));
+}
+
+void ArrayBuilder::discard() {
+  for (auto value : values) delete value;
+  values.clear();
+  packed = PackedValues();
+}
+
+void InterpolatedString::addLiteral(std::string text) {
+  staticLength += text.size();
+  literals.push_back(std::move(text));
+}
+
+void InterpolatedString::addExpression(Expression *expr) {
+  expr->setParent(this);
+  expressions.push_back(expr);
+}
+
+InterpolatedString::~InterpolatedString() {
+  for (auto expr : expressions) {
+    delete expr;
+  }
+}
+
+BigInteger::BigInteger(const char *begin, const char *end) : Expression(Kind::BigInteger) {
+  Value *decoded = new Value;
+  value.reset(decoded);
+  decodeBigInteger(begin, end, decoded->negative, decoded->magnitude);
+}
+
+std::string BigInteger::toString() const {
+  return formatBigInteger(value->negative, value->magnitude);
+}
+
+Map::Map(ExpressionMap &&exprmap) : Expression(Kind::Map), values(std::move(exprmap)) {
+  for (auto keyValue : values) {
     keyValue.first->setParent(this);
     keyValue.second->setParent(this);
   }
 }
 
-UnaryOperation::UnaryOperation(ExpressionPtr value)
- : value(std::move(value)) {
+Map::~Map() {
+  for (auto keyValue : values) {
+    delete keyValue.first;
+    delete keyValue.second;
+  }
+}
+
+UnaryOperation::UnaryOperation(Kind kind, ExpressionPtr value)
+ : Expression(kind), value(std::move(value)) {
   getValue()->setParent(this);
 }
 
-BinaryOperation::BinaryOperation(ExpressionPtr left, ExpressionPtr right)
- : left(std::move(left)), right(std::move(right)) {
+BinaryOperation::BinaryOperation(Kind kind, ExpressionPtr left, ExpressionPtr right)
+ : Expression(kind), left(std::move(left)), right(std::move(right)) {
   getLeftValue()->setParent(this);
   getRightValue()->setParent(this);
 }
 
 Range::Range(Integer *start, Integer *end, Exclusivity exclusivity)
-  : start(start), end(end), exclusivity(exclusivity) {
+  : Expression(Kind::Range), start(start), end(end), exclusivity(exclusivity) {
   start->setParent(this);
   end->setParent(this);
 }
 
-Tuple::Tuple(ExpressionList &values) : values(values) {
-  for (auto expr : values) {
+Range::~Range() {
+  delete start;
+  delete end;
+}
+
+Tuple::Tuple(ExpressionList &&values) : Expression(Kind::Tuple), values(std::move(values)) {
+  for (auto expr : this->values) {
     expr->setParent(this);
   }
 }
 
-Argument::Argument(Identifier *name, TypeRef *type) : name(name), type(type) {
+Tuple::~Tuple() {
+  for (auto expr : values) {
+    delete expr;
+  }
+}
+
+Argument::Argument(Identifier *name, TypeRef *type)
+  : ASTNode(Kind::Argument), name(name), type(type) {
   name->setParent(this);
   type->setParent(this);
 }
 
-FunctionDef::FunctionDef(Identifier *name, ArgList &argList,
-                         TypeRef *returnType,  Block *block,
-                         TypeDefList &typeParameters)
- : name(name), argList(argList), returnType(returnType), block(block),
-   typeParameters(typeParameters) {
+Argument::~Argument() {
+  delete name;
+  delete type;
+}
+
+FunctionDef::FunctionDef(Identifier *name, ArgList &&argList,
+                         TypeRef *returnType, FunctionBody body,
+                         TypeDefList &&typeParameters)
+ : ASTNode(Kind::FunctionDef), name(name), argList(std::move(argList)),
+   returnType(returnType), block(body.block),
+   blockParser(body.parser), typeParameters(std::move(typeParameters)) {
 
   name->setParent(this);
-  for (auto arg : argList) {
+  for (auto arg : this->argList) {
    arg->setParent(this);
   }
   returnType->setParent(this);
-  block->setParent(this);
+  if (block) block->setParent(this);
 
-  for (auto typeParam : typeParameters) {
+  for (auto typeParam : this->typeParameters) {
    typeParam->setParent(this);
   }
 }
 
-LambdaDef::LambdaDef(ArgList &argList, TypeRef *returnType, Expression *body)
-: argList(argList), returnType(returnType), body(body) {
+Block *FunctionDef::getBlock() {
+  if (blockParser) {
+    block = blockParser->parse();
+    block->setParent(this);
+    blockParser.reset();
+  }
+  return block;
+}
+
+FunctionDef::~FunctionDef() {
+  delete name;
   for (auto arg : argList) {
+    delete arg;
+  }
+  delete returnType;
+  delete block;
+  for (auto typeParam : typeParameters) {
+    delete typeParam;
+  }
+}
+
+LambdaDef::LambdaDef(ArgList &&argList, TypeRef *returnType, Expression *body)
+: Expression(Kind::LambdaDef), argList(std::move(argList)), returnType(returnType),
+  body(body) {
+  for (auto arg : this->argList) {
     arg->setParent(this);
   }
   returnType->setParent(this);
   body->setParent(this);
 }
 
-FunctionCall::FunctionCall(Expression *callable, ExpressionList &arguments)
-: callable(callable), arguments(arguments) {
+LambdaDef::~LambdaDef() {
+  for (auto arg : argList) {
+    delete arg;
+  }
+  delete returnType;
+  delete body;
+}
+
+FunctionCall::FunctionCall(Expression *callable, ExpressionList &&arguments)
+: Expression(Kind::FunctionCall), callable(callable), arguments(std::move(arguments)) {
   callable->setParent(this);
-  for (auto arg : arguments) {
+  for (auto arg : this->arguments) {
     arg->setParent(this);
   }
 }
 
+FunctionCall::~FunctionCall() {
+  delete callable;
+  for (auto arg : arguments) {
+    delete arg;
+  }
+}
+
 VariableDef::VariableDef(Identifier *name, TypeRef *varType, Expression *value)
- : name(name), varType(varType), value(value) {
+ : ASTNode(Kind::VariableDef), name(name), varType(varType), value(value) {
   name->setParent(this);
   varType->setParent(this);
   value->setParent(this);
 }
 
+VariableDef::~VariableDef() {
+  delete name;
+  delete varType;
+  delete value;
+}
+
 IfElse::IfElse(Expression *condExpr, Block *ifBlock, Block *elseBlock)
-: condExpr(condExpr), ifBlock(ifBlock), elseBlock(elseBlock) {
+: Expression(Kind::IfElse), condExpr(condExpr), ifBlock(ifBlock), elseBlock(elseBlock) {
   condExpr->setParent(this);
   ifBlock->setParent(this);
-  elseBlock->setParent(this);
+  if (elseBlock) elseBlock->setParent(this);
+}
+
+IfElse::~IfElse() {
+  delete condExpr;
+  delete ifBlock;
+  delete elseBlock;
 }
 
 TypeAliasDef::TypeAliasDef(TypeDef *lType, TypeRef *rType)
-: lType(lType), rType(rType) {
+: ASTNode(Kind::TypeAliasDef), lType(lType), rType(rType) {
   lType->setParent(this);
   rType->setParent(this);
 }
 
+TypeAliasDef::~TypeAliasDef() {
+  delete lType;
+  delete rType;
+}
+
 void Add::accept(Visitor &v) {
   v.visit(this);
   BinaryOperation::accept(v);
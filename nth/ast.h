@@ -9,7 +9,9 @@
 #ifndef __nth__ast__
 #define __nth__ast__
 
+#include <cstdint>
 #include <iostream>
+#include <string>
 #include <vector>
 #include <list>
 #include <memory>
@@ -17,7 +19,11 @@
 #include <iostream>
 
 #include "location.hh"
+#include "ast_context.h"
 #include "ast_visitor.h"
+#include "casting.h"
+#include "name.h"
+#include "string_ref.h"
 
 namespace nth {
 
@@ -26,14 +32,32 @@ class TypeDef;
 class TypeRef;
 class SymbolTable;
 
-// Anything at all, really
+// Anything at all, really. Each node owns the nodes beneath it, so
+// deleting one frees its whole subtree.
 class ASTNode : public Visitable {
  public:
-  ASTNode() : _symbolTable(nullptr), _parent(nullptr) {}
-  ASTNode(yy::location &l) : loc(l), _symbolTable(nullptr), _parent(nullptr) {}
+  // The class of node, one kind for each NODE in ast_nodes.def. isa<>,
+  // dyn_cast<> and switches use the kind, so they need neither RTTI nor a
+  // virtual call.
+  enum class Kind : uint8_t {
+#define NODE(Class) Class,
+#include "ast_nodes.def"
+  };
+
+  explicit ASTNode(Kind kind) : kind(kind), _symbolTable(nullptr), _parent(nullptr) {}
+  ASTNode(Kind kind, yy::location &l)
+    : kind(kind), loc(l), _symbolTable(nullptr), _parent(nullptr) {}
   virtual ~ASTNode() {}
 
+  Kind getKind() const { return kind; }
+  static bool classof(const ASTNode *node) { return true; }
+
   yy::location &getLocation() { return loc; }
+  void setLocation(const yy::location &l) { loc = l; }
+
+  // The context the node was allocated from, or null. The node must have
+  // been allocated with new.
+  ASTContext *getContext() const { return ASTContext::of(this); }
 
   void setSymbolTable(SymbolTable *symbolTable) { _symbolTable = symbolTable; }
   SymbolTable *getSymbolTable() { return _symbolTable; }
@@ -41,15 +65,43 @@ class ASTNode : public Visitable {
   void setParent(ASTNode *node);
   ASTNode *getParent() { return _parent; }
 
+  // Walks up to the nearest node with a table of its own. Passes over a
+  // whole tree carry the scope down instead, as TypeChecker does.
   SymbolTable *getNearestSymbolTable();
 
+  // Nodes are allocated from the context given to new, as the parsers do,
+  // or from the heap without one, and deleted as usual either way
+  static void *operator new(size_t size, ASTContext *context) {
+    return ASTContext::allocate(size, context);
+  }
+  static void *operator new(size_t size) { return ASTContext::allocate(size, nullptr); }
+  static void operator delete(void *node, size_t size) { ASTContext::deallocate(node, size); }
+  static void operator delete(void *node, ASTContext *) { ASTContext::deallocate(node, 0); }
+
  protected:
+  Kind kind;
   yy::location loc; // where we encounter this node while parsing
   SymbolTable *_symbolTable; // used during scope checking to retain info between passes
   ASTNode *_parent;
 };
 
+// Each class's kinds, for isa<> and the like
+#define NODE(Class) \
+  template <> struct ClassOf<Class> { \
+    static bool test(const ASTNode *node) { return node->getKind() == ASTNode::Kind::Class; } \
+  };
+#define BASE_NODE(Class, First, Last) \
+  template <> struct ClassOf<Class> { \
+    static bool test(const ASTNode *node) { \
+      return node->getKind() >= ASTNode::Kind::First && node->getKind() <= ASTNode::Kind::Last; \
+    } \
+  };
+#define ABSTRACT_NODE(Class, First, Last) BASE_NODE(Class, First, Last)
+#include "ast_nodes.def"
+
 class DummyNode : public nth::ASTNode {
+ public:
+  DummyNode() : ASTNode(Kind::DummyNode) {}
   virtual ~DummyNode() {}
   void accept(nth::Visitor &v) { v.visit(this); }
 };
@@ -58,8 +110,8 @@ class DummyNode : public nth::ASTNode {
 // Anything that has a value
 class Expression : public ASTNode {
  public:
-  Expression() {}
-  Expression(yy::location &l) : ASTNode(l) {}
+  explicit Expression(Kind kind) : ASTNode(kind) {}
+  Expression(Kind kind, yy::location &l) : ASTNode(kind, l) {}
   virtual ~Expression() {}
 
   void setType(Type *type) { _type = type; }
@@ -74,15 +126,16 @@ typedef std::vector<Expression*> ExpressionList;
 typedef std::pair<nth::String*, Expression*> KeyValuePair;
 typedef std::vector<KeyValuePair> ExpressionMap;
 typedef std::unique_ptr<Expression> ExpressionPtr;
-typedef std::list<Argument*> ArgList;
+typedef std::vector<Argument*> ArgList;
 typedef std::list<Type*> TypeList;
-typedef std::list<TypeRef*> TypeRefList;
-typedef std::list<TypeDef*> TypeDefList;
+typedef std::vector<TypeRef*> TypeRefList;
+typedef std::vector<TypeDef*> TypeDefList;
 
 class Block : public Expression {
  public:
   Block();
   Block(ASTNode *node);
+  virtual ~Block();
   void insertAfter(ASTNode *node);
   NodeList &getNodes();
 
@@ -95,8 +148,8 @@ class Block : public Expression {
 
 class Integer : public Expression {
  public:
-  Integer(long value): Expression(), value(value) {}
-  Integer(Integer &&other) : value(other.value) {}
+  Integer(long value): Expression(Kind::Integer), value(value) {}
+  Integer(Integer &&other) : Expression(Kind::Integer), value(other.value) {}
   virtual ~Integer() {}
 
   // Visitable
@@ -111,10 +164,36 @@ class Integer : public Expression {
   long value;
 };
 
+// An integer literal too large for a long, kept at full precision
+class BigInteger : public Expression {
+ public:
+  struct Value {
+    bool negative;
+    std::vector<uint32_t> magnitude;
+  };
+
+  BigInteger(const char *begin, const char *end);
+  // Shares a value, as from a ConstantPool
+  explicit BigInteger(std::shared_ptr<const Value> value)
+    : Expression(Kind::BigInteger), value(std::move(value)) {}
+  virtual ~BigInteger() {}
+
+  // Visitable
+  void accept(Visitor &v) { v.visit(this); }
+
+  bool isNegative() const { return value->negative; }
+  // 32-bit limbs, least significant first
+  const std::vector<uint32_t> &getMagnitude() const { return value->magnitude; }
+  std::string toString() const;
+  const std::shared_ptr<const Value> &getSharedValue() const { return value; }
+ protected:
+  std::shared_ptr<const Value> value;
+};
+
 class Float : public Expression {
  public:
-  Float(double value): value(value) {}
-  Float(Float &&other) : value(other.value) {}
+  Float(double value): Expression(Kind::Float), value(value) {}
+  Float(Float &&other) : Expression(Kind::Float), value(other.value) {}
   virtual ~Float() {}
 
   // Visitable
@@ -129,28 +208,59 @@ protected:
   double value;
 };
 
+// The text is immutable and may be shared with other nodes spelling the
+// same literal (see ConstantPool)
 class String : public Expression {
  public:
-  String(std::string value): value(value) {}
-  String(String &&other) : value(std::move(other.value)) {}
+  String(std::string value) : Expression(Kind::String), value(StringRef(value)) {}
+  explicit String(SharedText value) : Expression(Kind::String), value(std::move(value)) {}
+  String(String &&other) : Expression(Kind::String), value(std::move(other.value)) {}
 
   // Visitable
   void accept(Visitor &v) { v.visit(this); }
 
-  bool operator==(const std::string &i) const { return value == i; }
-  bool operator==(const char *i) const { return value == i; }
-  operator const std::string() const { return value; }
+  bool operator==(const std::string &i) const { return value.ref() == StringRef(i); }
+  bool operator==(const char *i) const { return value.ref() == i; }
+  operator const std::string() const { return value.ref().str(); }
   operator const char*() const { return value.c_str(); }
 
-  std::string getValue() { return value; }
+  std::string getValue() { return value.ref().str(); }
+  StringRef getText() const { return value.ref(); }
+  const SharedText &getSharedText() const { return value; }
  protected:
-  std::string value;
+  SharedText value;
+};
+
+// A string literal with #{...} interpolations. Literal text and
+// expressions alternate, beginning and ending with (possibly empty) text,
+// so "a#{x}b#{y}" has the literals "a", "b" and "" around x and y.
+class InterpolatedString : public Expression {
+ public:
+  InterpolatedString() : Expression(Kind::InterpolatedString), staticLength(0) {}
+  virtual ~InterpolatedString();
+
+  void addLiteral(std::string text);
+  void addExpression(Expression *expr);
+
+  // Visitable
+  void accept(Visitor &v) { v.visit(this); }
+
+  const std::vector<std::string> &getLiterals() { return literals; }
+  const ExpressionList &getExpressions() { return expressions; }
+
+  // Combined length of the literal text, so that the final string can be
+  // sized with a single allocation once the expressions are evaluated
+  size_t getStaticLength() { return staticLength; }
+ protected:
+  std::vector<std::string> literals;
+  ExpressionList expressions;
+  size_t staticLength;
 };
 
 class Boolean : public Expression {
  public:
-  Boolean(bool value): value(value) {}
-  Boolean(Boolean &&other) : value(other.value) {}
+  Boolean(Kind kind, bool value): Expression(kind), value(value) {}
+  Boolean(Boolean &&other) : Expression(other.kind), value(other.value) {}
 
   bool operator==(const bool &i) const { return value == i; }
   operator const bool() const { return value; }
@@ -161,7 +271,7 @@ class Boolean : public Expression {
 
 class True : public Boolean {
  public:
-  True() : Boolean(true) {}
+  True() : Boolean(Kind::True, true) {}
 
   // Visitable
   void accept(Visitor &v) { v.visit(this); }
@@ -169,40 +279,48 @@ class True : public Boolean {
 
 class False : public Boolean {
  public:
-  False() : Boolean(false) {}
+  False() : Boolean(Kind::False, false) {}
 
   // Visitable
   void accept(Visitor &v) { v.visit(this); }
 };
 
+// A name as it appears in the source. Names are interned, so comparing
+// two identifiers compares their ids rather than their text.
 class Identifier : public Expression {
  public:
-  Identifier(std::string value) : value(value) {}
-  Identifier(Identifier &&other) : value(other.value) {}
+  Identifier(std::string value) : Expression(Kind::Identifier), name(value) {}
+  Identifier(Name name) : Expression(Kind::Identifier), name(name) {}
+  Identifier(Identifier &&other) : Expression(Kind::Identifier), name(other.name) {}
   Identifier(std::string value, yy::location &loc)
-   : Expression(loc), value(value) {}
+    : Expression(Kind::Identifier, loc), name(value) {}
+  Identifier(Name name, yy::location &loc) : Expression(Kind::Identifier, loc), name(name) {}
 
   static Identifier *forTemplatedType(std::string name, size_t subtypeCount);
+  // The name forTemplatedType would give, as "Function2" for ("Function", 2)
+  static Name templatedTypeName(const std::string &name, size_t subtypeCount);
 
   // Visitable
   void accept(Visitor &v) { v.visit(this); }
 
-  bool operator==(const std::string s) const { return value == s; }
-  bool operator==(const Identifier &i) const { return value == i.value; }
-  bool operator==(const char *c) const { return value == c; }
-  operator const char*() const { return value.c_str(); }
+  bool operator==(const std::string s) const { return name == StringRef(s); }
+  bool operator==(const Identifier &i) const { return name == i.name; }
+  bool operator==(const char *c) const { return name == StringRef(c, strlen(c)); }
+  operator const char*() const { return name.c_str(); }
   
-  std::string getValue() { return value; }
+  std::string getValue() { return name.str(); }
+  Name getName() const { return name; }
  protected:
-  std::string value;
+  Name name;
 
 };
 
 class Array : public Expression {
  public:
-  Array() {}
-  Array(ExpressionList &exprlist);
-  Array(Array &&other) : values(other.values) {}
+  Array() : Expression(Kind::Array) {}
+  Array(ExpressionList &&exprlist);
+  Array(Array &&other) : Expression(Kind::Array), values(std::move(other.values)) {}
+  virtual ~Array();
 
   // Visitable
   void accept(Visitor &v) { v.visit(this); }
@@ -213,11 +331,78 @@ class Array : public Expression {
   ExpressionList values;
 };
 
+// Literal integers, floats or strings, all of one kind, packed one after
+// another rather than kept as a node apiece: eight bytes each, and the text
+// of strings in a single run
+class PackedValues {
+ public:
+  enum class Kind { None, Integer, Float, String };
+
+  PackedValues() : kind(Kind::None) {}
+
+  // Adds the value of a literal of the kind already held (or of any of the
+  // three kinds while empty), returning false if it's anything else. The
+  // node itself is left to the caller.
+  bool append(Expression *value);
+
+  Kind getKind() const { return kind; }
+  size_t size() const;
+
+  long getInteger(size_t i) const { return numbers[i].integer; }
+  double getFloat(size_t i) const { return numbers[i].flt; }
+  std::string getString(size_t i) const;
+
+  // A node of the i'th value, for when one is wanted after all
+  Expression *makeNode(size_t i, ASTContext *context = nullptr) const;
+
+ protected:
+  Kind kind;
+  union Number {
+    long integer;
+    double flt;
+  };
+  std::vector<Number> numbers;
+  std::vector<size_t> stringEnds;
+  std::string text;
+};
+
+// An array literal of constants only, of a kind that PackedValues holds.
+// It's typed without looking at each element, and has no child nodes.
+class PackedArray : public Expression {
+ public:
+  PackedArray(PackedValues &&values) : Expression(Kind::PackedArray), values(std::move(values)) {}
+
+  // Visitable
+  void accept(Visitor &v) { v.visit(this); }
+
+  const PackedValues &getValues() { return values; }
+ protected:
+  PackedValues values;
+};
+
+// Collects an array literal's elements, keeping them packed for as long as
+// they can be, so that a long table of constants never has a node apiece
+class ArrayBuilder {
+ public:
+  void push_back(Expression *value, ASTContext *context = nullptr);
+
+  // A PackedArray if every element went into one, otherwise an Array
+  Expression *build(ASTContext *context = nullptr);
+
+  // Deletes the elements collected so far, for a literal given up on
+  // after a syntax error
+  void discard();
+ protected:
+  PackedValues packed;
+  ExpressionList values; // once an element can't be packed
+};
+
 class Map : public Expression {
  public:
-  Map() {}
-  Map(ExpressionMap &exprmap);
-  Map(Map &&other) : values(other.values) {}
+  Map() : Expression(Kind::Map) {}
+  Map(ExpressionMap &&exprmap);
+  Map(Map &&other) : Expression(Kind::Map), values(std::move(other.values)) {}
+  virtual ~Map();
 
   // Visitable
   void accept(Visitor &v) { v.visit(this); }
@@ -231,7 +416,7 @@ class Map : public Expression {
 
 class UnaryOperation : public Expression {
  public:
-  UnaryOperation(ExpressionPtr value);
+  UnaryOperation(Kind kind, ExpressionPtr value);
   ExpressionPtr &getValue() { return value; }
 
   void accept(Visitor &v) { v.visit(this); }
@@ -242,7 +427,7 @@ class UnaryOperation : public Expression {
 
 class BinaryOperation : public Expression {
  public:
-  BinaryOperation(ExpressionPtr left, ExpressionPtr right);
+  BinaryOperation(Kind kind, ExpressionPtr left, ExpressionPtr right);
 
   ExpressionPtr &getLeftValue() { return left; }
   ExpressionPtr &getRightValue() { return right; }
@@ -258,7 +443,7 @@ class Add : public BinaryOperation {
  public:
   Add(ExpressionPtr left,
       ExpressionPtr right)
-    : BinaryOperation(std::move(left), std::move(right)) {}
+    : BinaryOperation(Kind::Add, std::move(left), std::move(right)) {}
 
   // Visitable
   void accept(Visitor &v);
@@ -268,7 +453,7 @@ class Subtract : public BinaryOperation {
 public:
   Subtract(ExpressionPtr left,
            ExpressionPtr right)
-    : BinaryOperation(std::move(left), std::move(right)) {}
+    : BinaryOperation(Kind::Subtract, std::move(left), std::move(right)) {}
 
   // Visitable
   void accept(Visitor &v);
@@ -278,7 +463,7 @@ class Multiply : public BinaryOperation {
 public:
   Multiply(ExpressionPtr left,
            ExpressionPtr right)
-    : BinaryOperation(std::move(left), std::move(right)) {}
+    : BinaryOperation(Kind::Multiply, std::move(left), std::move(right)) {}
 
   // Visitable
   void accept(Visitor &v);
@@ -288,7 +473,7 @@ class Divide : public BinaryOperation {
 public:
   Divide(ExpressionPtr left,
          ExpressionPtr right)
-    : BinaryOperation(std::move(left), std::move(right)) {}
+    : BinaryOperation(Kind::Divide, std::move(left), std::move(right)) {}
 
   // Visitable
   void accept(Visitor &v);
@@ -298,7 +483,7 @@ class Exponentiate : public BinaryOperation {
 public:
   Exponentiate(ExpressionPtr left,
          ExpressionPtr right)
-    : BinaryOperation(std::move(left), std::move(right)) {}
+    : BinaryOperation(Kind::Exponentiate, std::move(left), std::move(right)) {}
 
   // Visitable
   void accept(Visitor &v);
@@ -308,7 +493,7 @@ class Modulo : public BinaryOperation {
 public:
   Modulo(ExpressionPtr left,
          ExpressionPtr right)
-    : BinaryOperation(std::move(left), std::move(right)) {}
+    : BinaryOperation(Kind::Modulo, std::move(left), std::move(right)) {}
 
   // Visitable
   void accept(Visitor &v);
@@ -318,7 +503,7 @@ class BitShiftLeft : public BinaryOperation {
 public:
   BitShiftLeft(ExpressionPtr left,
          std::unique_ptr<Integer> right)
-    : BinaryOperation(std::move(left), std::move(right)) {}
+    : BinaryOperation(Kind::BitShiftLeft, std::move(left), std::move(right)) {}
 
   // Visitable
   void accept(Visitor &v);
@@ -328,7 +513,7 @@ class BitShiftRight : public BinaryOperation {
 public:
   BitShiftRight(ExpressionPtr left,
          std::unique_ptr<Integer> right)
-    : BinaryOperation(std::move(left), std::move(right)) {}
+    : BinaryOperation(Kind::BitShiftRight, std::move(left), std::move(right)) {}
 
   // Visitable
   void accept(Visitor &v);
@@ -338,7 +523,7 @@ class BitwiseOr : public BinaryOperation {
 public:
   BitwiseOr(ExpressionPtr left,
          ExpressionPtr right)
-    : BinaryOperation(std::move(left), std::move(right)) {}
+    : BinaryOperation(Kind::BitwiseOr, std::move(left), std::move(right)) {}
 
   // Visitable
   void accept(Visitor &v);
@@ -348,7 +533,7 @@ class BitwiseAnd : public BinaryOperation {
 public:
   BitwiseAnd(ExpressionPtr left,
          ExpressionPtr right)
-    : BinaryOperation(std::move(left), std::move(right)) {}
+    : BinaryOperation(Kind::BitwiseAnd, std::move(left), std::move(right)) {}
 
   // Visitable
   void accept(Visitor &v);
@@ -357,7 +542,7 @@ public:
 class BitwiseNot : public UnaryOperation {
 public:
   BitwiseNot(ExpressionPtr expr)
-  : UnaryOperation(std::move(expr)) {}
+  : UnaryOperation(Kind::BitwiseNot, std::move(expr)) {}
 
   // Visitable
   void accept(Visitor &v);
@@ -367,7 +552,7 @@ class LogicalOr : public BinaryOperation {
 public:
   LogicalOr(ExpressionPtr left,
             ExpressionPtr right)
-  : BinaryOperation(std::move(left), std::move(right)) {}
+  : BinaryOperation(Kind::LogicalOr, std::move(left), std::move(right)) {}
 
   // Visitable
   void accept(Visitor &v);
@@ -377,7 +562,7 @@ class LogicalAnd : public BinaryOperation {
 public:
   LogicalAnd(ExpressionPtr left,
              ExpressionPtr right)
-  : BinaryOperation(std::move(left), std::move(right)) {}
+  : BinaryOperation(Kind::LogicalAnd, std::move(left), std::move(right)) {}
 
   // Visitable
   void accept(Visitor &v);
@@ -386,7 +571,7 @@ public:
 class LogicalNot : public UnaryOperation {
 public:
   LogicalNot(ExpressionPtr expr)
-  : UnaryOperation(std::move(expr)) {}
+  : UnaryOperation(Kind::LogicalNot, std::move(expr)) {}
 
   // Visitable
   void accept(Visitor &v);
@@ -397,6 +582,7 @@ class Range : public Expression {
   enum class Exclusivity { Exclusive, Inclusive };
 
   Range(Integer *start, Integer *end, Exclusivity exclusivity);
+  virtual ~Range();
 
   void accept(Visitor &v) { v.visit(this); }
 
@@ -411,7 +597,8 @@ class Range : public Expression {
 
 class Tuple : public Expression {
  public:
-  Tuple(ExpressionList &values);
+  Tuple(ExpressionList &&values);
+  virtual ~Tuple();
   ExpressionList &getExpressions();
 
   // Visitable
@@ -434,7 +621,7 @@ class Comparison : public BinaryOperation {
   };
 
   Comparison(ExpressionPtr left, ExpressionPtr right, Type type)
-    : BinaryOperation(std::move(left), std::move(right)), type(type) {}
+    : BinaryOperation(Kind::Comparison, std::move(left), std::move(right)), type(type) {}
 
   Type getType() { return type; }
 
@@ -450,7 +637,7 @@ class Subscript : public BinaryOperation {
   // TODO: type checker should verify that key is a string
   // and that expr is a thing-that-supports-subscript-operations
   Subscript(Expression *expr, Expression *key)
-  : BinaryOperation(ExpressionPtr(expr), ExpressionPtr(key)) {}
+  : BinaryOperation(Kind::Subscript, ExpressionPtr(expr), ExpressionPtr(key)) {}
 
   void accept(Visitor &v);
 };
@@ -458,10 +645,9 @@ class Subscript : public BinaryOperation {
 class FieldAccess : public BinaryOperation {
  public:
   FieldAccess(Expression *object, Identifier *field)
-  : BinaryOperation(ExpressionPtr(object), ExpressionPtr(field)) {}
+  : BinaryOperation(Kind::FieldAccess, ExpressionPtr(object), ExpressionPtr(field)) {}
 
-  Identifier &getField() {
-    return dynamic_cast<Identifier&>(*BinaryOperation::getRightValue()); }
+  Identifier &getField() { return *cast<Identifier>(getRightValue().get()); }
 
   void accept(Visitor &v);
 };
@@ -469,9 +655,9 @@ class FieldAccess : public BinaryOperation {
 class TupleFieldAccess : public BinaryOperation {
 public:
   TupleFieldAccess(Expression *object, Integer *index)
-  : BinaryOperation(ExpressionPtr(object), ExpressionPtr(index)) {}
+  : BinaryOperation(Kind::TupleFieldAccess, ExpressionPtr(object), ExpressionPtr(index)) {}
 
-  Integer &getIndex() { return dynamic_cast<Integer&>(*BinaryOperation::getRightValue()); }
+  Integer &getIndex() { return *cast<Integer>(getRightValue().get()); }
   void accept(Visitor &v);
 };
 
@@ -479,6 +665,7 @@ public:
 class Argument : public ASTNode {
  public:
   Argument(Identifier *name, TypeRef *type);
+  virtual ~Argument();
 
   void accept(Visitor &v) { v.visit(this); }
 
@@ -490,10 +677,30 @@ class Argument : public ASTNode {
   TypeRef *type;
 };
 
+// Parses a function's block that an outline parse skipped (see
+// Driver::should_outline)
+class BlockParser {
+ public:
+  virtual ~BlockParser() {}
+  virtual Block *parse() = 0;
+
+  // Where the block begins in the input, for a parser that reads it from
+  // there, so that it can be moved when the input ahead of it is edited
+  virtual yy::position *getStart() { return nullptr; }
+};
+
+// A function's block as the parser leaves it: either parsed, or skipped
+// and left to parser
+struct FunctionBody {
+  Block *block;
+  BlockParser *parser;
+};
+
 // def makeTea(): Tea { ... }
 class FunctionDef : public ASTNode {
  public:
-  FunctionDef(Identifier *name, ArgList &argList, TypeRef *returnType, Block *block, TypeDefList &typeParameters);
+  FunctionDef(Identifier *name, ArgList &&argList, TypeRef *returnType, FunctionBody body, TypeDefList &&typeParameters);
+  virtual ~FunctionDef();
 
   void accept(Visitor &v) { v.visit(this); }
 
@@ -501,20 +708,26 @@ class FunctionDef : public ASTNode {
   TypeDefList &getTypeParameters() { return typeParameters; }
   ArgList &getArguments() { return argList; }
   TypeRef *getReturnType() { return returnType; }
-  Block *getBlock() { return block; }
+
+  // Parses the block first if it was skipped
+  Block *getBlock();
+  bool isBlockParsed() const { return !blockParser; }
+  BlockParser *getBlockParser() { return blockParser.get(); }
 
  protected:
   Identifier      *name;
   ArgList         argList;
   TypeRef         *returnType;
   Block           *block;
+  std::unique_ptr<BlockParser> blockParser; // until the block is parsed
   TypeDefList     typeParameters;
 };
 
 // { (x: Int, y: Int): Int => x + y } 
 class LambdaDef : public Expression {
  public:
-  LambdaDef(ArgList &argList, TypeRef *returnType, Expression *body);
+  LambdaDef(ArgList &&argList, TypeRef *returnType, Expression *body);
+  virtual ~LambdaDef();
 
   void accept(Visitor &v) { v.visit(this); }
 
@@ -531,7 +744,8 @@ class LambdaDef : public Expression {
 // makeTea()
 class FunctionCall : public Expression {
  public:
-  FunctionCall(Expression *callable, ExpressionList &arguments);
+  FunctionCall(Expression *callable, ExpressionList &&arguments);
+  virtual ~FunctionCall();
 
   void accept(Visitor &v) { v.visit(this); }
 
@@ -546,6 +760,7 @@ class FunctionCall : public Expression {
 class VariableDef : public ASTNode {
  public:
   VariableDef(Identifier *name, TypeRef *varType, Expression *value);
+  virtual ~VariableDef();
 
   void accept(Visitor &v) { v.visit(this); }
 
@@ -563,6 +778,7 @@ class VariableDef : public ASTNode {
 class IfElse : public Expression {
  public:
   IfElse(Expression *condExpr, Block *ifBlock, Block *elseBlock);
+  virtual ~IfElse();
 
   void accept(Visitor &v) { v.visit(this); }
 
@@ -580,6 +796,7 @@ class IfElse : public Expression {
 class TypeAliasDef : public ASTNode {
  public:
   TypeAliasDef(TypeDef *lType, TypeRef *rType);
+  virtual ~TypeAliasDef();
 
   void accept(Visitor &v) { v.visit(this); }
 
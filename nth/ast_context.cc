@@ -0,0 +1,93 @@
+//
+//  ast_context.cc
+//  nth
+//
+
+#include <cstring>
+#include <new>
+
+#include "ast_context.h"
+
+using namespace nth;
+
+std::atomic<size_t> ASTContext::live(0);
+
+ASTContext::ASTContext() : holds(1), root(nullptr), nodeCount(0) {
+  memset(reusable, 0, sizeof(reusable));
+  live.fetch_add(1, std::memory_order_relaxed);
+}
+
+ASTContext::~ASTContext() {
+  // Last made, first destroyed, as they may refer back to what came before
+  for (auto made = destructors.rbegin(); made != destructors.rend(); ++made) {
+    made->second(made->first);
+  }
+  for (ASTContext *other : adopted) {
+    other->drop();
+  }
+  live.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void ASTContext::release(const void *root) {
+  if (root) {
+    this->root = root;
+  } else {
+    drop();
+  }
+}
+
+void ASTContext::adopt(ASTContext *other) {
+  if (!other || other == this) return;
+  other->holds.fetch_add(1, std::memory_order_relaxed);
+  adopted.push_back(other);
+}
+
+void ASTContext::drop() {
+  if (holds.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete this;
+  }
+}
+
+void *ASTContext::allocate(size_t size, ASTContext *context) {
+  // Whole words keep every node in the arena aligned as malloc would
+  size_t words = (size + kWord - 1) / kWord + 1;
+  void **block;
+  if (!context) {
+    block = static_cast<void**>(::operator new(words * kWord));
+  } else if (words < sizeof(context->reusable) / kWord && context->reusable[words]) {
+    block = static_cast<void**>(context->reusable[words]);
+    context->reusable[words] = *block;
+  } else {
+    block = reinterpret_cast<void**>(context->arena.allocate(words * kWord));
+  }
+
+  if (context) {
+    ++context->nodeCount;
+  }
+  *block = context;
+  return block + 1;
+}
+
+void ASTContext::deallocate(void *node, size_t size) {
+  void **block = static_cast<void**>(node) - 1;
+  ASTContext *context = static_cast<ASTContext*>(*block);
+  if (!context) {
+    ::operator delete(block);
+    return;
+  }
+
+  // The root goes last, as it deletes the rest of the tree first
+  --context->nodeCount;
+  if (node == context->root) {
+    context->drop();
+    return;
+  }
+
+  // Only the thread that has the tree allocates from the context or takes
+  // nodes back to it, so nothing else can be at the same time
+  size_t words = (size + kWord - 1) / kWord + 1;
+  if (size && words < sizeof(context->reusable) / kWord) {
+    *block = context->reusable[words];
+    context->reusable[words] = block;
+  }
+}
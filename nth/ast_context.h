@@ -0,0 +1,124 @@
+//
+//  ast_context.h
+//  nth
+//
+
+#ifndef __nth__ast_context__
+#define __nth__ast_context__
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "arena.h"
+#include "name.h"
+
+namespace nth {
+
+// Where the nodes of a parse are allocated: one after another out of an
+// arena, rather than malloc'd apiece (see ASTNode::operator new). The
+// context belongs to the tree: it's freed in bulk, chunks and all, when
+// the node at the top of the tree is deleted (see release()). Deleting
+// any other node runs its destructor, as nodes own strings and lists of
+// their own, and leaves its storage for the next node of its size. So
+// deleting a tree still takes time in proportion to the tree, and no node
+// may be kept once the tree it was parsed into has gone.
+//
+// The checkers make their symbol tables, symbols and types for a tree's
+// nodes in the context too (see make()). Those aren't deleted one by one,
+// but destroyed along with the context.
+//
+// Trees outlive the driver that parsed them, and have statements from
+// other parses moved in (see Driver::parseInParallel), whose contexts are
+// then held by the tree's (see adopt()). The last of those holds to be
+// given up may be on any thread; the nodes of one tree are only ever
+// allocated and deleted by one thread at a time.
+class ASTContext {
+ public:
+  ASTContext();
+
+  // Hands the creator's hold to root, the top of the tree allocated from
+  // the context, so that the context is freed when root is deleted, or
+  // straight away without a root. Nodes may still be allocated from it for
+  // the same tree afterwards (see Driver::reparse).
+  void release(const void *root);
+
+  // Holds other until this context is freed, for nodes of other's that
+  // have been moved into this one's tree
+  void adopt(ASTContext *other);
+
+  // Storage for a node of size bytes, or if context is null, from the
+  // heap. Either way, a word ahead of the node says where it came from.
+  static void *allocate(size_t size, ASTContext *context);
+
+  // Takes back a node's storage, freeing its context along with it if the
+  // node is the root. size is the one allocated, or 0 if it isn't known,
+  // in which case the storage isn't reused.
+  static void deallocate(void *node, size_t size);
+
+  // The context a node was allocated from, or null if it was allocated on
+  // the heap. The node must have been allocated with new.
+  static ASTContext *of(const void *node) {
+    return static_cast<ASTContext*>(static_cast<void *const*>(node)[-1]);
+  }
+
+  // A T made out of the arena, destroyed when the context is. The checkers
+  // may make things on any thread, once the parse is done.
+  template <typename T, typename... Args>
+  T *make(Args&&... args) {
+    std::lock_guard<std::mutex> lock(madeMutex);
+    // Whole words, as for nodes, keep the arena aligned
+    void *storage = arena.allocate((sizeof(T) + kWord - 1) / kWord * kWord);
+    T *made = new (storage) T(std::forward<Args>(args)...);
+    destructors.push_back(std::make_pair(static_cast<void*>(made), &destroy<T>));
+    return made;
+  }
+
+  // Nodes allocated from this context and not yet deleted
+  size_t getNodeCount() const { return nodeCount; }
+
+  // Contexts not yet freed, in the whole process
+  static size_t count() { return live.load(std::memory_order_relaxed); }
+
+  // Takes over the names a parse interned, so that they're held for as
+  // long as its nodes are
+  void keepNames(NameCache &parsed) { names.merge(parsed); }
+
+ protected:
+  ~ASTContext();
+  ASTContext(const ASTContext &) = delete;
+  ASTContext &operator=(const ASTContext &) = delete;
+
+  void drop();
+
+  // Nodes up to this size are reused, each size kept apart from the rest
+  static const size_t kMaxReusedSize = 256;
+  static const size_t kWord = sizeof(void*);
+
+  // One for the creator, or the root once released, and one for each
+  // context that has adopted this one
+  std::atomic<size_t> holds;
+  const void *root;
+  size_t nodeCount;
+  std::vector<ASTContext*> adopted;
+  static std::atomic<size_t> live;
+  Arena arena;
+  NameCache names;
+
+  template <typename T> static void destroy(void *made) { static_cast<T*>(made)->~T(); }
+
+  // What make() made, in order, with how to destroy each
+  std::mutex madeMutex;
+  std::vector<std::pair<void*, void (*)(void*)>> destructors;
+
+  // Storage of deleted nodes, linked through their first word, by size in
+  // words
+  void *reusable[kMaxReusedSize / kWord + 1];
+};
+
+}
+
+#endif /* defined(__nth__ast_context__) */
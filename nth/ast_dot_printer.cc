@@ -9,6 +9,7 @@
 #include "ast_dot_printer.h"
 #include "type_literal.h"
 #include "ast.h"
+#include "string_escapes.h"
 
 namespace nth {
 
@@ -56,13 +57,33 @@ void AstDotPrinter::visit(Block *block) {
 }
 
 void AstDotPrinter::visit(String *string) {
-  nodes[string] = string->getValue();
+  nodes[string] = escapeString(string->getValue());
+}
+
+void AstDotPrinter::visit(InterpolatedString *string) {
+  // Label with the literal text, leaving a #{} hole for each expression
+  std::string label;
+  const auto &literals = string->getLiterals();
+  for (size_t i = 0; i < literals.size(); ++i) {
+    if (i > 0) label += "#{}";
+    label += escapeString(literals[i]);
+  }
+  nodes[string] = label;
+
+  for (auto child : string->getExpressions()) {
+    edges.push_back(std::make_pair(string, child));
+    child->accept(*this);
+  }
 }
 
 void AstDotPrinter::visit(Integer *integer) {
   nodes[integer] = std::to_string(integer->getValue());
 }
 
+void AstDotPrinter::visit(BigInteger *integer) {
+  nodes[integer] = integer->toString();
+}
+
 void AstDotPrinter::visit(Float *flt) {
   nodes[flt] = std::to_string(flt->getValue());
 }
@@ -90,6 +111,25 @@ void AstDotPrinter::visit(Array *array) {
   }
 }
 
+void AstDotPrinter::visit(PackedArray *array) {
+  nodes[array] = "array";
+
+  const PackedValues &values = array->getValues();
+  for (size_t i = 0; i < values.size(); ++i) {
+    switch (values.getKind()) {
+      case PackedValues::Kind::Integer:
+        makeDummy(std::to_string(values.getInteger(i)), array);
+        break;
+      case PackedValues::Kind::Float:
+        makeDummy(std::to_string(values.getFloat(i)), array);
+        break;
+      default:
+        makeDummy(escapeString(values.getString(i)), array);
+        break;
+    }
+  }
+}
+
 void AstDotPrinter::visit(Map *map) {
   nodes[map] = "map";
 
@@ -322,8 +362,10 @@ void AstDotPrinter::visit(IfElse *ifElse) {
   edges.push_back(std::make_pair(ifElse, ifElse->getIfBlock()));
   ifElse->getIfBlock()->accept(*this);
 
-  edges.push_back(std::make_pair(ifElse, ifElse->getElseBlock()));
-  ifElse->getElseBlock()->accept(*this);
+  if (ifElse->getElseBlock()) {
+    edges.push_back(std::make_pair(ifElse, ifElse->getElseBlock()));
+    ifElse->getElseBlock()->accept(*this);
+  }
 }
 
 void AstDotPrinter::visit(SimpleTypeRef *type) {
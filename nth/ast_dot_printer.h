@@ -17,12 +17,15 @@ public:
 
   void visit(Block *block);
   void visit(String *string);
+  void visit(InterpolatedString *string);
   void visit(Integer *integer);
+  void visit(BigInteger *integer);
   void visit(Float *flt);
   void visit(True *tru);
   void visit(False *flse);
   void visit(Identifier *ident);
   void visit(Array *array);
+  void visit(PackedArray *array);
   void visit(Map *map);
   void visit(BinaryOperation *bin_op);
   void visit(UnaryOperation *un_op);
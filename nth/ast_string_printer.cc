@@ -1,7 +1,9 @@
 #include <iomanip>
 #include <limits>
+#include <memory>
 
 #include "ast_string_printer.h"
+#include "string_escapes.h"
 #include "type_literal.h"
 
 namespace nth {
@@ -34,13 +36,34 @@ void AstStringPrinter::visit(Block *block) {
   ast_output << ")";
 }
 void AstStringPrinter::visit(String *string) {
-  ast_output << "string(" << *string << ")";
+  ast_output << "string(" << escapeString(string->getValue()) << ")";
+}
+
+void AstStringPrinter::visit(InterpolatedString *string) {
+  ast_output << "interpolated_string(";
+
+  const auto &literals = string->getLiterals();
+  const auto &exprs = string->getExpressions();
+  for (size_t i = 0; i < literals.size(); ++i) {
+    if (i > 0) {
+      ast_output << ",";
+      exprs[i - 1]->accept(*this);
+      ast_output << ",";
+    }
+    ast_output << "string(" << escapeString(literals[i]) << ")";
+  }
+
+  ast_output << ")";
 }
 
 void AstStringPrinter::visit(Integer *integer) {
   ast_output << "integer(" << *integer << ")";
 }
 
+void AstStringPrinter::visit(BigInteger *integer) {
+  ast_output << "big_integer(" << integer->toString() << ")";
+}
+
 void AstStringPrinter::visit(Float *flt) {
   ast_output << "float("
   << std::setprecision(std::numeric_limits<double>::digits10)
@@ -72,6 +95,20 @@ void AstStringPrinter::visit(Array *array) {
   ast_output << ")";
 }
 
+void AstStringPrinter::visit(PackedArray *array) {
+  // Printed just as though its elements were nodes
+  ast_output << "array(";
+
+  const PackedValues &values = array->getValues();
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (i > 0) ast_output << ",";
+    std::unique_ptr<Expression> value(values.makeNode(i));
+    value->accept(*this);
+  }
+
+  ast_output << ")";
+}
+
 void AstStringPrinter::visit(Map *map) {
   ast_output << "map(";
   auto values = map->getValues();
@@ -292,8 +329,10 @@ void AstStringPrinter::visit(IfElse *ifElse) {
   ifElse->getCond()->accept(*this);
   ast_output << ",";
   ifElse->getIfBlock()->accept(*this);
-  ast_output << ",";
-  ifElse->getElseBlock()->accept(*this);
+  if (ifElse->getElseBlock()) {
+    ast_output << ",";
+    ifElse->getElseBlock()->accept(*this);
+  }
   ast_output << ")";
 }
 
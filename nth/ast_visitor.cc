@@ -24,7 +24,15 @@ void Visitor::visit(Block *block) {
 }
 
 void Visitor::visit(String *string) {}
+
+void Visitor::visit(InterpolatedString *string) {
+  for (auto expr : string->getExpressions()) {
+    expr->accept(*this);
+  }
+}
+
 void Visitor::visit(Integer *integer) {}
+void Visitor::visit(BigInteger *integer) {}
 void Visitor::visit(Float *flt) {}
 void Visitor::visit(True *tru) {}
 void Visitor::visit(False *flse) {}
@@ -36,6 +44,8 @@ void Visitor::visit(Array *array) {
   }
 }
 
+void Visitor::visit(PackedArray *array) {}
+
 void Visitor::visit(Map *map) {
   for (auto keyValue : map->getValues()) {
     keyValue.second->accept(*this);
@@ -133,7 +143,7 @@ void Visitor::visit(Argument *argument) {
 void Visitor::visit(IfElse *ifElse) {
   ifElse->getCond()->accept(*this);
   ifElse->getIfBlock()->accept(*this);
-  ifElse->getElseBlock()->accept(*this);
+  if (ifElse->getElseBlock()) ifElse->getElseBlock()->accept(*this);
 }
 
 void Visitor::visit(SimpleTypeRef *type) {
@@ -0,0 +1,42 @@
+//
+//  casting.h
+//  nth
+//
+
+#ifndef __nth__casting__
+#define __nth__casting__
+
+#include <cassert>
+
+namespace nth {
+
+// Says whether a value of some base class is a To, as LLVM's isa<> does:
+// by a kind that the value carries rather than by RTTI. A class gives its
+// kinds with a static classof(), or with a specialization of ClassOf.
+template <typename To> struct ClassOf {
+  template <typename From> static bool test(const From *value) { return To::classof(value); }
+};
+
+template <typename To, typename From> bool isa(const From *value) {
+  assert(value && "isa<> on a null pointer");
+  return ClassOf<To>::test(value);
+}
+
+// For a value known to be a To
+template <typename To, typename From> To *cast(From *value) {
+  assert(isa<To>(value) && "cast<> to the wrong kind");
+  return static_cast<To*>(value);
+}
+
+// nullptr unless the value is a To
+template <typename To, typename From> To *dyn_cast(From *value) {
+  return isa<To>(value) ? static_cast<To*>(value) : nullptr;
+}
+
+template <typename To, typename From> To *dyn_cast_or_null(From *value) {
+  return value && isa<To>(value) ? static_cast<To*>(value) : nullptr;
+}
+
+}
+
+#endif /* defined(__nth__casting__) */
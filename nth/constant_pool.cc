@@ -0,0 +1,79 @@
+//
+//  constant_pool.cc
+//  nth
+//
+
+#include "constant_pool.h"
+#include "numeric_literal.h"
+
+namespace nth {
+
+SharedText ConstantPool::string(StringRef text) {
+  if (2 * (stringCount + 1) > strings.size()) rehashStrings();
+
+  size_t mask = strings.size() - 1;
+  for (size_t i = StringRefHash()(text) & mask;; i = (i + 1) & mask) {
+    if (!strings[i]) {
+      strings[i] = SharedText(text);
+      ++stringCount;
+      return strings[i];
+    }
+    if (strings[i].ref() == text) return strings[i];
+  }
+}
+
+void ConstantPool::rehashStrings() {
+  std::vector<SharedText> old;
+  old.swap(strings);
+
+  size_t kept = 0;
+  for (const SharedText &value : old) {
+    if (value && !value.unique()) ++kept;
+  }
+
+  // Room for as many again as are kept before the next rehash
+  size_t capacity = kMinCapacity;
+  while (capacity < 4 * (kept + 1)) capacity *= 2;
+  strings.resize(capacity);
+  stringCount = kept;
+
+  size_t mask = capacity - 1;
+  for (SharedText &value : old) {
+    if (!value || value.unique()) continue;
+    size_t i = StringRefHash()(value.ref()) & mask;
+    while (strings[i]) i = (i + 1) & mask;
+    strings[i] = std::move(value);
+  }
+}
+
+std::shared_ptr<const BigInteger::Value> ConstantPool::bigInteger(StringRef text) {
+  auto found = bigIntegers.find(text);
+  if (found != bigIntegers.end()) return found->second->value;
+
+  if (bigIntegers.size() >= bigIntegerSweepAt) {
+    for (auto it = bigIntegers.begin(); it != bigIntegers.end();) {
+      it = it->second->value.use_count() == 1 ? bigIntegers.erase(it) : ++it;
+    }
+    bigIntegerSweepAt = 2 * bigIntegers.size() > kMinCapacity ? 2 * bigIntegers.size()
+                                                               : kMinCapacity;
+  }
+
+  std::unique_ptr<PooledBigInteger> pooled(new PooledBigInteger);
+  pooled->text = text.str();
+  auto value = std::make_shared<BigInteger::Value>();
+  decodeBigInteger(text.begin(), text.end(), value->negative, value->magnitude);
+  pooled->value = value;
+
+  StringRef key(pooled->text);
+  bigIntegers.emplace(key, std::move(pooled));
+  return value;
+}
+
+void ConstantPool::clear() {
+  strings.clear();
+  stringCount = 0;
+  bigIntegers.clear();
+  bigIntegerSweepAt = kMinCapacity;
+}
+
+}
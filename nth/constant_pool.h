@@ -0,0 +1,70 @@
+//
+//  constant_pool.h
+//  nth
+//
+
+#ifndef __nth__constant_pool__
+#define __nth__constant_pool__
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ast.h"
+#include "string_ref.h"
+
+namespace nth {
+
+// The values of a parse's literals, each kept once however many times it's
+// spelled, for the nodes of those literals to share. Generated code repeats
+// the same few strings over and over; with a pool, each occurrence costs a
+// node holding a reference rather than a copy of the text.
+//
+// Only values bigger than a reference are pooled: strings and integers too
+// large for a long. An Integer, Float or boolean holds its value in no more
+// room than a reference would take.
+//
+// A pooled value lives for as long as any node refers to it, so a tree may
+// outlive the pool it was built from, or be deleted on another thread.
+// Whenever the pool fills up, it lets go of the values that no node refers
+// to any more, as when constants are packed into an array (see
+// ArrayBuilder), so that literals which are never repeated don't pile up.
+class ConstantPool {
+ public:
+  ConstantPool() : stringCount(0), bigIntegerSweepAt(kMinCapacity) {}
+
+  // The value of a string literal with this (decoded) text
+  SharedText string(StringRef text);
+
+  // The value of a BIGINT token with this text
+  std::shared_ptr<const BigInteger::Value> bigInteger(StringRef text);
+
+  // Distinct values pooled and not yet let go of
+  size_t size() const { return stringCount + bigIntegers.size(); }
+
+  // Forgets every value, leaving them to the nodes that refer to them
+  void clear();
+
+ protected:
+  static const size_t kMinCapacity = 1024;
+
+  // Makes room for more strings, dropping those only the pool refers to
+  void rehashStrings();
+
+  // Open addressing, at most half full, so that a string costs the pool no
+  // more than a couple of pointers
+  std::vector<SharedText> strings;
+  size_t stringCount;
+
+  // Keys refer to copies of the tokens, kept alongside their values
+  struct PooledBigInteger {
+    std::string text;
+    std::shared_ptr<const BigInteger::Value> value;
+  };
+  std::unordered_map<StringRef, std::unique_ptr<PooledBigInteger>, StringRefHash> bigIntegers;
+  size_t bigIntegerSweepAt;
+};
+
+}
+
+#endif /* defined(__nth__constant_pool__) */
@@ -0,0 +1,147 @@
+//
+//  coroutine.cc
+//  nth
+//
+
+#ifdef __APPLE__
+#define _XOPEN_SOURCE 600 // for the ucontext functions
+#endif
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include "coroutine.h"
+
+// AddressSanitizer has to be told whenever the stack changes under it
+#if defined(__SANITIZE_ADDRESS__)
+#define NTH_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define NTH_ASAN 1
+#endif
+#endif
+
+#ifdef NTH_ASAN
+#include <sanitizer/asan_interface.h>
+#include <sanitizer/common_interface_defs.h>
+#endif
+
+using namespace nth;
+
+struct Coroutine::Context {
+  ucontext_t caller;
+  ucontext_t self;
+
+#ifdef NTH_ASAN
+  void *callerFakeStack = nullptr;
+  void *selfFakeStack = nullptr;
+  const void *callerStack = nullptr;
+  size_t callerStackSize = 0;
+#endif
+
+  void switchIn(char *stack, size_t stackSize) {
+#ifdef NTH_ASAN
+    __sanitizer_start_switch_fiber(&callerFakeStack, stack, stackSize);
+#endif
+    swapcontext(&caller, &self);
+#ifdef NTH_ASAN
+    __sanitizer_finish_switch_fiber(callerFakeStack, nullptr, nullptr);
+#endif
+  }
+
+  // Called first thing on the coroutine's own stack
+  void arrived() {
+#ifdef NTH_ASAN
+    __sanitizer_finish_switch_fiber(selfFakeStack, &callerStack, &callerStackSize);
+#endif
+  }
+
+  // Back to the caller, for good if finished
+  void switchOut(bool finished) {
+#ifdef NTH_ASAN
+    __sanitizer_start_switch_fiber(finished ? nullptr : &selfFakeStack,
+                                   callerStack, callerStackSize);
+#endif
+    swapcontext(&self, &caller);
+    arrived();
+  }
+};
+
+Coroutine::Coroutine(std::function<void()> body, size_t stackSize)
+  : body(body), context(new Context), stack(nullptr), started(false), done(false),
+    cancelled(false) {
+  size_t pageSize = sysconf(_SC_PAGESIZE);
+  this->stackSize = (stackSize + pageSize - 1) / pageSize * pageSize + pageSize;
+
+  // Pages of the stack are only committed as the body touches them, and
+  // running off the bottom faults rather than overwriting the heap
+  void *mapping = mmap(nullptr, this->stackSize, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANON, -1, 0);
+  if (mapping == MAP_FAILED) {
+    delete context;
+    throw std::bad_alloc();
+  }
+  stack = static_cast<char*>(mapping);
+  mprotect(stack, pageSize, PROT_NONE);
+}
+
+Coroutine::~Coroutine() {
+  if (started && !done) {
+    cancelled = true;
+    resume();
+  }
+#ifdef NTH_ASAN
+  // Frames left on the stack keep their redzones poisoned, and whatever is
+  // mapped here next would otherwise be taken for them
+  __asan_unpoison_memory_region(stack, stackSize);
+#endif
+  munmap(stack, stackSize);
+  delete context;
+}
+
+void Coroutine::start(unsigned high, unsigned low) {
+  // makecontext only passes ints, so the pointer comes in two halves
+  Coroutine *self = reinterpret_cast<Coroutine*>(
+    static_cast<uintptr_t>(high) << 16 << 16 | static_cast<uintptr_t>(low));
+  self->context->arrived();
+  try {
+    self->body();
+  } catch (const Cancelled &) {
+  } catch (...) {
+    self->failure = std::current_exception();
+  }
+  self->done = true;
+  self->context->switchOut(true);
+}
+
+bool Coroutine::resume() {
+  if (done) return false;
+
+  if (!started) {
+    started = true;
+    getcontext(&context->self);
+    context->self.uc_stack.ss_sp = stack;
+    context->self.uc_stack.ss_size = stackSize;
+    context->self.uc_link = nullptr;
+    uintptr_t self = reinterpret_cast<uintptr_t>(this);
+    makecontext(&context->self, reinterpret_cast<void (*)()>(&Coroutine::start), 2,
+                static_cast<unsigned>(self >> 16 >> 16), static_cast<unsigned>(self));
+  }
+  context->switchIn(stack, stackSize);
+
+  if (failure) {
+    std::exception_ptr rethrown = failure;
+    failure = nullptr;
+    std::rethrow_exception(rethrown);
+  }
+  return !done;
+}
+
+void Coroutine::yield() {
+  context->switchOut(false);
+  if (cancelled) throw Cancelled();
+}
@@ -0,0 +1,61 @@
+//
+//  coroutine.h
+//  nth
+//
+
+#ifndef __nth__coroutine__
+#define __nth__coroutine__
+
+#include <cstddef>
+#include <exception>
+#include <functional>
+
+namespace nth {
+
+// Runs a function on a stack of its own that can be left part way through
+// and picked up again later, on the same thread. This is what lets a pull
+// parser take input as it's pushed to it: the parser runs in a coroutine,
+// and when the scanner has used up what it's been given, it yields back to
+// whoever has more.
+class Coroutine {
+ public:
+  explicit Coroutine(std::function<void()> body, size_t stackSize = kDefaultStackSize);
+
+  // A coroutine abandoned part way through is unwound first (see yield)
+  ~Coroutine();
+
+  // Runs the body until it yields or returns, and returns whether there's
+  // more of it to run. An exception thrown by the body is rethrown here.
+  bool resume();
+
+  // Called from the body to return control to resume()'s caller. Throws
+  // Cancelled if the coroutine is being destroyed instead of resumed,
+  // which the body must let unwind all the way out.
+  void yield();
+
+  struct Cancelled {};
+
+  bool isDone() const { return done; }
+
+  static const size_t kDefaultStackSize = 256 * 1024;
+
+ protected:
+  Coroutine(const Coroutine &) = delete;
+  Coroutine &operator=(const Coroutine &) = delete;
+
+  static void start(unsigned high, unsigned low);
+
+  std::function<void()> body;
+  struct Context;
+  Context *context;
+  char *stack;       // mapped, with an inaccessible guard page at the bottom
+  size_t stackSize;
+  bool started;
+  bool done;
+  bool cancelled;
+  std::exception_ptr failure;
+};
+
+}
+
+#endif /* defined(__nth__coroutine__) */
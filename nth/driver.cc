@@ -6,75 +6,803 @@
 //  Copyright (c) 2014 Matt Gadda. All rights reserved.
 //
 
+#include <algorithm>
 #include <cerrno>
+#include <cstring>
+#include <thread>
+#include "ast_visitor.h"
+#include "coroutine.h"
 #include "driver.h"
+#include "lexer.h"
+#include "line_counter.h"
+#include "parallel_lexer.h"
+#include "pratt_parser.h"
+#include "statement_splitter.h"
+#include "token_cache.h"
 // scan.h must be included /after/ driver.h so that YY_DECL has already been defined
 #include "scan.h"
 
-/*
-extern void yyrestart(FILE*);
-//extern "C" int yyparse();
-extern int yylineno;
-//extern int yydebug;
-extern FILE* yyin;
-extern YY_BUFFER_STATE yy_scan_string(const char *str);
-*/
-
-extern int yy_flex_debug;
+yy::parser::symbol_type yylex(nth::Driver& driver) {
+  return driver.lex();
+}
 
 namespace nth {
 
 Driver::Driver()
-  : should_trace_scanning(false), should_trace_parsing(false) {}
+  : result(nullptr), should_trace_scanning(false),
+    should_use_simd_lexer(false), lexer_threads(1), parser_threads(1),
+    should_map_input(true), should_build_ast(true), should_outline(false),
+    should_use_pratt_parser(false),
+    stream_chunk_size(64 * 1024), should_trace_parsing(false),
+    scanner(nullptr), context(nullptr), sourceBufferState(nullptr),
+    errorCount(0), syntaxErrorCount(0), reportErrors(true), pushFinished(false), pushStatus(0),
+    openedInput(nullptr),
+    inputCursor(nullptr), inputEnd(nullptr) {}
 
-Driver::~Driver() {}
+Driver::~Driver() {
+  scannerDestroy();
+}
 
-void Driver::scanBegin() {
-  yy_flex_debug = should_trace_scanning;
+void Driver::scannerInit() {
+  scannerDestroy();
 
-  if (file.empty() || file == "-") {
-    yyin = stdin;
-  } else if (!(yyin = fopen(file.c_str(), "r"))) {
-    error("cannot open " + file + ": " + strerror(errno));
+  if (yylex_init_extra(this, &scanner)) {
+    error(std::string("cannot initialize scanner: ") + strerror(errno));
     exit(EXIT_FAILURE);
   }
-  
-  yyrestart(yyin);
+  yyset_debug(should_trace_scanning, scanner);
+  location = yy::location();
+  result = nullptr;
+  openStrings.clear();
+  literalText.clear();
+  errorCount = 0;
+  syntaxErrorCount = 0;
+  topLevelStarts.clear();
+  awaitingBody = false;
+}
+
+void Driver::scannerDestroy() {
+  // An abandoned push parse is unwound while the scanner it was using is
+  // still there
+  pushParser.reset();
+
+  if (sourceBufferState) {
+    yy_delete_buffer(sourceBufferState, scanner);
+    sourceBufferState = nullptr;
+  }
+  if (scanner) {
+    yylex_destroy(scanner);
+    scanner = nullptr;
+  }
+  lexer.reset();
+  parallelLexer.reset();
+  cachedTokens.reset();
+  tokenRecorder.reset();
+  source.reset();
+  inputLines.reset();
+  constants.clear();
+  tokenText.reset();
+  retiredTokenText.reset();
+  inputCursor = inputEnd = nullptr;
+}
+
+void Driver::scanBegin() {
+  scannerInit();
+
+  bool isStdin = file.empty() || file == "-";
+  if (!isStdin && should_map_input) {
+    source.reset(SourceBuffer::mapFile(file));
+    // Pipes and devices can't be mapped; read those like any other stream
+    if (!source && errno != ENODEV) {
+      error("cannot open " + file + ": " + strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  bodySource.reset();
+  if (!source) {
+    FILE *in = stdin;
+    if (!isStdin && !(in = fopen(file.c_str(), "r"))) {
+      error("cannot open " + file + ": " + strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+
+    if (!should_use_simd_lexer && token_cache_dir.empty()) {
+      openedInput = in != stdin ? in : nullptr;
+      yyrestart(in, scanner);
+      return;
+    }
+
+    source.reset(SourceBuffer::readStream(in));
+    int saved = errno;
+    if (in != stdin) {
+      fclose(in);
+    }
+    if (!source) {
+      error("cannot read " + (isStdin ? std::string("stdin") : file) + ": " +
+            strerror(saved));
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  bodyLines.reset();
+  if (should_outline) {
+    inputLines.reset(new LineCounter(source->getBufferStart(), source->getBufferSize()));
+    bodyLines = std::make_shared<LineCounter>(source->getBufferStart(), source->getBufferSize());
+    bodySource = source;
+  }
+
+  if (openTokenCache(source->getBufferStart(), source->getBufferSize())) {
+    return;
+  }
+
+  if (should_use_simd_lexer) {
+    const char *start = source->getBufferStart();
+    startLexer(start, start + source->getBufferSize());
+  } else {
+    sourceBufferState = yy_scan_buffer(source->getBufferStart(),
+                                       source->getScanSize(), scanner);
+  }
+}
+
+void Driver::scanBuffer(const char *buf, size_t size) {
+  scannerInit();
+
+  if (should_outline) {
+    inputLines.reset(new LineCounter(buf, size));
+  }
+
+  if (openTokenCache(buf, size)) {
+    return;
+  }
+
+  if (should_use_simd_lexer) {
+    startLexer(buf, buf + size);
+    return;
+  }
+
+  // flex writes into whatever buffer it scans, so rather than copying the
+  // caller's memory up front (as yy_scan_string does), feed it to the
+  // scanner's fixed-size window as the scanner asks for it.
+  inputCursor = buf;
+  inputEnd = buf + size;
+}
+
+bool Driver::openTokenCache(const char *buf, size_t size) {
+  if (token_cache_dir.empty()) {
+    return false;
+  }
+
+  uint64_t hash = hashSource(buf, size);
+  std::string path = tokenCachePath(token_cache_dir, hash);
+  cachedTokens.reset(TokenCacheReader::open(path, hash, size));
+  if (cachedTokens) {
+    return true;
+  }
+  tokenRecorder.reset(new TokenCacheWriter(path, hash, size));
+  return false;
+}
+
+void Driver::startLexer(const char *begin, const char *end) {
+  // Parsing in parallel lexes each group on its own thread already
+  size_t threads = parser_threads > 1 ? 1 : lexer_threads;
+  size_t chunks = std::min<size_t>(threads, (end - begin) / ParallelLexer::kMinimumChunkSize);
+  if (chunks > 1) {
+    parallelLexer.reset(new ParallelLexer(*this, begin, end, chunks));
+  } else {
+    lexer.reset(new Lexer(*this, begin, end));
+  }
+}
+
+yy::parser::symbol_type Driver::scanToken() {
+  if (parallelLexer) return parallelLexer->lex();
+  return lexer ? lexer->lex() : yylex(*this, scanner);
+}
+
+yy::parser::symbol_type Driver::lex() {
+  yy::parser::symbol_type symbol = nextToken();
+  if (!inputLines) {
+    return symbol;
+  }
+
+  // Nothing in a signature has braces, so the first "{" after "def" opens
+  // the function's block
+  if (symbol.kind() == yy::parser::symbol_kind::S_DEF) {
+    awaitingBody = true;
+  } else if (symbol.kind() == yy::parser::symbol_kind::S_LCURLY && awaitingBody) {
+    awaitingBody = false;
+    return skipBody(symbol.location);
+  }
+  return symbol;
+}
+
+// Parses a function's block on its own, with the settings of the driver
+// that skipped it
+class Driver::SkippedBody : public BlockParser {
+ public:
+  SkippedBody(const Driver &outliner, const yy::position &start, size_t size)
+    : start(start), size(size), lines(outliner.bodyLines), source(outliner.bodySource),
+      should_use_simd_lexer(outliner.should_use_simd_lexer),
+      should_use_pratt_parser(outliner.should_use_pratt_parser) {}
+
+  Block *parse() {
+    // The block is found by where it begins, in whatever input lines
+    // counts now, as reparse may have moved it
+    long offset = lines->offsetOf(start);
+    if (offset < 0) return new Block();
+
+    // Blocks within are left for their own functions to parse
+    Driver driver;
+    driver.should_use_simd_lexer = should_use_simd_lexer;
+    driver.should_use_pratt_parser = should_use_pratt_parser;
+    driver.should_outline = true;
+    driver.bodyLines = lines;
+    driver.bodySource = source;
+    driver.parsePart(lines->data() + offset, size, start);
+    return driver.result ? driver.result : new Block();
+  }
+
+  yy::position *getStart() { return &start; }
+
+ private:
+  yy::position start;
+  size_t size;
+  std::shared_ptr<LineCounter> lines;
+  std::shared_ptr<SourceBuffer> source;
+  bool should_use_simd_lexer;
+  bool should_use_pratt_parser;
+};
+
+yy::parser::symbol_type Driver::skipBody(const yy::location &open) {
+  // Tokens are matched rather than bytes, so that braces in strings and
+  // comments are passed over, and they're still recorded for the cache
+  yy::location close = open;
+  for (int depth = 1; depth > 0;) {
+    yy::parser::symbol_type symbol = nextToken();
+    switch (symbol.kind()) {
+      case yy::parser::symbol_kind::S_LCURLY: ++depth; break;
+      case yy::parser::symbol_kind::S_RCURLY: --depth; break;
+      case yy::parser::symbol_kind::S_YYEOF: return symbol; // left to the parser to report
+      default: break;
+    }
+    close = symbol.location;
+  }
+
+  // A token's end is where it lies; its beginning may be as far back as
+  // the end of the one before
+  BlockParser *parser = nullptr;
+  long begin = inputLines->offsetOf(open.end), end = inputLines->offsetOf(close.end) - 1;
+  if (should_build_ast && bodyLines && begin >= 0 && end >= begin) {
+    parser = new SkippedBody(*this, open.end, end - begin);
+  }
+  return yy::parser::make_BODY(parser, yy::location(open.begin, close.end));
+}
+
+yy::parser::symbol_type Driver::nextToken() {
+  if (cachedTokens) {
+    return cachedTokens->next(location);
+  }
+  if (!tokenRecorder) {
+    return scanToken();
+  }
+
+  yy::parser::symbol_type symbol = scanToken();
+  tokenRecorder->record(symbol);
+  if (symbol.kind() == yy::parser::symbol_kind::S_YYEOF) {
+    // Only a complete, clean scan is worth replaying
+    std::unique_ptr<TokenCacheWriter> recorder(std::move(tokenRecorder));
+    if (errorCount == 0 && !recorder->commit()) {
+      warning(std::string("cannot write token cache: ") + strerror(errno));
+    }
+  }
+  return symbol;
 }
 
 void Driver::scanEnd() {
-  fclose(yyin);
+  if (openedInput) {
+    fclose(openedInput);
+    openedInput = nullptr;
+  }
+  scannerDestroy();
 }
 
+void Driver::scanStream(FILE *in) {
+  scannerInit();
+
+  if (should_use_simd_lexer) {
+    lexer.reset(new Lexer(*this, in, stream_chunk_size));
+  } else {
+    // flex already reads through a fixed-size buffer, a chunk at a time
+    // (see readInput)
+    yyrestart(in, scanner);
+  }
+}
+
+int Driver::runParser() {
+  // The parser recovers from syntax errors to find any others, so having
+  // reached the end doesn't mean the input was well-formed
+  //
+  // A context already set is the tree's that reparse is bringing up to
+  // date, which goes on with it
+  bool ownContext = should_build_ast && !statementHandler && !context;
+  if (ownContext) {
+    context = new ASTContext;
+  }
+
+  int ret;
+  if (should_use_pratt_parser && should_build_ast && !should_trace_parsing) {
+    PrattParser parser(*this);
+    ret = parser.parse();
+  } else {
+    yy::parser parser(*this);
+    parser.set_debug_level(should_trace_parsing);
+    ret = parser.parse();
+  }
+
+  // The names go with the tree, or when streaming, with the statements
+  // that have been handled
+  if (context) {
+    context->keepNames(names);
+  } else {
+    names.clear();
+    retiredNames.clear();
+  }
+  if (ownContext) {
+    context->release(result);
+    context = nullptr;
+  }
+  return ret ? ret : syntaxErrorCount > 0;
+}
 
 int Driver::parse(const std::string& f) {
   file = f;
   scanBegin();
-  yy::parser parser(*this);
-  parser.set_debug_level(should_trace_parsing);
-  int ret = parser.parse();
+  int ret;
+  if (!source || !parseInParallel(source->getBufferStart(),
+                                  source->getBufferStart() + source->getBufferSize(), ret)) {
+    ret = runParser();
+  }
   scanEnd();
 
   return ret;
 }
 
 int Driver::parseString(const std::string &s) {
-  YY_BUFFER_STATE bs = yy_scan_string(s.c_str());
+  return parseBuffer(s.data(), s.size());
+}
+
+int Driver::parseBuffer(const char *buf, size_t size) {
+  bodySource.reset();
+  bodyLines.reset();
+  if (should_outline) {
+    bodyLines = std::make_shared<LineCounter>(buf, size);
+  }
+  int ret;
+  if (parseInParallel(buf, buf + size, ret)) {
+    return ret;
+  }
+
+  scanBuffer(buf, size);
+  ret = runParser();
+  scannerDestroy();
+
+  return ret;
+}
+
+bool Driver::parseInParallel(const char *begin, const char *end, int &ret) {
+  size_t count = std::min<size_t>(parser_threads, (end - begin) / kMinimumStatementGroupSize);
+  if (count < 2 || should_trace_scanning || should_trace_parsing || !token_cache_dir.empty()) {
+    return false;
+  }
+  std::vector<StatementGroup> groups = splitTopLevel(begin, end, count);
+  if (groups.size() < 2) {
+    return false;
+  }
+
+  // Errors are left for the parse that replaces this one to report
+  std::vector<std::unique_ptr<Driver>> parsers;
+  for (size_t i = 0; i < groups.size(); ++i) {
+    parsers.emplace_back(new Driver);
+    parsers.back()->should_use_simd_lexer = should_use_simd_lexer;
+    parsers.back()->should_build_ast = should_build_ast;
+    parsers.back()->should_outline = should_outline;
+    parsers.back()->should_use_pratt_parser = should_use_pratt_parser;
+    parsers.back()->bodyLines = bodyLines;
+    parsers.back()->bodySource = bodySource;
+    parsers.back()->reportErrors = false;
+  }
+
+  std::vector<int> statuses(groups.size(), 1);
+  auto parseGroup = [&](size_t i) {
+    yy::position start(nullptr, groups[i].line);
+    statuses[i] = parsers[i]->parsePart(groups[i].begin, groups[i].end - groups[i].begin, start);
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < groups.size(); ++i) {
+    workers.push_back(std::thread(parseGroup, i));
+  }
+  parseGroup(0);
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+
+  bool clean = true;
+  for (size_t i = 0; i < groups.size(); ++i) {
+    clean = clean && statuses[i] == 0 && parsers[i]->errorCount == 0 &&
+            (parsers[i]->result || !should_build_ast);
+  }
+  if (!clean) {
+    for (std::unique_ptr<Driver> &parser : parsers) {
+      delete parser->result;
+    }
+    return false;
+  }
+
+  // Every group's statements are moved into the first one's block, whose
+  // context holds on to the rest
+  Block *block = parsers[0]->result;
+  topLevelStarts.swap(parsers[0]->topLevelStarts);
+  for (size_t i = 1; block && i < groups.size(); ++i) {
+    block->getContext()->adopt(parsers[i]->result->getContext());
+    NodeList &nodes = parsers[i]->result->getNodes();
+    for (ASTNode *node : nodes) {
+      block->insertAfter(node);
+    }
+    nodes.clear();
+    delete parsers[i]->result;
+    topLevelStarts.insert(topLevelStarts.end(), parsers[i]->topLevelStarts.begin(),
+                          parsers[i]->topLevelStarts.end());
+  }
+
+  result = block;
+  location = parsers.back()->location;
+  errorCount = 0;
+  syntaxErrorCount = 0;
+  ret = 0;
+  return true;
+}
+
+int Driver::parsePart(const char *buf, size_t size, const yy::position &start) {
+  scanBuffer(buf, size);
+  location.initialize(nullptr, start.line, start.column);
+  if (inputLines) {
+    inputLines.reset(new LineCounter(buf, size, start));
+  }
+  int ret = runParser();
+  scannerDestroy();
+
+  return ret;
+}
+
+namespace {
+
+bool before(const yy::position &a, const yy::position &b) {
+  return a.line < b.line || (a.line == b.line && a.column < b.column);
+}
+
+// Moves the locations in statements after an edit to where they are in the
+// edited input. Identifiers are the only nodes with a location.
+class LocationMover : public Visitor {
+ public:
+  LocationMover(const yy::position &oldEnd, const yy::position &newEnd)
+    : oldEnd(oldEnd), newEnd(newEnd) {}
+
+  // For positions at or after the end of the edit
+  yy::position moved(yy::position position) const {
+    if (position.line == oldEnd.line) {
+      position.column += newEnd.column - oldEnd.column;
+    }
+    position.line += newEnd.line - oldEnd.line;
+    return position;
+  }
+
+  using Visitor::visit;
+
+  void visit(Identifier *ident) {
+    yy::location &loc = ident->getLocation();
+    loc.begin = moved(loc.begin);
+    loc.end = moved(loc.end);
+  }
+
+  // A block that is still to be parsed is left that way, only moved
+  void visit(FunctionDef *functionDef) {
+    if (functionDef->isBlockParsed()) {
+      Visitor::visit(functionDef);
+      return;
+    }
+    functionDef->getName()->accept(*this);
+    for (auto typeParam : functionDef->getTypeParameters()) typeParam->accept(*this);
+    for (auto arg : functionDef->getArguments()) arg->accept(*this);
+    functionDef->getReturnType()->accept(*this);
+    if (yy::position *start = functionDef->getBlockParser()->getStart()) {
+      *start = moved(*start);
+    }
+  }
+
+  // Where the default traversal stops short
+  void visit(LogicalNot *logical_not) { logical_not->getValue()->accept(*this); }
+  void visit(BitwiseNot *bitwise_not) { bitwise_not->getValue()->accept(*this); }
+
+ private:
+  yy::position oldEnd;
+  yy::position newEnd;
+};
+
+bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\n'; }
+
+}
+
+int Driver::reparse(Block *previous, const char *buf, size_t size, const Edit &edit) {
+  auto parseAll = [&]() {
+    int ret = parseBuffer(buf, size);
+    delete previous;
+    return ret;
+  };
+
+  if (!previous || previous != result || !previous->getContext() || errorCount ||
+      should_outline != !!bodyLines || topLevelStarts.size() != previous->getNodes().size() ||
+      before(edit.end, edit.begin)) {
+    return parseAll();
+  }
+
+  // Where the edit ends in the new input
+  LineCounter lines(buf, size);
+  long editOffset = lines.offsetOf(edit.begin);
+  if (editOffset < 0 || static_cast<size_t>(editOffset) + edit.inserted > size) {
+    return parseAll();
+  }
+  yy::position newEnd = edit.begin;
+  for (const char *p = buf + editOffset; p < buf + editOffset + edit.inserted; ++p) {
+    if (*p == '\n') {
+      newEnd.lines(1);
+    } else {
+      newEnd.columns(1);
+    }
+  }
+  LocationMover mover(edit.end, newEnd);
+
+  // The statements from first up to last are parsed again: from the last
+  // to begin before the edit to the first to begin after it. Either end
+  // moves out another statement if there the statements could run
+  // together, lexically (with no blank between them) or because the second
+  // begins with something that could carry on the first.
+  std::vector<yy::position> &starts = topLevelStarts;
+  size_t count = starts.size();
+  size_t first = std::lower_bound(starts.begin(), starts.end(), edit.begin, before) -
+                 starts.begin();
+  first = first ? first - 1 : 0;
+  size_t last = std::upper_bound(starts.begin(), starts.end(), edit.end, before) -
+                starts.begin();
+
+  long from, to;
+  for (;;) {
+    from = first ? lines.offsetOf(starts[first]) : 0;
+    to = last < count ? lines.offsetOf(mover.moved(starts[last])) : size;
+    if (from < 0 || to < from || static_cast<size_t>(to) > size) {
+      return parseAll();
+    }
+    auto separate = [&](long offset) {
+      bool blank = isBlank(buf[offset - 1]) ||
+                   (static_cast<size_t>(offset) < size && isBlank(buf[offset]));
+      return blank && startsStatement(buf + offset, buf + size);
+    };
+    // Parsed alone, a line comment would end at the end of the statements
+    // rather than carry on over the ones after
+    auto commentRunsOn = [&]() {
+      const char *lineStart = buf + to;
+      while (lineStart > buf + from && lineStart[-1] != '\n') --lineStart;
+      for (const char *p = lineStart; p + 1 < buf + to; ++p) {
+        if (p[0] == '/' && p[1] == '/') return true;
+      }
+      return false;
+    };
+    if (first && !separate(from)) {
+      --first;
+    } else if (last < count && (!separate(to) || commentRunsOn())) {
+      ++last;
+    } else {
+      break;
+    }
+  }
+
+  // Blocks that are still to be parsed are found in the new input from now
+  // on, those after the edit once the statements they're in have moved
+  if (bodyLines) {
+    *bodyLines = LineCounter(buf, size);
+    bodySource.reset();
+  }
+
+  // Errors are left for the whole parse to report. The new statements are
+  // allocated from the tree's own context, which takes back the storage of
+  // the ones they replace.
+  Driver parser;
+  parser.context = previous->getContext();
+  parser.should_use_simd_lexer = should_use_simd_lexer;
+  parser.should_use_pratt_parser = should_use_pratt_parser;
+  parser.should_outline = should_outline;
+  parser.bodyLines = bodyLines;
+  parser.reportErrors = false;
+  if (skipSpaceAndComments(buf + from, buf + to) < buf + to) {
+    yy::position start = first ? starts[first] : yy::position();
+    if (parser.parsePart(buf + from, to - from, start) || parser.errorCount || !parser.result) {
+      delete parser.result;
+      return parseAll();
+    }
+  } else if (last == count) {
+    // Nothing left at the end to take the end of the input's location from
+    return parseAll();
+  }
+
+  // The new statements take the old ones' place
+  NodeList &nodes = previous->getNodes();
+  NodeList added;
+  if (parser.result) added.swap(parser.result->getNodes());
+  delete parser.result;
+  for (size_t i = first; i < last; ++i) {
+    delete nodes[i];
+  }
+  nodes.erase(nodes.begin() + first, nodes.begin() + last);
+  nodes.insert(nodes.begin() + first, added.begin(), added.end());
+  for (ASTNode *node : added) {
+    node->setParent(previous);
+  }
+  starts.erase(starts.begin() + first, starts.begin() + last);
+  starts.insert(starts.begin() + first, parser.topLevelStarts.begin(),
+                parser.topLevelStarts.end());
+
+  // Unless the edit changed the number of lines, only the statements
+  // that begin on the line it ended on have moved
+  bool linesMoved = newEnd.line != edit.end.line;
+  for (size_t i = first + added.size(); i < nodes.size(); ++i) {
+    if (!linesMoved && starts[i].line != edit.end.line) break;
+    starts[i] = mover.moved(starts[i]);
+    nodes[i]->accept(mover);
+  }
+  if (last < count) {
+    location.begin = mover.moved(location.begin);
+    location.end = mover.moved(location.end);
+  } else {
+    location = parser.location;
+  }
+
+  return 0;
+}
 
-  yy::parser parser(*this);
-  parser.set_debug_level(should_trace_parsing);
-  int ret = parser.parse();
-  yy_delete_buffer(bs);
+int Driver::parseStream(FILE *in, StatementHandler handler) {
+  scanStream(in);
+  statementHandler = handler;
+  int ret = runParser();
+  statementHandler = nullptr;
+  scannerDestroy();
 
   return ret;
 }
 
+void Driver::pushBegin(StatementHandler handler) {
+  scannerInit();
+  statementHandler = handler;
+  pushFinished = false;
+  pushStatus = 1; // until the parser has run to the end
+
+  // Both scanners take what they're given a chunk at a time, as when
+  // streaming (see readInput)
+  if (should_use_simd_lexer) {
+    lexer.reset(new Lexer(*this, nullptr, stream_chunk_size));
+  }
+  // The handler runs on the parser's stack, which is as large as a
+  // thread's would be, though only the pages it touches are committed
+  pushParser.reset(new Coroutine([this]() { pushStatus = runParser(); },
+                                 kPushStackSize));
+}
+
+void Driver::feed(const char *chunk, size_t size) {
+  if (!pushParser || !size) return;
+
+  inputCursor = chunk;
+  inputEnd = chunk + size;
+  pushParser->resume();
+  inputCursor = inputEnd = nullptr;
+}
+
+int Driver::finish() {
+  if (!pushParser) return 1;
+
+  pushFinished = true;
+  pushParser->resume();
+  int ret = pushStatus;
+  statementHandler = nullptr;
+  scannerDestroy();
+
+  return ret;
+}
+
+void Driver::addTopLevelStatement(Block *file, ASTNode *statement, const yy::location &l) {
+  if (!statement) return; // in error, and recovered from
+
+  if (!statementHandler) {
+    file->insertAfter(statement);
+    topLevelStarts.push_back(l.begin);
+    return;
+  }
+
+  statementHandler(statement);
+  delete statement;
+
+  retiredTokenText.reset();
+  tokenText.swap(retiredTokenText);
+  retiredNames.clear();
+  names.swap(retiredNames);
+}
+
+size_t Driver::readInput(char *buf, size_t max_size, FILE *in) {
+  if (pushParser) {
+    // Waits for the caller to push more, unless there's no more to come
+    while (inputCursor == inputEnd && !pushFinished) {
+      pushParser->yield();
+    }
+    if (inputCursor == inputEnd) return 0;
+  }
+
+  if (inputCursor) {
+    size_t n = std::min(max_size, static_cast<size_t>(inputEnd - inputCursor));
+    memcpy(buf, inputCursor, n);
+    inputCursor += n;
+    return n;
+  }
+
+  if (!in) return 0;
+
+  // Reads no more than a chunk at a time, so that a pipe's contents are
+  // parsed as they arrive rather than once a whole buffer has filled
+  max_size = std::min(max_size, stream_chunk_size);
+
+  size_t n;
+  errno = 0;
+  while ((n = fread(buf, 1, max_size, in)) == 0 && ferror(in)) {
+    if (errno != EINTR) {
+      error(std::string("input in flex scanner failed: ") + strerror(errno));
+      break;
+    }
+    errno = 0;
+    clearerr(in);
+  }
+  return n;
+}
+
+StringRef Driver::keepText(const char *text, size_t length) {
+  if (source) {
+    const char *start = source->getBufferStart();
+    if (text >= start && text + length <= start + source->getBufferSize()) {
+      return StringRef(text, length);
+    }
+  }
+  return tokenText.copy(text, length);
+}
+
+StringRef Driver::takeLiteralText() {
+  StringRef text = tokenText.copy(literalText.data(), literalText.size());
+  literalText.clear();
+  return text;
+}
+
 void Driver::error(const yy::location& l, const std::string& msg) {
-  std::cerr << l << ": " << msg << '\n';
+  ++errorCount;
+  if (reportErrors) std::cerr << l << ": " << msg << '\n';
 }
 
 void Driver::error(const std::string& msg) {
-  std::cerr << msg << '\n';
+  ++errorCount;
+  if (reportErrors) std::cerr << msg << '\n';
+}
+
+void Driver::warning(const std::string& msg) {
+  if (reportErrors) std::cerr << "warning: " << msg << '\n';
+}
+
+void Driver::syntaxError(const yy::location& l, const std::string& msg) {
+  ++syntaxErrorCount;
+  error(l, msg);
 }
 
 }
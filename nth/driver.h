@@ -9,16 +9,44 @@
 #ifndef __nth__driver__
 #define __nth__driver__
 
+#include <cstdio>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <vector>
+#include "arena.h"
+#include "constant_pool.h"
 #include "parse.hh"
+#include "source_buffer.h"
+#include "string_ref.h"
+
+// Opaque handle to a reentrant flex scanner (matches the typedef in scan.h)
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void* yyscan_t;
+#endif
+struct yy_buffer_state;
 
 #define YY_DECL \
-  yy::parser::symbol_type yylex(nth::Driver& driver)
+  yy::parser::symbol_type yylex(nth::Driver& driver, yyscan_t yyscanner)
      // ... and declare it for the parser's sake.
 YY_DECL;
 
+// The parser only knows about the driver, which in turn
+// knows which scanner instance to pull tokens from.
+yy::parser::symbol_type yylex(nth::Driver& driver);
+
 namespace nth {
 
+class Coroutine;
+class Lexer;
+class LineCounter;
+class ParallelLexer;
+class TokenCacheReader;
+class TokenCacheWriter;
+
+// Each Driver owns its own scanner state, so separate
+// Driver instances may parse concurrently on different threads.
 class Driver {
 
  public:
@@ -30,15 +58,264 @@ class Driver {
   void scanEnd();
   bool should_trace_scanning;
 
+  // Prepares to scan size bytes of caller-owned memory (see parseBuffer)
+  void scanBuffer(const char *buf, size_t size);
+
+  // Next token from whichever scanner is active, with function blocks
+  // folded into a single BODY token when outlining
+  yy::parser::symbol_type lex();
+
+  // Scan with the hand-written Lexer rather than flex. Input that can't be
+  // mapped is read into memory first, as Lexer needs all of it up front.
+  bool should_use_simd_lexer;
+
+  // With the hand-written Lexer, input held in memory is split between
+  // this many threads when it's large enough (see ParallelLexer)
+  unsigned lexer_threads;
+
+  // Experimental, and off by default: it hasn't yet been shown to pay for
+  // itself on a machine with cores to spare (see the ParallelParse
+  // benchmark, which also reports how evenly the work divides).
+  //
+  // Input held in memory is cut into groups of top-level statements, up
+  // to this many, which are parsed at once on threads of their own with a
+  // Driver each (see splitTopLevel). The statements are gathered into one
+  // result, in order, just as though they'd been parsed together; should
+  // any group have an error, the whole input is parsed again in one go,
+  // so that errors are reported and recovered from exactly as they would
+  // be otherwise. Each group has a Lexer of its own, so lexer_threads
+  // doesn't apply. Not done when tracing or using the token cache.
+  unsigned parser_threads;
+
+  // When set, each scan's tokens are saved in this directory under a hash
+  // of the source, and a later parse of identical source replays them
+  // instead of scanning. Input that can't be mapped is read into memory
+  // first so that it can be hashed.
+  std::string token_cache_dir;
+
+  // Regular files are mapped into memory and scanned in place unless
+  // this is turned off, in which case they're read through stdio.
+  bool should_map_input;
+
+  // When turned off, the parser only checks the syntax: no node or list is
+  // built, result is left null and a streamed parse's handler is never
+  // called, so that a parse costs little more than the scan. Errors are
+  // reported just the same.
+  bool should_build_ast;
+
+  // Skips the blocks of function definitions in input held in memory,
+  // matching braces as it goes and keeping only where each block lies.
+  // A block is parsed the first time FunctionDef::getBlock() asks for it,
+  // and errors in it are reported then, so the input must stay valid until
+  // that's done (a mapped file stays mapped for as long as it's needed).
+  // Where only signatures are wanted, as for indexing, a parse then costs
+  // little more than scanning.
+  bool should_outline;
+
+  // Parses with the hand-written PrattParser rather than bison's, which
+  // builds the same tree and reports the same errors. bison's is still
+  // used for a syntax-only parse or when tracing.
+  bool should_use_pratt_parser;
+
+  // Each returns 0 if the input was free of syntax errors. They don't
+  // stop a parse: every one is reported, and result holds the statements
+  // around them, so that later passes can look for errors of their own.
+  // Lexical errors, such as a literal out of range, are reported too, but
+  // leave a well-formed tree and don't make the parse fail.
   int parse(const std::string& f);
   int parseString(const std::string &s);
+
+  // Parses size bytes of caller-owned memory, which is never copied as a
+  // whole and must remain valid until parsing is complete.
+  int parseBuffer(const char *buf, size_t size);
+
+  // Receives each top-level statement of a streamed parse as soon as it
+  // has been reduced. The statement is deleted when the handler returns,
+  // and the names in it are let go soon after, so a handler that keeps
+  // any must hold them (see NameCache).
+  typedef std::function<void(ASTNode *statement)> StatementHandler;
+
+  // Prepares to scan a stream stream_chunk_size bytes at a time, keeping
+  // only the text of the token in progress (see parseStream). The stream
+  // is left open for the caller to close.
+  void scanStream(FILE *in);
+
+  // Parses a stream of any length in bounded memory: input is read in
+  // chunks and dropped once scanned, and rather than being collected in
+  // result, statements go to handler one at a time. The token cache is
+  // not consulted, as that needs all of the input up front.
+  int parseStream(FILE *in, StatementHandler handler);
+
+  size_t stream_chunk_size;
+
+  // Starts a parse whose input is handed over by the caller as it arrives,
+  // for when it can't be read on demand (say it comes from an event loop).
+  // Each feed() scans and parses as far as its chunk allows, passing any
+  // statements completed along the way to handler (and rethrowing what it
+  // throws); the chunk needn't outlive the call. finish() marks the end of
+  // the input and returns as parse() would. The parser runs in a coroutine
+  // on this thread, so many inputs can be parsed at once without a thread
+  // apiece.
+  void pushBegin(StatementHandler handler);
+  void feed(const char *chunk, size_t size);
+  int finish();
+
+  // A change to the input of the last parse: the text from begin up to
+  // end, in that input's lines and columns (which count bytes, as
+  // locations do), was replaced by inserted bytes.
+  struct Edit {
+    yy::position begin;
+    yy::position end;
+    size_t inserted;
+  };
+
+  // Brings previous, the result of the last parse, up to date with an edit
+  // to its input, of which buf now holds all size bytes. Only the top-level
+  // statements the edit touches are parsed again, from the last to begin
+  // before it to the first to begin after it, and those either side are
+  // kept, their locations moved to match the new input. Returns as
+  // parseBuffer would, with result holding the tree.
+  //
+  // When that can't be done exactly (previous had errors or isn't this
+  // driver's result, or the statements don't parse cleanly on their own),
+  // all of buf is parsed again and previous is deleted.
+  int reparse(Block *previous, const char *buf, size_t size, const Edit &edit);
+
+  // Called by the parser with each top-level statement
+  void addTopLevelStatement(Block *file, ASTNode *statement, const yy::location &l);
   
   std::string file;
 
   bool should_trace_parsing;
 
+  yyscan_t scanner;
+  yy::location location;
+
+  // Called by the scanner whenever it needs more input
+  size_t readInput(char *buf, size_t max_size, FILE *in);
+
+  // String literals still open, innermost last. There can be several
+  // when literals nest inside #{...} interpolations.
+  struct OpenString {
+    bool interpolated; // a #{...} has been seen
+    int braceDepth;    // unmatched "{" in the current interpolation
+  };
+  std::vector<OpenString> openStrings;
+
+  // Decoded text of the literal segment being scanned
+  std::string literalText;
+
+  // Copies literalText into tokenText and clears it
+  StringRef takeLiteralText();
+
+  // Returns a view of token text that stays valid until scanning ends.
+  // Text already in the source buffer is referenced where it lies; text
+  // in flex's own refillable buffer is copied into tokenText.
+  StringRef keepText(const char *text, size_t length);
+
   void error(const yy::location& l, const std::string& msg);
   void error(const std::string& msg);
+  // An error that the parser had to recover from
+  void syntaxError(const yy::location& l, const std::string& msg);
+  // Reported like an error, but says nothing about the input, so it isn't
+  // counted as one
+  void warning(const std::string& msg);
+
+  // Errors reported since scanning began
+  int getErrorCount() const { return errorCount; }
+
+  // Values of the literals parsed so far, shared by their nodes. Cleared
+  // when scanning ends, which leaves the values to the tree.
+  ConstantPool constants;
+
+  // Names interned by the parse under way, so that each spelling takes the
+  // shared table's lock only once. They're handed to the context when it's
+  // done, to be held for as long as the tree.
+  NameCache names;
+
+  // Where the parser allocates nodes: a context of their own for each
+  // parse, handed to result when it's done and freed along with it (or
+  // for reparse, the context of the tree being brought up to date). Null
+  // when streaming, as statements are deleted as they're handled and a
+  // context would keep their memory until the end.
+  ASTContext *context;
+
+ protected:
+  void scannerInit();
+  void scannerDestroy();
+  int runParser();
+
+  // Parses [begin, end) as described for parser_threads, setting ret and
+  // returning true unless it wasn't worth doing or some group failed
+  bool parseInParallel(const char *begin, const char *end, int &ret);
+
+  // Parses part of an input in memory, starting at the given position
+  int parsePart(const char *buf, size_t size, const yy::position &start);
+
+  // Looks up source in the token cache. Returns true if its tokens will be
+  // replayed, otherwise arranges for them to be recorded as they're scanned.
+  bool openTokenCache(const char *buf, size_t size);
+
+  // Sets up Lexer, or ParallelLexer if it's worth it, over memory
+  void startLexer(const char *begin, const char *end);
+
+  // Next token from the scanner itself, bypassing the token cache
+  yy::parser::symbol_type scanToken();
+
+  // Next token from the token cache or scanner
+  yy::parser::symbol_type nextToken();
+
+  // Reads up to the "}" matching open, returning a BODY token that parses
+  // what's between them on demand (see should_outline)
+  yy::parser::symbol_type skipBody(const yy::location &open);
+  class SkippedBody;
+
+  std::shared_ptr<SourceBuffer> source;
+  yy_buffer_state *sourceBufferState; // flex buffer scanning source in place
+  std::unique_ptr<Lexer> lexer;       // set when should_use_simd_lexer
+  std::unique_ptr<ParallelLexer> parallelLexer; // ... and lexer_threads > 1
+  std::unique_ptr<TokenCacheReader> cachedTokens;
+  std::unique_ptr<TokenCacheWriter> tokenRecorder;
+  int errorCount; // a scan with errors isn't cached
+  int syntaxErrorCount;
+  bool reportErrors; // otherwise they're only counted
+  StatementHandler statementHandler;
+
+  // Where each top-level statement in result begins, as its location has
+  // it. That may be before the statement's first token, but never before
+  // the end of the statement ahead of it, so reparse can start there.
+  std::vector<yy::position> topLevelStarts;
+
+  // While pushing, the parser's coroutine, whether finish() has been
+  // called, and the status the parser returned
+  std::unique_ptr<Coroutine> pushParser;
+  bool pushFinished;
+  int pushStatus;
+  static const size_t kPushStackSize = 8 * 1024 * 1024;
+
+  // While streaming, token text is freed a statement at a time. The text
+  // of the statement before last is released, never the last one's, as
+  // the parser's lookahead token was scanned before it was reduced. Names
+  // are let go the same way.
+  Arena tokenText;
+  Arena retiredTokenText;
+  NameCache retiredNames;
+
+  FILE *openedInput; // opened by scanBegin for flex, closed by scanEnd
+
+  // When outlining: where tokens lie in the input, once a "def" has been
+  // seen whether its block is still to come, where skipped blocks are to
+  // be found (in the whole input, shared by every one of them so that
+  // reparse can point them at the edited input), and what keeps the input
+  // alive for them (nothing, if the caller owns it)
+  std::unique_ptr<LineCounter> inputLines;
+  bool awaitingBody;
+  std::shared_ptr<LineCounter> bodyLines;
+  std::shared_ptr<SourceBuffer> bodySource;
+
+  // Remaining caller-owned input handed out by readInput
+  const char *inputCursor;
+  const char *inputEnd;
 };
 
 }
@@ -0,0 +1,504 @@
+//
+//  flat_ast.cc
+//  nth
+//
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "flat_ast.h"
+#include "static_visitor.h"
+
+using namespace nth;
+
+namespace nth {
+
+// Appends each node it's given, followed by its children:
+//
+//   InterpolatedString  literal text as Strings, alternating with the
+//                       expressions, beginning and ending with text
+//   Map                 key and value, for each pair
+//   Range               start, end
+//   FunctionDef         name, List of type parameters, List of arguments,
+//                       return type, block
+//   LambdaDef           List of arguments, return type, body
+//   FunctionCall        callable, then the arguments
+//   VariableDef         name, type, value
+//   Argument            name, type
+//   IfElse              condition, if block, else block or None
+//   Templated types     name, then the subtypes
+//   Simple types        name
+//   TypeAliasDef        defined type, referenced type
+//
+// Operators have their operands as children, and the rest of the kinds have
+// their elements or statements.
+class Flattener : public StaticVisitor<Flattener> {
+ public:
+  explicit Flattener(FlatAST &flat) : flat(flat) {}
+
+  void add(ASTNode *node) {
+    if (node) {
+      dispatch(node);
+    } else {
+      close(open(Kind::None, nullptr));
+    }
+  }
+
+  void visitDummyNode(DummyNode *dummy) { throw "cannot flatten a dummy node"; }
+
+  void visitBlock(Block *block) {
+    Index index = open(Kind::Block, block);
+    for (auto node : block->getNodes()) add(node);
+    close(index);
+  }
+
+  void visitString(String *string) {
+    close(open(Kind::String, string, append(flat.strings, string->getSharedText())));
+  }
+
+  void visitInterpolatedString(InterpolatedString *string) {
+    Index index = open(Kind::InterpolatedString, string);
+    auto &literals = string->getLiterals();
+    auto &expressions = string->getExpressions();
+    for (size_t i = 0; i < literals.size(); i++) {
+      close(open(Kind::String, nullptr,
+                 append(flat.strings, SharedText(StringRef(literals[i])))));
+      if (i < expressions.size()) add(expressions[i]);
+    }
+    close(index);
+  }
+
+  void visitInteger(Integer *integer) {
+    close(open(Kind::Integer, integer, append(flat.integers, integer->getValue())));
+  }
+
+  void visitBigInteger(BigInteger *integer) {
+    close(open(Kind::BigInteger, integer,
+               append(flat.bigIntegers, integer->getSharedValue())));
+  }
+
+  void visitFloat(Float *flt) {
+    close(open(Kind::Float, flt, append(flat.floats, flt->getValue())));
+  }
+
+  void visitTrue(True *tru) { close(open(Kind::True, tru)); }
+  void visitFalse(False *flse) { close(open(Kind::False, flse)); }
+
+  void visitIdentifier(Identifier *ident) {
+    flat.names.hold(ident->getName());
+    close(open(Kind::Identifier, ident, ident->getName().getId()));
+  }
+
+  void visitArray(Array *array) {
+    Index index = open(Kind::Array, array);
+    for (auto value : array->getValues()) add(value);
+    close(index);
+  }
+
+  void visitPackedArray(PackedArray *array) {
+    close(open(Kind::PackedArray, array, append(flat.packedArrays, array->getValues())));
+  }
+
+  void visitMap(Map *map) {
+    Index index = open(Kind::Map, map);
+    for (auto &keyValue : map->getValues()) {
+      add(keyValue.first);
+      add(keyValue.second);
+    }
+    close(index);
+  }
+
+  void visitAdd(Add *add) { binary(Kind::Add, add); }
+  void visitSubtract(Subtract *subtract) { binary(Kind::Subtract, subtract); }
+  void visitMultiply(Multiply *multiply) { binary(Kind::Multiply, multiply); }
+  void visitDivide(Divide *divide) { binary(Kind::Divide, divide); }
+  void visitExponentiate(Exponentiate *exp) { binary(Kind::Exponentiate, exp); }
+  void visitModulo(Modulo *modulo) { binary(Kind::Modulo, modulo); }
+  void visitBitShiftLeft(BitShiftLeft *shift_left) { binary(Kind::BitShiftLeft, shift_left); }
+  void visitBitShiftRight(BitShiftRight *shift_right) { binary(Kind::BitShiftRight, shift_right); }
+  void visitBitwiseOr(BitwiseOr *bitwise_or) { binary(Kind::BitwiseOr, bitwise_or); }
+  void visitBitwiseAnd(BitwiseAnd *bitwise_and) { binary(Kind::BitwiseAnd, bitwise_and); }
+  void visitBitwiseNot(BitwiseNot *bitwise_not) { unary(Kind::BitwiseNot, bitwise_not); }
+  void visitLogicalOr(LogicalOr *logical_or) { binary(Kind::LogicalOr, logical_or); }
+  void visitLogicalAnd(LogicalAnd *logical_and) { binary(Kind::LogicalAnd, logical_and); }
+  void visitLogicalNot(LogicalNot *logical_not) { unary(Kind::LogicalNot, logical_not); }
+
+  void visitRange(Range *range) {
+    Index index = open(Kind::Range, range, static_cast<uint32_t>(range->getExclusivity()));
+    add(range->getStart());
+    add(range->getEnd());
+    close(index);
+  }
+
+  void visitTuple(Tuple *tuple) {
+    Index index = open(Kind::Tuple, tuple);
+    for (auto value : tuple->getValues()) add(value);
+    close(index);
+  }
+
+  void visitComparison(Comparison *comparison) {
+    binary(Kind::Comparison, comparison, static_cast<uint32_t>(comparison->getType()));
+  }
+  void visitSubscript(Subscript *subscript) { binary(Kind::Subscript, subscript); }
+  void visitFieldAccess(FieldAccess *field_access) { binary(Kind::FieldAccess, field_access); }
+  void visitTupleFieldAccess(TupleFieldAccess *tuple_field_access) {
+    binary(Kind::TupleFieldAccess, tuple_field_access);
+  }
+
+  void visitFunctionDef(FunctionDef *functionDef) {
+    Index index = open(Kind::FunctionDef, functionDef);
+    add(functionDef->getName());
+    addList(functionDef->getTypeParameters());
+    addList(functionDef->getArguments());
+    add(functionDef->getReturnType());
+    add(functionDef->getBlock());
+    close(index);
+  }
+
+  void visitLambdaDef(LambdaDef *lambdaDef) {
+    Index index = open(Kind::LambdaDef, lambdaDef);
+    addList(lambdaDef->getArguments());
+    add(lambdaDef->getReturnType());
+    add(lambdaDef->getBody());
+    close(index);
+  }
+
+  void visitFunctionCall(FunctionCall *functionCall) {
+    Index index = open(Kind::FunctionCall, functionCall);
+    add(functionCall->getCallable());
+    for (auto argExpr : functionCall->getArguments()) add(argExpr);
+    close(index);
+  }
+
+  void visitVariableDef(VariableDef *variableDef) {
+    Index index = open(Kind::VariableDef, variableDef);
+    add(variableDef->getName());
+    add(variableDef->getVarType());
+    add(variableDef->getValue());
+    close(index);
+  }
+
+  void visitArgument(Argument *argument) {
+    Index index = open(Kind::Argument, argument);
+    add(argument->getName());
+    add(argument->getType());
+    close(index);
+  }
+
+  void visitIfElse(IfElse *ifElse) {
+    Index index = open(Kind::IfElse, ifElse);
+    add(ifElse->getCond());
+    add(ifElse->getIfBlock());
+    add(ifElse->getElseBlock());
+    close(index);
+  }
+
+  void visitSimpleTypeRef(SimpleTypeRef *type) {
+    Index index = open(Kind::SimpleTypeRef, type);
+    add(type->getName());
+    close(index);
+  }
+
+  void visitSimpleTypeDef(SimpleTypeDef *type) {
+    Index index = open(Kind::SimpleTypeDef, type);
+    add(type->getName());
+    close(index);
+  }
+
+  void visitTemplatedTypeRef(TemplatedTypeRef *type) {
+    Index index = open(Kind::TemplatedTypeRef, type);
+    add(type->getName());
+    for (auto subtype : type->getSubtypes()) add(subtype);
+    close(index);
+  }
+
+  void visitTemplatedTypeDef(TemplatedTypeDef *type) {
+    Index index = open(Kind::TemplatedTypeDef, type);
+    add(type->getName());
+    for (auto subtype : type->getSubtypes()) add(subtype);
+    close(index);
+  }
+
+  void visitTypeAliasDef(TypeAliasDef *typeAliasDef) {
+    Index index = open(Kind::TypeAliasDef, typeAliasDef);
+    add(typeAliasDef->getLType());
+    add(typeAliasDef->getRType());
+    close(index);
+  }
+
+ protected:
+  typedef FlatAST::Index Index;
+  typedef FlatAST::Kind Kind;
+
+  // Appends a node, whose end is left for close
+  Index open(Kind kind, ASTNode *node, uint32_t payload = 0) {
+    if (flat.kinds.size() >= UINT32_MAX) throw std::length_error("tree too large to flatten");
+    Index index = static_cast<Index>(flat.kinds.size());
+    flat.kinds.push_back(kind);
+    flat.ends.push_back(0);
+    flat.payloads.push_back(payload);
+    if (node && hasLocation(node->getLocation())) {
+      flat.locations.emplace_back(index, node->getLocation());
+    }
+    return index;
+  }
+
+  // Whether the parser gave a node's location, which is otherwise left as
+  // an empty range at the start of no file in particular
+  static bool hasLocation(const yy::location &loc) {
+    return loc.begin.filename || loc.begin.line != 1 || loc.begin.column != 1 ||
+           loc.end.line != 1 || loc.end.column != 1;
+  }
+
+  // Ends the node after whatever has been appended since it was opened
+  void close(Index index) { flat.ends[index] = static_cast<Index>(flat.kinds.size()); }
+
+  template <typename Nodes> void addList(Nodes &nodes) {
+    Index index = open(Kind::List, nullptr);
+    for (auto node : nodes) add(node);
+    close(index);
+  }
+
+  void binary(Kind kind, BinaryOperation *bin_op, uint32_t payload = 0) {
+    Index index = open(kind, bin_op, payload);
+    add(bin_op->getLeftValue().get());
+    add(bin_op->getRightValue().get());
+    close(index);
+  }
+
+  void unary(Kind kind, UnaryOperation *un_op) {
+    Index index = open(kind, un_op);
+    add(un_op->getValue().get());
+    close(index);
+  }
+
+  template <typename T> static uint32_t append(std::vector<T> &table, const T &value) {
+    if (table.size() >= UINT32_MAX) throw std::length_error("tree too large to flatten");
+    table.push_back(value);
+    return static_cast<uint32_t>(table.size() - 1);
+  }
+
+  FlatAST &flat;
+};
+
+}
+
+FlatAST::FlatAST(ASTNode *root) {
+  Flattener(*this).add(root);
+}
+
+size_t FlatAST::getChildCount(Index node) const {
+  size_t count = 0;
+  for (Index child = node + 1; child < ends[node]; child = ends[child]) count++;
+  return count;
+}
+
+FlatAST::Index FlatAST::getChild(Index node, size_t n) const {
+  Index child = node + 1;
+  while (n--) child = ends[child];
+  return child;
+}
+
+const yy::location *FlatAST::getLocation(Index node) const {
+  auto found = std::lower_bound(locations.begin(), locations.end(), node,
+    [](const std::pair<Index, yy::location> &entry, Index node) {
+      return entry.first < node;
+    });
+  if (found == locations.end() || found->first != node) return nullptr;
+  return &found->second;
+}
+
+namespace {
+
+template <typename T> T *as(ASTNode *node) { return static_cast<T*>(node); }
+
+}
+
+template <typename T>
+std::vector<T*> FlatAST::inflateChildren(Index node, size_t first, ASTContext *context) const {
+  std::vector<T*> children;
+  size_t n = 0;
+  for (Index child = node + 1; child < ends[node]; child = ends[child], n++) {
+    if (n >= first) children.push_back(as<T>(inflate(child, context)));
+  }
+  return children;
+}
+
+ASTNode *FlatAST::inflate(Index node, ASTContext *context) const {
+  auto child = [&](size_t n) { return inflate(getChild(node, n), context); };
+
+  ASTNode *result;
+  switch (kinds[node]) {
+    case Kind::None:
+      return nullptr;
+    case Kind::List:
+      throw "a list is inflated along with its parent";
+
+    case Kind::Block: {
+      Block *block = new (context) Block();
+      for (auto statement : inflateChildren<ASTNode>(node, 0, context)) {
+        block->insertAfter(statement);
+      }
+      result = block;
+      break;
+    }
+    case Kind::String:
+      result = new (context) String(strings[payloads[node]]);
+      break;
+    case Kind::InterpolatedString: {
+      InterpolatedString *string = new (context) InterpolatedString();
+      size_t n = 0;
+      for (Index part = node + 1; part < ends[node]; part = ends[part], n++) {
+        if (n % 2 == 0) {
+          string->addLiteral(getString(part).str());
+        } else {
+          string->addExpression(as<Expression>(inflate(part, context)));
+        }
+      }
+      result = string;
+      break;
+    }
+    case Kind::Integer:
+      result = new (context) Integer(getInteger(node));
+      break;
+    case Kind::BigInteger:
+      result = new (context) BigInteger(bigIntegers[payloads[node]]);
+      break;
+    case Kind::Float:
+      result = new (context) Float(getFloat(node));
+      break;
+    case Kind::True:
+      result = new (context) True();
+      break;
+    case Kind::False:
+      result = new (context) False();
+      break;
+    case Kind::Identifier:
+      result = new (context) Identifier(getName(node));
+      break;
+    case Kind::Array:
+      result = new (context) Array(inflateChildren<Expression>(node, 0, context));
+      break;
+    case Kind::PackedArray:
+      result = new (context) PackedArray(PackedValues(getPackedValues(node)));
+      break;
+    case Kind::Map: {
+      ExpressionMap values;
+      auto parts = inflateChildren<Expression>(node, 0, context);
+      for (size_t i = 0; i + 1 < parts.size(); i += 2) {
+        values.emplace_back(as<String>(parts[i]), parts[i + 1]);
+      }
+      result = new (context) Map(std::move(values));
+      break;
+    }
+
+#define BINARY(Op) \
+    case Kind::Op: \
+      result = new (context) Op(ExpressionPtr(as<Expression>(child(0))), \
+                                ExpressionPtr(as<Expression>(child(1)))); \
+      break;
+    BINARY(Add)
+    BINARY(Subtract)
+    BINARY(Multiply)
+    BINARY(Divide)
+    BINARY(Exponentiate)
+    BINARY(Modulo)
+    BINARY(BitwiseOr)
+    BINARY(BitwiseAnd)
+    BINARY(LogicalOr)
+    BINARY(LogicalAnd)
+#undef BINARY
+
+    case Kind::BitShiftLeft:
+      result = new (context) BitShiftLeft(ExpressionPtr(as<Expression>(child(0))),
+                                          std::unique_ptr<Integer>(as<Integer>(child(1))));
+      break;
+    case Kind::BitShiftRight:
+      result = new (context) BitShiftRight(ExpressionPtr(as<Expression>(child(0))),
+                                           std::unique_ptr<Integer>(as<Integer>(child(1))));
+      break;
+    case Kind::BitwiseNot:
+      result = new (context) BitwiseNot(ExpressionPtr(as<Expression>(child(0))));
+      break;
+    case Kind::LogicalNot:
+      result = new (context) LogicalNot(ExpressionPtr(as<Expression>(child(0))));
+      break;
+    case Kind::Range:
+      result = new (context) Range(as<Integer>(child(0)), as<Integer>(child(1)),
+                                   getExclusivity(node));
+      break;
+    case Kind::Tuple:
+      result = new (context) Tuple(inflateChildren<Expression>(node, 0, context));
+      break;
+    case Kind::Comparison:
+      result = new (context) Comparison(ExpressionPtr(as<Expression>(child(0))),
+                                        ExpressionPtr(as<Expression>(child(1))),
+                                        getComparisonType(node));
+      break;
+    case Kind::Subscript:
+      result = new (context) Subscript(as<Expression>(child(0)), as<Expression>(child(1)));
+      break;
+    case Kind::FieldAccess:
+      result = new (context) FieldAccess(as<Expression>(child(0)), as<Identifier>(child(1)));
+      break;
+    case Kind::TupleFieldAccess:
+      result = new (context) TupleFieldAccess(as<Expression>(child(0)), as<Integer>(child(1)));
+      break;
+
+    case Kind::FunctionDef: {
+      FunctionBody body = { as<Block>(child(4)), nullptr };
+      result = new (context) FunctionDef(
+        as<Identifier>(child(0)),
+        inflateChildren<Argument>(getChild(node, 2), 0, context),
+        as<TypeRef>(child(3)),
+        body,
+        inflateChildren<TypeDef>(getChild(node, 1), 0, context));
+      break;
+    }
+    case Kind::LambdaDef:
+      result = new (context) LambdaDef(
+        inflateChildren<Argument>(getChild(node, 0), 0, context),
+        as<TypeRef>(child(1)),
+        as<Expression>(child(2)));
+      break;
+    case Kind::FunctionCall:
+      result = new (context) FunctionCall(as<Expression>(child(0)),
+                                          inflateChildren<Expression>(node, 1, context));
+      break;
+    case Kind::VariableDef:
+      result = new (context) VariableDef(as<Identifier>(child(0)), as<TypeRef>(child(1)),
+                                         as<Expression>(child(2)));
+      break;
+    case Kind::Argument:
+      result = new (context) Argument(as<Identifier>(child(0)), as<TypeRef>(child(1)));
+      break;
+    case Kind::IfElse:
+      result = new (context) IfElse(as<Expression>(child(0)), as<Block>(child(1)),
+                                    as<Block>(child(2)));
+      break;
+
+    case Kind::SimpleTypeRef:
+      result = new (context) SimpleTypeRef(as<Identifier>(child(0)));
+      break;
+    case Kind::SimpleTypeDef:
+      result = new (context) SimpleTypeDef(as<Identifier>(child(0)));
+      break;
+    case Kind::TemplatedTypeRef:
+      result = new (context) TemplatedTypeRef(as<Identifier>(child(0)),
+                                              inflateChildren<TypeRef>(node, 1, context));
+      break;
+    case Kind::TemplatedTypeDef:
+      result = new (context) TemplatedTypeDef(as<Identifier>(child(0)),
+                                              inflateChildren<TypeDef>(node, 1, context));
+      break;
+    case Kind::TypeAliasDef:
+      result = new (context) TypeAliasDef(as<TypeDef>(child(0)), as<TypeRef>(child(1)));
+      break;
+
+    default:
+      throw "cannot inflate a node of unknown kind";
+  }
+
+  if (const yy::location *loc = getLocation(node)) result->setLocation(*loc);
+  return result;
+}
@@ -0,0 +1,110 @@
+//
+//  flat_ast.h
+//  nth
+//
+
+#ifndef __nth__flat_ast__
+#define __nth__flat_ast__
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "ast.h"
+
+namespace nth {
+
+// A whole tree in a few parallel arrays rather than a node apiece on the
+// heap. Nodes are numbered in depth-first order: a node's descendants are
+// the nodes after it up to its end, its first child (if it has any) comes
+// right after it, and each child ends where its next sibling begins. A
+// pass over the tree is a walk along the arrays.
+//
+// Each node has a kind, the end of its subtree, and a 32-bit payload whose
+// meaning depends on the kind. For an Identifier it is the name's id. For
+// literals it is an index into the table of values of that kind. For a
+// Comparison or Range it is the operator. A kind's children always come
+// in the same order, listed in flat_ast.cc. A None node stands in for a
+// missing child, such as an absent else block. A List node holds a list
+// that is not the last child, such as a function's arguments.
+//
+// A FlatAST is built from a pointer tree. inflate() builds a pointer tree
+// back from it, so that passes written as Visitors still run.
+class FlatAST {
+ public:
+  typedef uint32_t Index;
+
+  // A kind for each class of node (see ast_nodes.def), and two of its own
+  enum class Kind : uint8_t {
+    None, List,
+#define NODE(Class) Class,
+#include "ast_nodes.def"
+  };
+
+  // Copies the tree under root, which is left as it was. A function whose
+  // block an outline parse skipped has the block parsed first.
+  explicit FlatAST(ASTNode *root);
+
+  size_t size() const { return kinds.size(); }
+
+  Kind getKind(Index node) const { return kinds[node]; }
+  // One past the node's last descendant, and so its next sibling
+  Index getEnd(Index node) const { return ends[node]; }
+
+  size_t getChildCount(Index node) const;
+  Index getChild(Index node, size_t n) const;
+
+  Name getName(Index node) const { return Name::fromId(payloads[node]); }
+  long getInteger(Index node) const { return integers[payloads[node]]; }
+  double getFloat(Index node) const { return floats[payloads[node]]; }
+  StringRef getString(Index node) const { return strings[payloads[node]].ref(); }
+  const BigInteger::Value &getBigInteger(Index node) const {
+    return *bigIntegers[payloads[node]];
+  }
+  const PackedValues &getPackedValues(Index node) const {
+    return packedArrays[payloads[node]];
+  }
+  Comparison::Type getComparisonType(Index node) const {
+    return static_cast<Comparison::Type>(payloads[node]);
+  }
+  Range::Exclusivity getExclusivity(Index node) const {
+    return static_cast<Range::Exclusivity>(payloads[node]);
+  }
+
+  // Where the parser found the node, or nullptr if it recorded nowhere
+  const yy::location *getLocation(Index node) const;
+
+  // A new pointer tree of the node and its descendants, allocated from
+  // context if one is given. It has no symbol tables or types yet, and its
+  // names are held by this FlatAST, which it mustn't outlive.
+  ASTNode *inflate(Index node = 0, ASTContext *context = nullptr) const;
+
+ protected:
+  friend class Flattener;
+
+  // The children of node from the first'th on, inflated
+  template <typename T>
+  std::vector<T*> inflateChildren(Index node, size_t first, ASTContext *context) const;
+
+  std::vector<Kind> kinds;
+  std::vector<Index> ends;
+  std::vector<uint32_t> payloads;
+
+  // Values too wide for a payload, each kind in a table of its own
+  std::vector<long> integers;
+  std::vector<double> floats;
+  std::vector<SharedText> strings;
+  std::vector<std::shared_ptr<const BigInteger::Value>> bigIntegers;
+  std::vector<PackedValues> packedArrays;
+
+  // Only the few nodes that have a location, in order of index
+  std::vector<std::pair<Index, yy::location>> locations;
+
+  // Identifiers' names, held for as long as this is
+  NameCache names;
+};
+
+}
+
+#endif /* defined(__nth__flat_ast__) */
@@ -0,0 +1,725 @@
+//
+//  lexer.cc
+//  nth
+//
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "driver.h"
+#include "lexer.h"
+#include "numeric_literal.h"
+#include "simd.h"
+#include "string_escapes.h"
+#include "utf8.h"
+
+using namespace nth;
+
+namespace {
+
+inline bool isHorizontalSpace(char c) { return c == ' ' || c == '\t'; }
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+inline bool isLetter(char c) { return (c | 0x20) >= 'a' && (c | 0x20) <= 'z'; }
+inline bool isIdentifierChar(char c) {
+  return isLetter(c) || isDigit(c) || c == '_';
+}
+inline bool isStringSpecial(char c) {
+  return c == '"' || c == '\\' || c == '#' || c == '\n';
+}
+inline bool isOctalDigit(char c) { return c >= '0' && c <= '7'; }
+inline bool isHexDigit(char c) {
+  return isDigit(c) || ((c | 0x20) >= 'a' && (c | 0x20) <= 'f');
+}
+
+// The scanning primitives below all return the first position in [p, end)
+// whose byte is not in (skip*) or is in (find*) some class. Vector loads
+// stop short of end rather than relying on the sentinel bytes after a
+// mapped file: caller-owned buffers may end right at an unmapped page.
+
+#if defined(__AVX2__) || defined(__SSE2__)
+
+using namespace nth::simd;
+
+inline Vector horizontalSpaceLanes(Vector v) {
+  return either(equal(v, splat(' ')), equal(v, splat('\t')));
+}
+inline Vector digitLanes(Vector v) { return inRange(v, '0', '9'); }
+inline Vector identifierLanes(Vector v) {
+  return either(either(inRange(either(v, splat(0x20)), 'a', 'z'), digitLanes(v)),
+                equal(v, splat('_')));
+}
+
+template <class Lanes, class Scalar>
+inline const char *skip(const char *p, const char *end, Lanes inClass,
+                        Scalar scalarInClass) {
+  for (; end - p >= kVectorSize; p += kVectorSize) {
+    uint32_t outside = ~lanes(inClass(load(p))) & kAllLanes;
+    if (outside) return p + __builtin_ctz(outside);
+  }
+  while (p < end && scalarInClass(*p)) ++p;
+  return p;
+}
+
+template <class Lanes, class Scalar>
+inline const char *find(const char *p, const char *end, Lanes inClass,
+                        Scalar scalarInClass) {
+  for (; end - p >= kVectorSize; p += kVectorSize) {
+    uint32_t inside = lanes(inClass(load(p)));
+    if (inside) return p + __builtin_ctz(inside);
+  }
+  while (p < end && !scalarInClass(*p)) ++p;
+  return p;
+}
+
+const char *skipHorizontalSpace(const char *p, const char *end) {
+  return skip(p, end, horizontalSpaceLanes, isHorizontalSpace);
+}
+
+const char *skipDigits(const char *p, const char *end) {
+  return skip(p, end, digitLanes, isDigit);
+}
+
+const char *skipIdentifierChars(const char *p, const char *end) {
+  return skip(p, end, identifierLanes, isIdentifierChar);
+}
+
+// Next byte in a string literal's text that isn't copied through as is
+const char *findStringSpecial(const char *p, const char *end) {
+  return find(p, end,
+              [](Vector v) {
+                return either(either(equal(v, splat('"')), equal(v, splat('\\'))),
+                              either(equal(v, splat('#')), equal(v, splat('\n'))));
+              },
+              isStringSpecial);
+}
+
+// Next byte a block comment body has to look at
+const char *findStarOrNewline(const char *p, const char *end) {
+  return find(p, end,
+              [](Vector v) {
+                return either(equal(v, splat('*')), equal(v, splat('\n')));
+              },
+              [](char c) { return c == '*' || c == '\n'; });
+}
+
+#else
+
+template <class Scalar>
+inline const char *skip(const char *p, const char *end, Scalar inClass) {
+  while (p < end && inClass(*p)) ++p;
+  return p;
+}
+
+const char *skipHorizontalSpace(const char *p, const char *end) {
+  return skip(p, end, isHorizontalSpace);
+}
+
+const char *skipDigits(const char *p, const char *end) {
+  return skip(p, end, isDigit);
+}
+
+const char *skipIdentifierChars(const char *p, const char *end) {
+  return skip(p, end, isIdentifierChar);
+}
+
+const char *findStringSpecial(const char *p, const char *end) {
+  return skip(p, end, [](char c) { return !isStringSpecial(c); });
+}
+
+const char *findStarOrNewline(const char *p, const char *end) {
+  return skip(p, end, [](char c) { return c != '*' && c != '\n'; });
+}
+
+#endif
+
+const char *findNewline(const char *p, const char *end) {
+  const void *nl = memchr(p, '\n', end - p);
+  return nl ? static_cast<const char*>(nl) : end;
+}
+
+// Optional exponent at p, as in scan.l's EXP
+const char *skipExponent(const char *p, const char *end) {
+  if (p == end || (*p != 'e' && *p != 'E')) return p;
+  const char *q = p + 1;
+  if (q < end && (*q == '-' || *q == '+')) ++q;
+  if (q == end || !isDigit(*q)) return p;
+  return skipDigits(q, end);
+}
+
+}
+
+namespace {
+
+// The most scan() ever looks past the end of the token it returns, e.g. at
+// "e+x" after "1.5" while trying for an exponent
+const ptrdiff_t kLookahead = 4;
+
+// How far validate() checks ahead at once: enough to keep the vectors busy,
+// little enough to still be in cache when the scan catches up
+const ptrdiff_t kValidationWindow = 64 * 1024;
+
+}
+
+Lexer::Lexer(Driver &driver, const char *begin, const char *end)
+  : driver(driver), cursor(begin), end(end), limit(end), validUntil(begin),
+    in(nullptr), chunkSize(0), exhausted(true) {}
+
+Lexer::Lexer(Driver &driver, FILE *in, size_t chunkSize)
+  : driver(driver), cursor(nullptr), end(nullptr), limit(nullptr), validUntil(nullptr),
+    in(in), chunkSize(std::max<size_t>(chunkSize, 1)), exhausted(false) {}
+
+yy::parser::symbol_type Lexer::lex() {
+  if (exhausted) {
+    yy::parser::symbol_type symbol = scan();
+    flush();
+    return symbol;
+  }
+
+  for (;;) {
+    const char *start = cursor;
+    yy::location startLocation = driver.location;
+    size_t openCount = driver.openStrings.size();
+    Driver::OpenString innermost =
+      openCount ? driver.openStrings.back() : Driver::OpenString{false, 0};
+
+    yy::parser::symbol_type symbol = scan();
+    if (exhausted || end - cursor >= kLookahead) {
+      flush();
+      return symbol;
+    }
+
+    // The token may go on past what's been read so far. Put everything
+    // back as it was and try again with more input.
+    cursor = start;
+    driver.location = startLocation;
+    driver.openStrings.resize(openCount);
+    if (openCount) driver.openStrings.back() = innermost;
+    pending.clear();
+    refill();
+  }
+}
+
+void Lexer::refill() {
+  // Reading at least as much as is kept means a token far longer than a
+  // chunk is rescanned only a logarithmic number of times
+  size_t kept = end - cursor;
+  size_t wanted = std::max(chunkSize, kept);
+  if (buffer.size() < kept + wanted) {
+    std::vector<char> larger(kept + wanted);
+    if (kept) memcpy(larger.data(), cursor, kept);
+    buffer.swap(larger);
+  } else if (kept) {
+    memmove(buffer.data(), cursor, kept);
+  }
+
+  size_t n = driver.readInput(buffer.data() + kept, wanted, in);
+  cursor = buffer.data();
+  end = cursor + kept + n;
+  limit = end;
+  validUntil = cursor;
+  if (n == 0) exhausted = true;
+}
+
+yy::parser::symbol_type Lexer::scan() {
+  // Location bookkeeping deliberately mirrors scan.l step for step
+  // (columns for every match, step() on entry and after blanks and line
+  // comments only) so that both scanners report identical locations.
+  yy::location &loc = driver.location;
+  loc.step();
+
+  for (;;) {
+    if (cursor >= limit) return yy::parser::make_END(loc);
+
+    const char *start = cursor;
+    char next = cursor + 1 < end ? cursor[1] : '\0';
+
+    switch (*cursor) {
+      case ' ':
+      case '\t':
+        cursor = skipHorizontalSpace(cursor + 1, end);
+        loc.columns(cursor - start);
+        loc.step();
+        continue;
+
+      case '\n':
+        ++cursor;
+        loc.columns(1);
+        loc.lines(1);
+        continue;
+
+      case '/':
+        if (next == '/') {
+          cursor = findNewline(cursor + 2, end);
+          loc.columns(cursor - start);
+          // As scan.l matches the comment whole, malformed bytes in it
+          // are reported at its location
+          for (const char *p = start + 2; std::max(p, validUntil) < cursor; ) {
+            p = std::max(p, validUntil);
+            if (!validate(p)) {
+              error(loc, "invalid UTF-8");
+              ++p;
+            }
+          }
+          loc.step();
+          continue;
+        }
+        if (next == '*') {
+          cursor += 2;
+          loc.columns(2);
+          if (finishBlockComment()) continue;
+          error(loc, "unterminated comment");
+          return yy::parser::make_END(loc);
+        }
+        cursor += 1;
+        loc.columns(1);
+        trace(start);
+        return yy::parser::make_DIVIDE(loc);
+
+      case '"':
+        driver.openStrings.push_back(Driver::OpenString{false, 0});
+        cursor += 1;
+        loc.columns(1);
+        return lexStringText(start);
+
+      case '+':
+      case '-':
+        if (isDigit(next)) return lexNumber(start);
+        cursor += 1;
+        loc.columns(1);
+        trace(start);
+        return *start == '+' ? yy::parser::make_PLUS(loc)
+                             : yy::parser::make_MINUS(loc);
+
+      case '0': case '1': case '2': case '3': case '4':
+      case '5': case '6': case '7': case '8': case '9':
+        return lexNumber(start);
+
+      default:
+        break;
+    }
+
+    if (isLetter(*cursor)) {
+      ++cursor;
+      return lexWord(start);
+    }
+
+    if (*cursor & 0x80) {
+      // A character other than those that can begin an identifier, or a
+      // malformed byte, is reported and skipped like scan.l's catch-alls
+      uint32_t c;
+      size_t length = decodeUtf8(cursor, end, c);
+      if (length && isIdentifierStart(c)) {
+        cursor += length;
+        return lexWord(start);
+      }
+      cursor += std::max<size_t>(length, 1);
+      loc.columns(cursor - start);
+      error(loc, length ? "invalid character" : "invalid UTF-8");
+      continue;
+    }
+
+    // Everything else is punctuation, longest operator first
+    auto accept = [&](size_t length) {
+      cursor += length;
+      loc.columns(length);
+      trace(start);
+    };
+
+    switch (*cursor) {
+      case '*': accept(1); return yy::parser::make_TIMES(loc);
+      case '^': accept(1); return yy::parser::make_POW(loc);
+      case '%': accept(1); return yy::parser::make_MODULO(loc);
+      case '~': accept(1); return yy::parser::make_BIT_NOT(loc);
+      case ',': accept(1); return yy::parser::make_COMMA(loc);
+      case '(': accept(1); return yy::parser::make_LPAREN(loc);
+      case ')': accept(1); return yy::parser::make_RPAREN(loc);
+      case '[': accept(1); return yy::parser::make_LBRACKET(loc);
+      case ']': accept(1); return yy::parser::make_RBRACKET(loc);
+      case '{':
+        // Counted inside an interpolation (see lexStringText)
+        if (!driver.openStrings.empty()) {
+          ++driver.openStrings.back().braceDepth;
+        }
+        accept(1);
+        return yy::parser::make_LCURLY(loc);
+
+      case '}':
+        if (!driver.openStrings.empty()) {
+          if (driver.openStrings.back().braceDepth == 0) {
+            // Ends the interpolation; the literal's text resumes
+            cursor += 1;
+            loc.columns(1);
+            return lexStringText(start);
+          }
+          --driver.openStrings.back().braceDepth;
+        }
+        accept(1);
+        return yy::parser::make_RCURLY(loc);
+      case ':': accept(1); return yy::parser::make_COLON(loc);
+      case ';': accept(1); return yy::parser::make_SEMICOLON(loc);
+
+      case '=':
+        if (next == '=') {
+          accept(2);
+          return yy::parser::make_CMP(Comparison::Type::Equality, loc);
+        }
+        if (next == '>') {
+          accept(2);
+          return yy::parser::make_HASH_ROCKET(loc);
+        }
+        accept(1);
+        return yy::parser::make_ASSIGN(loc);
+
+      case '!':
+        if (next == '=') {
+          accept(2);
+          return yy::parser::make_CMP(Comparison::Type::Inequality, loc);
+        }
+        accept(1);
+        return yy::parser::make_NOT(loc);
+
+      case '<':
+        if (next == '<') {
+          accept(2);
+          return yy::parser::make_LSHIFT(loc);
+        }
+        if (next == '=') {
+          accept(2);
+          return yy::parser::make_CMP(Comparison::Type::LessThanOrEqualTo, loc);
+        }
+        accept(1);
+        return yy::parser::make_CMP(Comparison::Type::LessThan, loc);
+
+      case '>':
+        if (next == '>') {
+          accept(2);
+          return yy::parser::make_RSHIFT(loc);
+        }
+        if (next == '=') {
+          accept(2);
+          return yy::parser::make_CMP(Comparison::Type::GreaterThanOrEqualTo, loc);
+        }
+        accept(1);
+        return yy::parser::make_CMP(Comparison::Type::GreaterThan, loc);
+
+      case '&':
+        if (next == '&') {
+          accept(2);
+          return yy::parser::make_AND(loc);
+        }
+        accept(1);
+        return yy::parser::make_BIT_AND(loc);
+
+      case '|':
+        if (next == '|') {
+          accept(2);
+          return yy::parser::make_OR(loc);
+        }
+        accept(1);
+        return yy::parser::make_BIT_OR(loc);
+
+      case '.':
+        if (next == '.') {
+          if (cursor + 2 < end && cursor[2] == '.') {
+            accept(3);
+            return yy::parser::make_TRIPLE_DOT(loc);
+          }
+          accept(2);
+          return yy::parser::make_DOUBLE_DOT(loc);
+        }
+        accept(1);
+        return yy::parser::make_PERIOD(loc);
+
+      default:
+        // Like scan.l's catch-all rule: report it and carry on without
+        // stepping the location.
+        ++cursor;
+        loc.columns(1);
+        error(loc, "invalid character");
+        continue;
+    }
+  }
+}
+
+yy::parser::symbol_type Lexer::lexNumber(const char *start) {
+  // scan.l has six numeric rules; flex takes the longest match and breaks
+  // ties by rule order, so measure each candidate and do the same.
+  enum Rule { Float, Decimal, Hex, Binary, Octal };
+
+  const char *p = start;
+  if (*p == '-' || *p == '+') ++p;
+  const char *digitsEnd = skipDigits(p, end);
+
+  // [-+]?(0|([1-9]{DIGIT}*))
+  Rule rule = Decimal;
+  const char *matchEnd = *p == '0' ? p + 1 : digitsEnd;
+
+  // [-+]?{DIGIT}+"."{DIGIT}+{EXP}?
+  if (digitsEnd + 1 < end && *digitsEnd == '.' && isDigit(digitsEnd[1])) {
+    const char *q = skipExponent(skipDigits(digitsEnd + 1, end), end);
+    if (q > matchEnd) {
+      rule = Float;
+      matchEnd = q;
+    }
+  }
+
+  // [-+]?[1-9]{DIGIT}*{EXP}
+  if (*p != '0') {
+    const char *q = skipExponent(digitsEnd, end);
+    if (q > matchEnd) {
+      rule = Float;
+      matchEnd = q;
+    }
+  }
+
+  // Prefixed forms never take a sign
+  if (p == start && *p == '0' && p + 2 <= end) {
+    const char *q = p + 2;
+    if (p[1] == 'x' && q < end && isHexDigit(*q)) {
+      while (q < end && isHexDigit(*q)) ++q;
+      if (q > matchEnd) {
+        rule = Hex;
+        matchEnd = q;
+      }
+    } else if (p[1] == 'b' && q < end && (*q == '0' || *q == '1')) {
+      while (q < end && (*q == '0' || *q == '1')) ++q;
+      if (q > matchEnd) {
+        rule = Binary;
+        matchEnd = q;
+      }
+    } else if (isOctalDigit(p[1])) {
+      q = p + 1;
+      while (q < end && isOctalDigit(*q)) ++q;
+      if (q > matchEnd) {
+        rule = Octal;
+        matchEnd = q;
+      }
+    }
+  }
+
+  cursor = matchEnd;
+  driver.location.columns(cursor - start);
+  trace(start);
+
+  yy::location &loc = driver.location;
+  if (rule == Float) {
+    double value;
+    if (!decodeFloat(start, cursor, value)) {
+      error(loc, "float literal out of range");
+    }
+    return yy::parser::make_FLOAT(value, loc);
+  }
+
+  const char *digits = rule == Hex || rule == Binary ? start + 2 : start;
+  int base = rule == Decimal ? 10 : rule == Hex ? 16 : rule == Binary ? 2 : 8;
+  long value;
+  if (!decodeInteger(digits, cursor, base, value)) {
+    return yy::parser::make_BIGINT(keep(start, cursor - start), loc);
+  }
+  return yy::parser::make_INT(value, loc);
+}
+
+yy::parser::symbol_type Lexer::lexWord(const char *start) {
+  // From just past the first character
+  for (;;) {
+    cursor = skipIdentifierChars(cursor, end);
+    if (cursor == end || !(*cursor & 0x80)) break;
+    uint32_t c;
+    size_t length = decodeUtf8(cursor, end, c);
+    if (!length || !isIdentifierContinue(c)) break;
+    cursor += length;
+  }
+  size_t length = cursor - start;
+  yy::location &loc = driver.location;
+  loc.columns(length);
+  trace(start);
+
+  switch (length) {
+    case 2:
+      if (!memcmp(start, "if", 2)) return yy::parser::make_IF(loc);
+      break;
+    case 3:
+      if (!memcmp(start, "def", 3)) return yy::parser::make_DEF(loc);
+      if (!memcmp(start, "val", 3)) return yy::parser::make_VAL(loc);
+      break;
+    case 4:
+      if (!memcmp(start, "else", 4)) return yy::parser::make_ELSE(loc);
+      if (!memcmp(start, "type", 4)) return yy::parser::make_TYPE(loc);
+      if (!memcmp(start, "true", 4)) return yy::parser::make_TRUE(loc);
+      break;
+    case 5:
+      if (!memcmp(start, "class", 5)) return yy::parser::make_CLASS(loc);
+      if (!memcmp(start, "false", 5)) return yy::parser::make_FALSE(loc);
+      break;
+  }
+
+  return yy::parser::make_IDENT(keep(start, length), loc);
+}
+
+bool Lexer::finishBlockComment() {
+  yy::location &loc = driver.location;
+  for (;;) {
+    if (cursor >= validUntil && cursor != end && !validate(cursor)) {
+      ++cursor;
+      loc.columns(1);
+      error(loc, "invalid UTF-8");
+      continue;
+    }
+
+    const char *stop = findStarOrNewline(cursor, std::max(cursor, validUntil));
+    loc.columns(stop - cursor);
+    cursor = stop;
+    if (cursor == end) return false;
+
+    if (cursor == validUntil) {
+      continue;
+    } else if (*cursor == '\n') {
+      ++cursor;
+      loc.columns(1);
+      loc.lines(1);
+    } else if (cursor + 1 < end && cursor[1] == '/') {
+      cursor += 2;
+      loc.columns(2);
+      return true;
+    } else {
+      ++cursor;
+      loc.columns(1);
+    }
+  }
+}
+
+yy::parser::symbol_type Lexer::lexStringText(const char *start) {
+  // Text runs up to the closing quote or the next #{. Until an escape
+  // turns up, the token can refer to the input where it lies; after that
+  // the decoded text is collected in driver.literalText.
+  yy::location &loc = driver.location;
+  Driver::OpenString &open = driver.openStrings.back();
+  const char *text = cursor;
+  bool decoding = false;
+
+  for (;;) {
+    if (cursor >= validUntil && cursor != end && !validate(cursor)) {
+      // Kept in the text, as scan.l does
+      if (decoding) driver.literalText += *cursor;
+      ++cursor;
+      loc.columns(1);
+      error(loc, "invalid UTF-8");
+      continue;
+    }
+
+    const char *stop = findStringSpecial(cursor, std::max(cursor, validUntil));
+    if (decoding) driver.literalText.append(cursor, stop);
+    loc.columns(stop - cursor);
+    cursor = stop;
+
+    if (cursor == end) {
+      error(loc, "unterminated string literal");
+      return yy::parser::make_END(loc);
+    }
+
+    if (cursor == validUntil) {
+      continue;
+    } else if (*cursor == '\n') {
+      if (decoding) driver.literalText += '\n';
+      cursor += 1;
+      loc.columns(1);
+      loc.lines(1);
+    } else if (*cursor == '#' && (cursor + 1 == end || cursor[1] != '{')) {
+      if (decoding) driver.literalText += '#';
+      cursor += 1;
+      loc.columns(1);
+    } else if (*cursor == '\\') {
+      if (!decoding) {
+        driver.literalText.assign(text, cursor);
+        decoding = true;
+      }
+      if (cursor + 1 == end) {
+        driver.literalText += '\\';
+        cursor += 1;
+        loc.columns(1);
+        continue;
+      }
+
+      // A backslash before a non-ASCII character takes all of it
+      size_t length = 2;
+      if (cursor[1] & 0x80) {
+        uint32_t c;
+        length = 1 + std::max<size_t>(decodeUtf8(cursor + 1, end, c), 1);
+      }
+
+      char decoded;
+      loc.columns(length);
+      if (decodeEscape(cursor[1], decoded)) {
+        driver.literalText += decoded;
+      } else {
+        error(loc, "invalid escape sequence");
+        driver.literalText.append(cursor, length);
+      }
+      if (cursor[1] == '\n') loc.lines(1);
+      cursor += length;
+    } else {
+      break;
+    }
+  }
+
+  StringRef value = decoding ? driver.takeLiteralText()
+                             : keep(text, cursor - text);
+
+  if (*cursor == '#') {
+    cursor += 2;
+    loc.columns(2);
+    trace(start);
+    bool first = !open.interpolated;
+    open.interpolated = true;
+    open.braceDepth = 0;
+    return first ? yy::parser::make_STRING_HEAD(value, loc)
+                 : yy::parser::make_STRING_MID(value, loc);
+  }
+
+  cursor += 1;
+  loc.columns(1);
+  trace(start);
+  bool interpolated = open.interpolated;
+  driver.openStrings.pop_back();
+  return interpolated ? yy::parser::make_STRING_TAIL(value, loc)
+                      : yy::parser::make_STRING(value, loc);
+}
+
+bool Lexer::validate(const char *p) {
+  // The window is widened to take in a character cut off at its end
+  const char *stop = p + std::min(end - p, kValidationWindow);
+  for (int i = 0; i < 3 && stop < end && (*stop & 0xc0) == 0x80; ++i) ++stop;
+  validUntil = findInvalidUtf8(p, stop);
+  return validUntil != p;
+}
+
+StringRef Lexer::keep(const char *text, size_t length) {
+  // Streamed text is overwritten by the next refill
+  return chunkSize ? driver.keepText(text, length) : StringRef(text, length);
+}
+
+void Lexer::error(const yy::location &loc, const std::string &message) {
+  pending.push_back(Output{true, loc, message});
+}
+
+void Lexer::trace(const char *start) {
+  if (driver.should_trace_scanning) {
+    pending.push_back(Output{false, yy::location(),
+                             "--lexer accepting \"" + std::string(start, cursor) + "\"\n"});
+  }
+}
+
+void Lexer::flush() {
+  for (const Output &output : pending) {
+    if (output.isError) {
+      driver.error(output.loc, output.text);
+    } else {
+      std::cerr << output.text;
+    }
+  }
+  pending.clear();
+}
@@ -0,0 +1,97 @@
+//
+//  lexer.h
+//  nth
+//
+
+#ifndef __nth__lexer__
+#define __nth__lexer__
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "parse.hh"
+
+namespace nth {
+
+class Driver;
+
+// Hand-written replacement for the flex scanner in scan.l. It accepts the
+// same language and builds the same yy::parser symbols, with the same
+// locations, but scans the whole input in place without ever writing to
+// it. Runs of whitespace, comment and string bodies, identifiers and digits
+// are stepped over a vector at a time where the target supports SSE2 or
+// AVX2. Input is checked to be UTF-8 (see utf8.h) a window at a time just
+// ahead of the scan, so comment and string bodies can still be skipped
+// without looking at each character.
+//
+// The input must stay valid and unchanged until scanning is complete.
+// Alternatively a stream can be scanned a chunk at a time, in which case
+// text is dropped once it has been scanned and the buffer holds little
+// more than a chunk and the token in progress. Streamed input is read
+// through Driver::readInput, so in may be null if the driver has some
+// other source for it (see Driver::feed).
+class Lexer {
+ public:
+  Lexer(Driver &driver, const char *begin, const char *end);
+  Lexer(Driver &driver, FILE *in, size_t chunkSize);
+
+  yy::parser::symbol_type lex();
+
+ protected:
+  // Scans one token from whatever is buffered
+  yy::parser::symbol_type scan();
+
+  // Discards text before the cursor and reads another chunk after the
+  // rest, setting exhausted once the stream has nothing more to give
+  void refill();
+
+  yy::parser::symbol_type lexNumber(const char *start);
+  yy::parser::symbol_type lexWord(const char *start);
+
+  // Text of a string literal from the cursor, which is just past its
+  // opening quote or the "}" ending an interpolation
+  yy::parser::symbol_type lexStringText(const char *start);
+
+  // Skips the rest of a block comment from the cursor. Returns false if
+  // the input ran out before the comment ended.
+  bool finishBlockComment();
+
+  // Checks the input from p, which is at or past validUntil, moving
+  // validUntil on to the next malformed byte or the end of a window.
+  // Returns false if the byte at p is itself malformed.
+  bool validate(const char *p);
+
+  // Token text that stays valid after the buffer is refilled
+  StringRef keep(const char *text, size_t length);
+
+  // Errors and trace output are held back until lex() is sure of its
+  // token, as a token cut short by the end of the buffer is scanned again
+  // once more input has been read.
+  void error(const yy::location &loc, const std::string &message);
+  void trace(const char *start);
+  void flush();
+
+  Driver &driver;
+  const char *cursor;
+  const char *end;
+  const char *limit;    // scan() returns END at the first token boundary here
+                        // or beyond; normally end (see ParallelLexer)
+  const char *validUntil; // input before here is well-formed UTF-8
+
+  FILE *in;
+  size_t chunkSize;     // 0 when the whole input is in memory
+  bool exhausted;       // nothing more will be read
+  std::vector<char> buffer;
+
+  struct Output {
+    bool isError;
+    yy::location loc;
+    std::string text;
+  };
+  std::vector<Output> pending;
+};
+
+}
+
+#endif /* defined(__nth__lexer__) */
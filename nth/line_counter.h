@@ -0,0 +1,53 @@
+//
+//  line_counter.h
+//  nth
+//
+
+#ifndef __nth__line_counter__
+#define __nth__line_counter__
+
+#include <cstddef>
+#include <cstring>
+#include "location.hh"
+
+namespace nth {
+
+// Finds the offsets of positions in an input, moving on from the last one
+// found where it can rather than counting lines from the start each time.
+// The input may be part of a larger one, beginning at the given position.
+class LineCounter {
+ public:
+  LineCounter(const char *buf, size_t size, const yy::position &start = yy::position())
+    : buf(buf), end(buf + size), start(start), lineStart(buf), line(start.line) {}
+
+  const char *data() const { return buf; }
+
+  // Returns -1 if the position isn't in the input
+  long offsetOf(const yy::position &position) {
+    if (position.line < line) {
+      lineStart = buf;
+      line = start.line;
+    }
+    while (line < position.line) {
+      const void *newline = memchr(lineStart, '\n', end - lineStart);
+      if (!newline) return -1;
+      lineStart = static_cast<const char *>(newline) + 1;
+      ++line;
+    }
+    // Columns on the first line count from where the input begins
+    long column = position.column - (line == start.line ? start.column : 1);
+    if (column < 0 || column > end - lineStart) return -1;
+    return lineStart - buf + column;
+  }
+
+ private:
+  const char *buf;
+  const char *end;
+  yy::position start;
+  const char *lineStart;
+  int line;
+};
+
+}
+
+#endif /* defined(__nth__line_counter__) */
@@ -10,6 +10,8 @@
 #include <cstdio>
 #include <memory>
 #include <cerrno>
+#include <cstdlib>
+#include <cstring>
 
 #include "driver.h"
 #include "parse.hh"
@@ -19,6 +21,7 @@
 #include "ast_string_printer.h"
 
 void writeOutput(nth::Driver &driver, nth::AstPrinter &printer, std::string filename);
+int stream(nth::Driver &driver, std::string filename, bool should_print);
 
 int main(int argc, const char * argv[])
 {
@@ -37,6 +40,7 @@ int main(int argc, const char * argv[])
   
   bool should_dump_parse_tree_dot = false;
   bool should_dump_parse_tree_string = false;
+  bool should_stream = false;
 
   nth::Driver driver;
   for (int i=1; i<argc; ++i) {
@@ -45,10 +49,31 @@ int main(int argc, const char * argv[])
       driver.should_trace_parsing = true;
     } else if (argv[i] == std::string("--debug-scan")) {
       driver.should_trace_scanning = true;
+    } else if (argv[i] == std::string("--no-mmap")) {
+      driver.should_map_input = false;
+    } else if (argv[i] == std::string("--stream")) {
+      should_stream = true;
+    } else if (argv[i] == std::string("--syntax-only")) {
+      driver.should_build_ast = false;
+    } else if (argv[i] == std::string("--outline")) {
+      driver.should_outline = true;
+    } else if (argv[i] == std::string("--pratt-parser")) {
+      driver.should_use_pratt_parser = true;
+    } else if (argv[i] == std::string("--simd-lexer")) {
+      driver.should_use_simd_lexer = true;
+    } else if (std::string(argv[i]).compare(0, 16, "--lexer-threads=") == 0) {
+      driver.lexer_threads = atoi(argv[i] + 16);
+    } else if (std::string(argv[i]).compare(0, 17, "--parser-threads=") == 0) {
+      // Experimental (see Driver::parser_threads)
+      driver.parser_threads = atoi(argv[i] + 17);
+    } else if (std::string(argv[i]).compare(0, 14, "--token-cache=") == 0) {
+      driver.token_cache_dir = std::string(argv[i]).substr(14);
     } else if (argv[i] == std::string("--parse-tree=dot")) {
       should_dump_parse_tree_dot = true;
     } else if (argv[i] == std::string("--parse-tree=string")) {
       should_dump_parse_tree_string = true;
+    } else if (should_stream) {
+      return stream(driver, argv[i], should_dump_parse_tree_string);
     } else {
       int ret = driver.parse(argv[i]);
 
@@ -58,7 +83,9 @@ int main(int argc, const char * argv[])
         inputfilename = "a.out";
       }
 
-      if (should_dump_parse_tree_dot || should_dump_parse_tree_string) {
+      // There's no tree to print when only checking syntax
+      if (driver.should_build_ast &&
+          (should_dump_parse_tree_dot || should_dump_parse_tree_string)) {
         if (should_dump_parse_tree_dot) {
           outputfilename = inputfilename + ".dot";
           nth::AstDotPrinter p;
@@ -86,4 +113,27 @@ void writeOutput(nth::Driver &driver, nth::AstPrinter &printer, std::string file
   }
 
   fprintf(file, "%s", printer.getOutput().c_str());
-}
\ No newline at end of file
+}
+
+// Parses statements as they arrive, printing each one's parse tree to
+// stdout if asked, without holding the whole input or tree in memory
+int stream(nth::Driver &driver, std::string filename, bool should_print) {
+  FILE *in = stdin;
+  if (!filename.empty() && filename != "-" && !(in = fopen(filename.c_str(), "r"))) {
+    std::cerr << "cannot open " << filename << ": " << strerror(errno);
+    exit(EXIT_FAILURE);
+  }
+
+  int ret = driver.parseStream(in, [&](nth::ASTNode *statement) {
+    if (should_print) {
+      nth::AstStringPrinter p;
+      statement->accept(p);
+      std::cout << p.getOutput() << '\n';
+    }
+  });
+
+  if (in != stdin) {
+    fclose(in);
+  }
+  return ret;
+}
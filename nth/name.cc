@@ -0,0 +1,231 @@
+//
+//  name.cc
+//  nth
+//
+
+#include <mutex>
+#include <stdexcept>
+
+#include "name.h"
+
+using namespace nth;
+
+namespace {
+
+// An entry's text is copied, NUL-terminated, and found by id in segments
+// that never move once allocated, so looking up a name's text needs no
+// lock: whoever has the id was handed it after its text was written, and
+// holds it until they're done with the text.
+//
+// An entry is held by each NameCache that has interned it, and freed once
+// the last of those lets go, unless it was interned without one, which
+// keeps it for good. Its id is then handed out again.
+class NameTable {
+ public:
+  NameTable() : count(0), next(0) {
+    intern(StringRef(), true);
+  }
+
+  uint32_t intern(StringRef text, bool forGood) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (2 * (count + 1) > slots.size()) rehash();
+
+    size_t mask = slots.size() - 1;
+    for (size_t i = StringRefHash()(text) & mask;; i = (i + 1) & mask) {
+      uint32_t id = slots[i];
+      if (id == kEmpty) {
+        id = newId();
+        Entry &entry = at(id);
+        entry.text = StringRef();
+        if (!text.empty()) {
+          char *copy = new char[text.size() + 1];
+          memcpy(copy, text.data(), text.size());
+          copy[text.size()] = '\0';
+          entry.text = StringRef(copy, text.size());
+        }
+        entry.holds = 0;
+        entry.forGood = false;
+        slots[i] = id;
+        ++count;
+      }
+      if (text == lookup(id)) {
+        Entry &entry = at(id);
+        if (forGood) {
+          entry.forGood = true;
+        } else {
+          ++entry.holds;
+        }
+        return id;
+      }
+    }
+  }
+
+  void hold(uint32_t id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++at(id).holds;
+  }
+
+  void release(uint32_t id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry &entry = at(id);
+    if (--entry.holds > 0 || entry.forGood) return;
+
+    // The entries after it in its run move back to fill the gap, as far
+    // as where they hash to allows
+    size_t mask = slots.size() - 1;
+    size_t gap = StringRefHash()(entry.text) & mask;
+    while (slots[gap] != id) gap = (gap + 1) & mask;
+    for (size_t i = (gap + 1) & mask; slots[i] != kEmpty; i = (i + 1) & mask) {
+      size_t home = StringRefHash()(lookup(slots[i])) & mask;
+      bool stays = gap < i ? home > gap && home <= i : home > gap || home <= i;
+      if (!stays) {
+        slots[gap] = slots[i];
+        gap = i;
+      }
+    }
+    slots[gap] = kEmpty;
+
+    delete[] entry.text.data();
+    entry.text = StringRef();
+    freeIds.push_back(id);
+    --count;
+  }
+
+  StringRef lookup(uint32_t id) const {
+    return at(id).text;
+  }
+
+  size_t size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return count;
+  }
+
+ private:
+  enum : uint32_t { kEmpty = UINT32_MAX };
+
+  struct Entry {
+    StringRef text;
+    uint32_t holds; // by caches
+    bool forGood;
+  };
+
+  // Segment k holds the 2^k ids from 2^k - 1 on, so that the table grows
+  // without moving what's already in it
+  static int segmentOf(uint32_t id) {
+    return 63 - __builtin_clzll(uint64_t(id) + 1);
+  }
+
+  Entry &at(uint32_t id) const {
+    int segment = segmentOf(id);
+    return segments[segment][id + 1 - (size_t(1) << segment)];
+  }
+
+  uint32_t newId() {
+    if (!freeIds.empty()) {
+      uint32_t id = freeIds.back();
+      freeIds.pop_back();
+      return id;
+    }
+    if (next == kEmpty) throw std::length_error("too many names");
+    int segment = segmentOf(next);
+    if (!segments[segment]) segments[segment] = new Entry[size_t(1) << segment];
+    return next++;
+  }
+
+  void rehash() {
+    std::vector<uint32_t> old(slots.size() ? 2 * slots.size() : 1024, kEmpty);
+    old.swap(slots);
+    size_t mask = slots.size() - 1;
+    for (uint32_t id : old) {
+      if (id == kEmpty) continue;
+      size_t i = StringRefHash()(lookup(id)) & mask;
+      while (slots[i] != kEmpty) i = (i + 1) & mask;
+      slots[i] = id;
+    }
+  }
+
+  std::mutex mutex;
+  std::vector<uint32_t> slots;
+  size_t count;         // entries in use
+  uint32_t next;        // the first id never handed out
+  std::vector<uint32_t> freeIds;
+  Entry *segments[33] = {};
+};
+
+NameTable &table() {
+  static NameTable *names = new NameTable; // outlives every cache
+  return *names;
+}
+
+}
+
+Name::Name(StringRef text) : id(table().intern(text, true)) {}
+
+StringRef Name::getText() const {
+  return table().lookup(id);
+}
+
+size_t Name::count() {
+  return table().size();
+}
+
+uint32_t &NameCache::slotFor(StringRef text) {
+  if (2 * (count + 1) > slots.size()) {
+    std::vector<uint32_t> old(slots.size() ? 2 * slots.size() : 256, 0);
+    old.swap(slots);
+    size_t mask = slots.size() - 1;
+    for (uint32_t id : old) {
+      if (!id) continue;
+      size_t i = StringRefHash()(Name(id).getText()) & mask;
+      while (slots[i]) i = (i + 1) & mask;
+      slots[i] = id;
+    }
+  }
+
+  size_t mask = slots.size() - 1;
+  for (size_t i = StringRefHash()(text) & mask;; i = (i + 1) & mask) {
+    if (!slots[i] || Name(slots[i]).getText() == text) return slots[i];
+  }
+}
+
+Name NameCache::get(StringRef text) {
+  // The empty name has id 0, which marks an empty slot, so it isn't cached
+  if (text.empty()) return Name();
+
+  uint32_t &slot = slotFor(text);
+  if (!slot) {
+    slot = table().intern(text, false);
+    ++count;
+  }
+  return Name(slot);
+}
+
+void NameCache::hold(Name name) {
+  if (!name.getId()) return;
+
+  uint32_t &slot = slotFor(name.getText());
+  if (!slot) {
+    table().hold(name.getId());
+    slot = name.getId();
+    ++count;
+  }
+}
+
+void NameCache::clear() {
+  for (uint32_t id : slots) {
+    if (id) table().release(id);
+  }
+  slots.clear();
+  count = 0;
+}
+
+void NameCache::merge(NameCache &other) {
+  if (!count) {
+    swap(other);
+    return;
+  }
+  for (uint32_t id : other.slots) {
+    if (id) hold(Name(id));
+  }
+  other.clear();
+}
@@ -0,0 +1,105 @@
+//
+//  name.h
+//  nth
+//
+
+#ifndef __nth__name__
+#define __nth__name__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "string_ref.h"
+
+namespace nth {
+
+// An identifier's spelling, interned in a table shared by every parse in
+// the process: names spelled alike have the same 32-bit id, so comparing
+// or hashing names never looks at their text. The text is kept for
+// diagnostics and printers, for as long as the name is held.
+//
+// A name made from text here is held for as long as the process runs,
+// which suits the spellings a program builds in. A parse interns names
+// through a NameCache, which holds them only as long as it lives: the
+// parser's goes with the tree's ASTContext, and once the tree has
+// gone, spellings no other tree uses are freed. Interning takes a lock,
+// but a cache only takes it the first time it sees each spelling.
+class Name {
+ public:
+  // The empty name, whose id is 0
+  Name() : id(0) {}
+  explicit Name(StringRef text);
+  explicit Name(const std::string &text) : Name(StringRef(text)) {}
+  explicit Name(const char *text) : Name(StringRef(text, strlen(text))) {}
+
+  uint32_t getId() const { return id; }
+  // The name whose id getId() gave
+  static Name fromId(uint32_t id) { return Name(id); }
+
+  StringRef getText() const;
+  const char *c_str() const { return getText().data(); }
+  std::string str() const { return getText().str(); }
+
+  bool operator==(Name other) const { return id == other.id; }
+  bool operator!=(Name other) const { return id != other.id; }
+  bool operator<(Name other) const { return id < other.id; }
+
+  // Compares the text, for callers that only have a spelling
+  bool operator==(StringRef text) const { return getText() == text; }
+
+  // Distinct names held now, including the empty one
+  static size_t count();
+
+ protected:
+  friend class NameCache;
+  explicit Name(uint32_t id) : id(id) {}
+
+  uint32_t id;
+};
+
+struct NameHash {
+  size_t operator()(Name name) const { return name.getId(); }
+};
+
+// Remembers the names a single thread has interned, so that each spelling
+// is looked up in the shared table only once, and holds them until it's
+// cleared or destroyed
+class NameCache {
+ public:
+  NameCache() : count(0) {}
+  ~NameCache() { clear(); }
+  NameCache(const NameCache &) = delete;
+  NameCache &operator=(const NameCache &) = delete;
+
+  Name get(StringRef text);
+
+  // Holds a name that was interned elsewhere, as this cache's own
+  void hold(Name name);
+
+  // Lets go of every name held
+  void clear();
+
+  // Takes over every name other holds, leaving it empty
+  void merge(NameCache &other);
+
+  void swap(NameCache &other) {
+    slots.swap(other.slots);
+    std::swap(count, other.count);
+  }
+
+ protected:
+  // Where text's id is, or would go, making room first if need be
+  uint32_t &slotFor(StringRef text);
+
+  // Open addressing on the hash of the text, at most half full
+  std::vector<uint32_t> slots; // ids, or 0 for an empty slot
+  size_t count;
+};
+
+}
+
+#endif /* defined(__nth__name__) */
@@ -0,0 +1,247 @@
+//
+//  numeric_literal.cc
+//  nth
+//
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <locale.h>
+#if defined(__APPLE__)
+#include <xlocale.h>
+#endif
+
+#include "numeric_literal.h"
+
+using namespace nth;
+
+namespace {
+
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+inline unsigned digitValue(char c) {
+  if (c <= '9') return c - '0';
+  return (c | 0x20) - 'a' + 10;
+}
+
+// Every power of ten that a double represents exactly
+const double kPowersOfTen[] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+const int kMaxExactPower = 22;
+
+// Largest integer below which every integer is exactly a double
+const uint64_t kMaxExactInteger = 1ULL << 53;
+
+// Exponents beyond this put any literal of reasonable length far outside
+// the range of a double, so larger ones needn't be accumulated exactly
+const int kExponentLimit = 100000;
+
+// Literals the fast path can't handle exactly go to strtod_l, which needs
+// them NUL-terminated. The input can't be terminated in place, so short
+// literals are copied to the stack first.
+class LiteralText {
+ public:
+  LiteralText(const char *start, const char *end) {
+    size_t length = end - start;
+    if (length < sizeof(buffer)) {
+      memcpy(buffer, start, length);
+      buffer[length] = '\0';
+      text = buffer;
+    } else {
+      heap.assign(start, end);
+      text = heap.c_str();
+    }
+  }
+
+  const char *text;
+
+ private:
+  char buffer[64];
+  std::string heap;
+};
+
+// The "C" locale, so that the slow path reads '.' as the decimal point
+// whatever setlocale() has been told
+locale_t cLocale() {
+  static locale_t locale = newlocale(LC_ALL_MASK, "C", static_cast<locale_t>(0));
+  return locale;
+}
+
+// magnitude = magnitude * factor + addend
+void multiplyAdd(std::vector<uint32_t> &magnitude, uint32_t factor, uint32_t addend) {
+  uint64_t carry = addend;
+  for (uint32_t &limb : magnitude) {
+    uint64_t product = static_cast<uint64_t>(limb) * factor + carry;
+    limb = static_cast<uint32_t>(product);
+    carry = product >> 32;
+  }
+  if (carry) magnitude.push_back(static_cast<uint32_t>(carry));
+}
+
+// magnitude = magnitude / divisor, returning the remainder
+uint32_t divide(std::vector<uint32_t> &magnitude, uint32_t divisor) {
+  uint64_t remainder = 0;
+  for (size_t i = magnitude.size(); i-- > 0;) {
+    uint64_t dividend = (remainder << 32) | magnitude[i];
+    magnitude[i] = static_cast<uint32_t>(dividend / divisor);
+    remainder = dividend % divisor;
+  }
+  while (!magnitude.empty() && magnitude.back() == 0) magnitude.pop_back();
+  return static_cast<uint32_t>(remainder);
+}
+
+}
+
+namespace nth {
+
+bool decodeInteger(const char *begin, const char *end, int base, long &value) {
+  const char *p = begin;
+  bool negative = false;
+  if (p != end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    ++p;
+  }
+
+  const uint64_t limit = negative ? static_cast<uint64_t>(LONG_MAX) + 1 : LONG_MAX;
+  uint64_t magnitude = 0;
+  for (; p != end; ++p) {
+    unsigned digit = digitValue(*p);
+    if (magnitude > (limit - digit) / base) return false;
+    magnitude = magnitude * base + digit;
+  }
+
+  if (!negative || magnitude == 0) {
+    value = static_cast<long>(magnitude);
+  } else {
+    value = -static_cast<long>(magnitude - 1) - 1; // reaches LONG_MIN
+  }
+  return true;
+}
+
+bool decodeFloat(const char *begin, const char *end, double &value) {
+  const char *p = begin;
+  bool negative = false;
+  if (p != end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    ++p;
+  }
+
+  // Up to 19 significant digits always fit in a uint64_t. Any after that
+  // only adjust the exponent, and send a literal to the slow path if they
+  // aren't zero.
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  bool truncated = false;
+  bool fraction = false;
+  for (; p != end; ++p) {
+    if (*p == '.') {
+      fraction = true;
+      continue;
+    }
+    if (!isDigit(*p)) break;
+
+    unsigned digit = *p - '0';
+    if (digits < 19) {
+      if (digit || digits) {
+        mantissa = mantissa * 10 + digit;
+        ++digits;
+      }
+      if (fraction) --exponent;
+    } else {
+      truncated |= digit != 0;
+      if (!fraction) ++exponent;
+    }
+  }
+
+  if (p != end && (*p == 'e' || *p == 'E')) {
+    ++p;
+    bool negativeExponent = false;
+    if (p != end && (*p == '-' || *p == '+')) {
+      negativeExponent = *p == '-';
+      ++p;
+    }
+    int written = 0;
+    for (; p != end && isDigit(*p); ++p) {
+      written = std::min(written * 10 + (*p - '0'), kExponentLimit);
+    }
+    exponent += negativeExponent ? -written : written;
+  }
+
+  if (mantissa == 0) {
+    value = negative ? -0.0 : 0.0;
+    return true;
+  }
+
+  // Exact mantissa times an exact power of ten: a single rounding, so
+  // the result is correctly rounded
+  if (!truncated && mantissa <= kMaxExactInteger) {
+    if (exponent > kMaxExactPower && exponent <= kMaxExactPower + 15) {
+      // 123e25 is also 1230000e20, if the mantissa can take the zeros
+      int shift = exponent - kMaxExactPower;
+      if (mantissa <= kMaxExactInteger / static_cast<uint64_t>(kPowersOfTen[shift])) {
+        mantissa *= static_cast<uint64_t>(kPowersOfTen[shift]);
+        exponent = kMaxExactPower;
+      }
+    }
+    if (exponent >= -kMaxExactPower && exponent <= kMaxExactPower) {
+      double d = static_cast<double>(mantissa);
+      d = exponent < 0 ? d / kPowersOfTen[-exponent] : d * kPowersOfTen[exponent];
+      value = negative ? -d : d;
+      return true;
+    }
+  }
+
+  LiteralText literal(begin, end);
+  value = strtod_l(literal.text, NULL, cLocale());
+  return !std::isinf(value) && value != 0;
+}
+
+void decodeBigInteger(const char *begin, const char *end, bool &negative,
+                      std::vector<uint32_t> &magnitude) {
+  const char *p = begin;
+  negative = false;
+  if (p != end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    ++p;
+  }
+
+  unsigned base = 10;
+  if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'b')) {
+    base = p[1] == 'x' ? 16 : 2;
+    p += 2;
+  } else if (end - p > 1 && p[0] == '0') {
+    base = 8;
+  }
+
+  magnitude.clear();
+  for (; p != end; ++p) {
+    multiplyAdd(magnitude, base, digitValue(*p));
+  }
+  while (!magnitude.empty() && magnitude.back() == 0) magnitude.pop_back();
+}
+
+std::string formatBigInteger(bool negative, const std::vector<uint32_t> &magnitude) {
+  // Nine decimal digits at a time, least significant first
+  std::vector<uint32_t> remaining(magnitude);
+  std::string digits;
+  do {
+    uint32_t chunk = divide(remaining, 1000000000);
+    for (int i = 0; i < 9; ++i) {
+      digits += static_cast<char>('0' + chunk % 10);
+      chunk /= 10;
+      if (remaining.empty() && chunk == 0) break;
+    }
+  } while (!remaining.empty());
+
+  if (negative) digits += '-';
+  std::reverse(digits.begin(), digits.end());
+  return digits;
+}
+
+}
@@ -0,0 +1,41 @@
+//
+//  numeric_literal.h
+//  nth
+//
+
+#ifndef __nth__numeric_literal__
+#define __nth__numeric_literal__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace nth {
+
+// Decoding of the numeric literal forms matched by scan.l and Lexer. These
+// work directly on the token's text, which needn't be NUL-terminated, and
+// unlike strtol/strtod never consult the global locale. Only a float with
+// more digits or a wider exponent than a double holds exactly is copied.
+
+// Value of the digits in [begin, end) in base 2, 8, 10 or 16, without any
+// 0x or 0b prefix. A sign may lead in base 10. Returns false if the value
+// doesn't fit in a long.
+bool decodeInteger(const char *begin, const char *end, int base, long &value);
+
+// Value of [-+]?[0-9]+("."[0-9]+)?([eE][-+]?[0-9]+)?, correctly rounded.
+// Returns false if it is too large or too small (but not zero) for a
+// double, in which case value is infinite or zero.
+bool decodeFloat(const char *begin, const char *end, double &value);
+
+// Magnitude of an integer literal of any size and form (decimal with
+// optional sign, 0x hex, 0b binary or 0-led octal), as 32-bit limbs with
+// the least significant first and no leading zero limbs
+void decodeBigInteger(const char *begin, const char *end, bool &negative,
+                      std::vector<uint32_t> &magnitude);
+
+// Decimal digits of a magnitude as returned by decodeBigInteger
+std::string formatBigInteger(bool negative, const std::vector<uint32_t> &magnitude);
+
+}
+
+#endif /* defined(__nth__numeric_literal__) */
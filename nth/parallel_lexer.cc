@@ -0,0 +1,404 @@
+//
+//  parallel_lexer.cc
+//  nth
+//
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#include "driver.h"
+#include "lexer.h"
+#include "parallel_lexer.h"
+
+using namespace nth;
+
+namespace nth {
+
+// One guess at the state a chunk begins in, and the tokens it leads to.
+// Locations count from the start of the chunk, on line 1.
+struct Speculation {
+  enum Start { Code, Comment, String };
+
+  struct Output {
+    size_t token; // reported while scanning this token
+    bool isError;
+    yy::location loc;
+    std::string text;
+  };
+
+  // A token as plain data, which is half the size of a symbol_type and
+  // much quicker to store and hand back. Text is still a view into the
+  // input or the driver's decoded text.
+  struct Token {
+    int kind;
+    int beginLine, beginColumn, endLine, endColumn;
+    unsigned size; // of text
+    union {
+      const char *text;
+      long integer; // also a comparison
+      double real;
+    };
+
+    explicit Token(const yy::parser::symbol_type &symbol);
+    yy::parser::symbol_type symbol(const yy::location &loc) const;
+  };
+
+  // The start of a token with no strings open
+  struct Boundary {
+    const char *position;
+    size_t token;
+    size_t output;
+  };
+
+  // Only every so many tokens are noted as boundaries. A guess catching up
+  // with the code one joins it at the next noted boundary instead of the
+  // first shared one, and the index stays small.
+  static const size_t kBoundaryInterval = 64;
+
+  explicit Speculation(bool trace) : sync(nullptr), rest(nullptr), stop(nullptr),
+                                     finished(false) {
+    driver.should_trace_scanning = trace;
+  }
+
+  Driver driver; // location, open strings and decoded string text
+  std::vector<Token> tokens;
+  std::vector<Output> outputs;
+  std::vector<Boundary> boundaries;
+
+  // The first token boundary past the guessed start. From here on the
+  // guess is right if the true scan gets here in the same state. Null if
+  // the input ended first.
+  const char *sync;
+  yy::position syncPosition;
+  std::vector<Driver::OpenString> syncStrings;
+  size_t syncToken;
+  size_t syncOutput;
+
+  // Once in step with the code guess, the rest of the tokens are its
+  const Speculation *rest;
+  const Boundary *restBoundary;
+
+  // The first token boundary at or past the end of the chunk
+  const char *stop;
+  yy::location stopLocation;
+  std::vector<Driver::OpenString> stopStrings;
+  bool finished; // the tokens end with END
+};
+
+}
+
+Speculation::Token::Token(const yy::parser::symbol_type &symbol)
+  : kind(symbol.kind()),
+    beginLine(symbol.location.begin.line), beginColumn(symbol.location.begin.column),
+    endLine(symbol.location.end.line), endColumn(symbol.location.end.column),
+    size(0), integer(0) {
+  switch (kind) {
+    case yy::parser::symbol_kind::S_STRING:
+    case yy::parser::symbol_kind::S_STRING_HEAD:
+    case yy::parser::symbol_kind::S_STRING_MID:
+    case yy::parser::symbol_kind::S_STRING_TAIL:
+    case yy::parser::symbol_kind::S_IDENT:
+    case yy::parser::symbol_kind::S_BIGINT: {
+      const StringRef &ref = symbol.value.as<StringRef>();
+      text = ref.data();
+      size = static_cast<unsigned>(ref.size());
+      break;
+    }
+    case yy::parser::symbol_kind::S_INT:
+      integer = symbol.value.as<long>();
+      break;
+    case yy::parser::symbol_kind::S_FLOAT:
+      real = symbol.value.as<double>();
+      break;
+    case yy::parser::symbol_kind::S_CMP:
+      integer = static_cast<long>(symbol.value.as<Comparison::Type>());
+      break;
+    default:
+      break;
+  }
+}
+
+yy::parser::symbol_type Speculation::Token::symbol(const yy::location &loc) const {
+  switch (kind) {
+    case yy::parser::symbol_kind::S_STRING:
+    case yy::parser::symbol_kind::S_STRING_HEAD:
+    case yy::parser::symbol_kind::S_STRING_MID:
+    case yy::parser::symbol_kind::S_STRING_TAIL:
+    case yy::parser::symbol_kind::S_IDENT:
+    case yy::parser::symbol_kind::S_BIGINT:
+      return yy::parser::symbol_type(kind, StringRef(text, size), loc);
+    case yy::parser::symbol_kind::S_INT:
+      return yy::parser::symbol_type(kind, integer, loc);
+    case yy::parser::symbol_kind::S_FLOAT:
+      return yy::parser::symbol_type(kind, real, loc);
+    case yy::parser::symbol_kind::S_CMP:
+      return yy::parser::symbol_type(kind, static_cast<Comparison::Type>(integer), loc);
+    default:
+      return yy::parser::symbol_type(kind, loc);
+  }
+}
+
+namespace {
+
+bool sameStrings(const std::vector<Driver::OpenString> &a,
+                 const std::vector<Driver::OpenString> &b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i].interpolated != b[i].interpolated || a[i].braceDepth != b[i].braceDepth) {
+      return false;
+    }
+  }
+  return true;
+}
+
+class ChunkLexer : public Lexer {
+ public:
+  ChunkLexer(Speculation &speculation, const char *begin, const char *end,
+             const char *limit)
+    : Lexer(speculation.driver, begin, end), speculation(speculation), nextBoundary(0) {
+    this->limit = limit;
+  }
+
+  // Lexes from a guessed start up to the limit. With a code guess to
+  // follow, stops as soon as the two are in step; otherwise may note
+  // boundaries for other guesses to find.
+  void run(Speculation::Start start, const Speculation *follow, bool noteBoundaries);
+
+ private:
+  void takeOutput(size_t token) {
+    for (const Output &output : pending) {
+      speculation.outputs.push_back(
+        Speculation::Output{token, output.isError, output.loc, output.text});
+    }
+    pending.clear();
+  }
+
+  bool joins(const Speculation &follow);
+
+  Speculation &speculation;
+  size_t nextBoundary; // in the guess being followed
+};
+
+void ChunkLexer::run(Speculation::Start start, const Speculation *follow,
+                     bool noteBoundaries) {
+  Speculation &s = speculation;
+  yy::location &loc = driver.location;
+
+  // The guessed comment or string is finished first, though its token is
+  // whatever the true scan of the previous chunk makes of it. One that
+  // runs past the chunk swallows it whole, so needn't be followed there.
+  if (start != Speculation::Code) {
+    const char *inputEnd = end;
+    end = limit;
+    bool finished;
+    if (start == Speculation::Comment) {
+      finished = finishBlockComment();
+    } else {
+      driver.openStrings.push_back(Driver::OpenString{false, 0});
+      finished = lexStringText(cursor).kind() != yy::parser::symbol_kind::S_YYEOF;
+    }
+    end = inputEnd;
+    pending.clear();
+    if (!finished) return;
+  }
+
+  s.sync = cursor;
+  s.syncPosition = loc.end;
+  s.syncStrings = driver.openStrings;
+  s.syncToken = s.tokens.size();
+  s.syncOutput = s.outputs.size();
+
+  for (;;) {
+    if (driver.openStrings.empty()) {
+      if (follow && joins(*follow)) return;
+      if (noteBoundaries && s.tokens.size() % Speculation::kBoundaryInterval == 0) {
+        s.boundaries.push_back(
+          Speculation::Boundary{cursor, s.tokens.size(), s.outputs.size()});
+      }
+    }
+
+    yy::parser::symbol_type symbol = scan();
+    takeOutput(s.tokens.size());
+
+    bool ended = symbol.kind() == yy::parser::symbol_kind::S_YYEOF;
+    if (ended && cursor < end) {
+      // Stopped at the limit
+      s.stop = cursor;
+      s.stopLocation = loc;
+      s.stopStrings = driver.openStrings;
+      return;
+    }
+
+    s.tokens.push_back(Speculation::Token(symbol));
+    if (ended) {
+      s.stop = end;
+      s.stopLocation = loc;
+      s.finished = true;
+      return;
+    }
+  }
+}
+
+bool ChunkLexer::joins(const Speculation &follow) {
+  // Both guesses count locations from the same place, so at the same
+  // boundary with nothing open everything from here on is the same
+  const std::vector<Speculation::Boundary> &boundaries = follow.boundaries;
+  while (nextBoundary < boundaries.size() && boundaries[nextBoundary].position < cursor) {
+    ++nextBoundary;
+  }
+  if (nextBoundary == boundaries.size() || boundaries[nextBoundary].position != cursor) {
+    return false;
+  }
+  speculation.rest = &follow;
+  speculation.restBoundary = &boundaries[nextBoundary];
+  return true;
+}
+
+}
+
+ParallelLexer::ParallelLexer(Driver &driver, const char *begin, const char *end,
+                             size_t chunks)
+  : driver(driver), current(0) {
+  // Chunks start on a new line, as only a comment or string can span one
+  size_t size = end - begin;
+  size_t count = std::max<size_t>(1, std::min(chunks, size));
+  std::vector<const char *> starts(1, begin);
+  for (size_t i = 1; i < count; ++i) {
+    const char *p = std::max(begin + size / count * i, starts.back());
+    p = static_cast<const char *>(memchr(p, '\n', end - p));
+    if (!p || p + 1 == end) break;
+    starts.push_back(p + 1);
+  }
+  chunks = starts.size();
+  starts.push_back(end);
+
+  // Three guesses per chunk, in Speculation::Start order. The first chunk
+  // can only begin in code.
+  speculations.resize(chunks * 3);
+  for (size_t i = 0; i < chunks; ++i) {
+    for (size_t k = 0; k < (i ? 3u : 1u); ++k) {
+      speculations[i * 3 + k].reset(new Speculation(driver.should_trace_scanning));
+    }
+  }
+  speculations[0]->driver.location = driver.location;
+
+  auto lexChunk = [&](size_t i) {
+    // Tokens seldom average fewer than four bytes, so the code guess's
+    // rarely need to be moved as they grow
+    Speculation &code = *speculations[i * 3];
+    code.tokens.reserve((starts[i + 1] - starts[i]) / 4);
+    ChunkLexer(code, starts[i], end, starts[i + 1]).run(Speculation::Code, nullptr, i > 0);
+    if (i == 0) return;
+    ChunkLexer(*speculations[i * 3 + 1], starts[i], end, starts[i + 1])
+      .run(Speculation::Comment, &code, false);
+    ChunkLexer(*speculations[i * 3 + 2], starts[i], end, starts[i + 1])
+      .run(Speculation::String, &code, false);
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < chunks; ++i) {
+    workers.push_back(std::thread(lexChunk, i));
+  }
+  lexChunk(0);
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+
+  // Follow the true scan from chunk to chunk
+  const char *position = begin;
+  yy::location location = driver.location;
+  std::vector<Driver::OpenString> strings = driver.openStrings;
+  for (size_t i = 0; i < chunks; ++i) {
+    // A comment or string may have run through the whole chunk
+    if (position >= starts[i + 1]) continue;
+
+    Speculation *match = nullptr;
+    for (size_t k = 0; k < 3 && !match; ++k) {
+      Speculation *guess = speculations[i * 3 + k].get();
+      if (guess && guess->sync == position && sameStrings(guess->syncStrings, strings)) {
+        match = guess;
+      }
+    }
+    if (!match) {
+      match = new Speculation(driver.should_trace_scanning);
+      speculations.emplace_back(match);
+      match->driver.location = location;
+      match->driver.openStrings = strings;
+      ChunkLexer(*match, position, end, starts[i + 1]).run(Speculation::Code, nullptr, false);
+    }
+
+    Segment segment;
+    segment.speculation = match;
+    segment.token = match->syncToken;
+    segment.tokenEnd = match->tokens.size();
+    segment.output = match->syncOutput;
+    segment.outputEnd = match->outputs.size();
+    segment.lineOffset = location.end.line - match->syncPosition.line;
+    segment.sync = match->syncPosition;
+    segment.syncBegin = location.begin;
+    segments.push_back(segment);
+
+    const Speculation *last = match;
+    if (match->rest) {
+      last = match->rest;
+      segment.speculation = const_cast<Speculation *>(last);
+      segment.token = match->restBoundary->token;
+      segment.tokenEnd = last->tokens.size();
+      segment.output = match->restBoundary->output;
+      segment.outputEnd = last->outputs.size();
+      segments.push_back(segment);
+    }
+
+    position = last->stop;
+    location = place(segment, last->stopLocation);
+    strings = last->stopStrings;
+    if (last->finished) break;
+  }
+}
+
+ParallelLexer::~ParallelLexer() {}
+
+yy::location ParallelLexer::place(const Segment &segment, const yy::location &loc) const {
+  yy::location placed = loc;
+  placed.begin.line += segment.lineOffset;
+  placed.end.line += segment.lineOffset;
+  // A token's begin only moves when the scanner steps, and the true scan
+  // may last have stepped before the guess began
+  if (loc.begin.line == segment.sync.line && loc.begin.column == segment.sync.column) {
+    placed.begin = segment.syncBegin;
+  }
+  return placed;
+}
+
+yy::parser::symbol_type ParallelLexer::lex() {
+  while (current < segments.size()) {
+    Segment &segment = segments[current];
+    Speculation &s = *segment.speculation;
+
+    // Errors and trace output come out just before the token they were
+    // reported while scanning, as they do from Lexer
+    while (segment.output < segment.outputEnd &&
+           s.outputs[segment.output].token <= segment.token) {
+      const Speculation::Output &output = s.outputs[segment.output++];
+      if (output.isError) {
+        driver.error(place(segment, output.loc), output.text);
+      } else {
+        std::cerr << output.text;
+      }
+    }
+
+    if (segment.token < segment.tokenEnd) {
+      const Speculation::Token &token = s.tokens[segment.token++];
+      yy::location loc;
+      loc.begin.line = token.beginLine;
+      loc.begin.column = token.beginColumn;
+      loc.end.line = token.endLine;
+      loc.end.column = token.endColumn;
+      driver.location = place(segment, loc);
+      return token.symbol(driver.location);
+    }
+    ++current;
+  }
+  return yy::parser::make_END(driver.location);
+}
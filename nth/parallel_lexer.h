@@ -0,0 +1,68 @@
+//
+//  parallel_lexer.h
+//  nth
+//
+
+#ifndef __nth__parallel_lexer__
+#define __nth__parallel_lexer__
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "parse.hh"
+
+namespace nth {
+
+class Driver;
+struct Speculation;
+
+// Lexes a buffer on several threads at once. The buffer is cut into chunks,
+// each starting on a new line, and each chunk is lexed as though it began
+// in code, and again as though it began inside a block comment and inside
+// a string literal, since which it really begins in depends on everything
+// before it. The two guesses other than code are only followed until they
+// fall into step with the code one.
+//
+// Once every chunk is done, the state each one really begins in is known
+// in turn, and the guess that agrees with it supplies the chunk's tokens.
+// A chunk that no guess fits (one that begins inside a string nested in an
+// interpolation, say) is lexed again from its true state, so the tokens,
+// locations and errors are always exactly those of Lexer alone.
+class ParallelLexer {
+ public:
+  // Lexes [begin, end) in up to the given number of chunks, each on its
+  // own thread. Tokens are held until lex() hands them out, and their text
+  // refers to the input, which must stay valid until then.
+  ParallelLexer(Driver &driver, const char *begin, const char *end, size_t chunks);
+  ~ParallelLexer();
+
+  yy::parser::symbol_type lex();
+
+  // Driver makes chunks no smaller than this, as below it the threads cost
+  // more than they save
+  static const size_t kMinimumChunkSize = 256 * 1024;
+
+ protected:
+  // A run of one guess's tokens, and the errors reported along the way,
+  // that belongs in the stream. The guess counted lines from its chunk's
+  // start, so they're moved by lineOffset on the way out.
+  struct Segment {
+    Speculation *speculation;
+    size_t token, tokenEnd;
+    size_t output, outputEnd;
+    int lineOffset;
+    yy::position sync;        // where the guess joined the true scan...
+    yy::position syncBegin;   // ...and the begin a token there really has
+  };
+
+  yy::location place(const Segment &segment, const yy::location &loc) const;
+
+  Driver &driver;
+  std::vector<std::unique_ptr<Speculation>> speculations;
+  std::vector<Segment> segments;
+  size_t current;
+};
+
+}
+
+#endif /* defined(__nth__parallel_lexer__) */
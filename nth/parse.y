@@ -1,5 +1,6 @@
 %code requires {
   #include "ast.h"
+  #include "string_ref.h"
   #include "type_literal.h"
 
   namespace nth {
@@ -14,6 +15,20 @@
   #include <utility> // provides std::swap as of C++11
   #include "driver.h"
 
+  // Runs an action only when the driver is building a tree. Otherwise every
+  // value is left as it starts out (a null node or an empty list), and the
+  // parser does no more than check the syntax.
+  #define BUILD(...) do { if (driver.should_build_ast) { __VA_ARGS__; } } while (false)
+
+  // Takes a node or list out of a semantic value, leaving it empty. bison
+  // runs a value's %destructor whenever the symbol holding it is popped,
+  // reductions included, so an action takes whatever it hands on.
+  template <typename T> T take(T &value) {
+    T taken = std::move(value);
+    value = T();
+    return taken;
+  }
+
  int exit_status;
 %}
 
@@ -30,6 +45,9 @@
   @$.begin.filename = @$.end.filename = &driver.file;
 }
 %define api.token.prefix {T_}
+// Token numbers are the parser's own symbol numbers, which lets the token
+// cache rebuild a symbol from the kind it saved
+%define api.token.raw
 
 %param { nth::Driver &driver }
 
@@ -62,10 +80,14 @@
 %token TRUE FALSE
 %token <double> FLOAT
 %token <long> INT
-%token <std::string> STRING
-%token <std::string> IDENT
+%token <nth::StringRef> BIGINT
+%token <nth::StringRef> STRING
+%token <nth::StringRef> STRING_HEAD STRING_MID STRING_TAIL
+%token <nth::StringRef> IDENT
 %token HASH_ROCKET "=>"
 %token LSHIFT "<<" RSHIFT ">>" DOUBLE_DOT ".." TRIPLE_DOT "..."
+  /* A function's block, skipped by an outline parse (see Driver::lex) */
+%token <nth::BlockParser*> BODY "function body"
 
 %left "="
 %right VAL
@@ -78,16 +100,18 @@
 %left NOT
 %left "&&" "||"
 
-%type <nth::Block*> file;
-%type <nth::Block*> statements block;
+%type <nth::Block*> top_level statements block;
+%type <nth::FunctionBody> body;
 %type <nth::ASTNode*> statement;
 %type <nth::Expression*> expr literal compound_literal binary_op unary_op;
-%type <nth::ExpressionList*> exprlist;
-%type <nth::Array*> array;
+%type <nth::ExpressionList> exprlist;
+%type <nth::ArrayBuilder> elements;
+%type <nth::InterpolatedString*> interpolated_string interpolation;
+%type <nth::Expression*> array;
 %type <nth::Map*> map;
 %type <nth::Range*> range;
 %type <nth::Tuple*> tuple;
-%type <nth::ExpressionMap*> key_val_list;
+%type <nth::ExpressionMap> key_val_list;
 %type <std::pair<nth::String*, nth::Expression*>> key_value;
 %type <nth::String*> key;
 %type <nth::BinaryOperation*> math_op bitwise_op boolean_op comparison_op subscript field_access;
@@ -95,136 +119,192 @@
 %type <nth::LambdaDef*> lambda;
 %type <nth::FunctionCall*> func_call;
 %type <nth::VariableDef*> val_def;
-%type <nth::ArgList*> arglist;
-%type <nth::TypeRefList*> typeref_list
-%type <nth::TypeDefList*> type_param type_param_list;
+%type <nth::ArgList> arglist args;
+%type <nth::TypeRefList> typeref_list
+%type <nth::TypeDefList> type_param type_param_list;
 %type <nth::TypeRef*> typeref
 %type <nth::TypeDef*> typedef;
 %type <nth::Argument*> arg;
 %type <nth::IfElse*> if_else;
 %type <nth::TypeAliasDef*> type_alias_def;
 
+  /* Whatever error recovery throws away is deleted, as is everything on
+     the stack if the parse has to give up. The top-level Block is the
+     driver's result from the start (see top_level), so it's kept. */
+%destructor { delete $$; } <nth::ASTNode*> <nth::Expression*> <nth::Block*>
+  <nth::InterpolatedString*> <nth::Map*> <nth::Range*> <nth::Tuple*> <nth::String*>
+  <nth::BinaryOperation*> <nth::FunctionDef*> <nth::LambdaDef*> <nth::FunctionCall*>
+  <nth::VariableDef*> <nth::TypeRef*> <nth::TypeDef*> <nth::Argument*>
+  <nth::IfElse*> <nth::TypeAliasDef*> <nth::BlockParser*>
+%destructor { for (auto node : $$) delete node; }
+  <nth::ExpressionList> <nth::ArgList> <nth::TypeRefList> <nth::TypeDefList>
+%destructor { for (auto &pair : $$) { delete pair.first; delete pair.second; } } <nth::ExpressionMap>
+%destructor { delete $$.first; delete $$.second; } <std::pair<nth::String*, nth::Expression*>>
+%destructor { delete $$.block; delete $$.parser; } <nth::FunctionBody>
+%destructor { $$.discard(); } <nth::ArrayBuilder>
+%destructor { } top_level
+
 %start file
 
   // %printer { yyoutput << $$; } <*>;
+
 %%
 
 
-file: statements  { driver.result = $1; }
+file: top_level  { driver.result = $1; }
     ;
 
-statements: statement             { $$ = new nth::Block($1); }
-          | statements statement  { std::swap($$, $1); $$->insertAfter($2); }
+  /* The same as statements, except that the driver sees each statement as
+     soon as it's reduced (see Driver::addTopLevelStatement). The Block is
+     the driver's result from the start, so that it's kept even if the
+     parse has to give up at the end of the input. */
+top_level: statement            { BUILD($$ = driver.result = new (driver.context) nth::Block(); driver.addTopLevelStatement($$, take($1), @1)); }
+         | top_level statement  { BUILD(std::swap($$, $1); driver.addTopLevelStatement($$, take($2), @2)); }
+         | error                { BUILD($$ = driver.result = new (driver.context) nth::Block()); }
+         | top_level error      { std::swap($$, $1); }
+         ;
+
+  /* After a syntax error, tokens are dropped until one can begin the next
+     statement (or close the block), and parsing carries on from there.
+     The statement in error is left out of the tree. */
+statements: statement             { BUILD($$ = new (driver.context) nth::Block(); if ($1) $$->insertAfter(take($1))); }
+          | statements statement  { BUILD(std::swap($$, $1); if ($2) $$->insertAfter(take($2))); }
+          | error                 { BUILD($$ = new (driver.context) nth::Block()); }
+          | statements error      { std::swap($$, $1); }
           ;
 
-statement: expr           { nth::ASTNode* node = $1; std::swap($$, node); }
-         | val_def        { nth::ASTNode* node = $1; std::swap($$, node); }
-         | func_def       { nth::ASTNode* node = $1; std::swap($$, node); }
-         | type_alias_def { nth::ASTNode* node = $1; std::swap($$, node); }
+statement: expr           { $$ = take($1); }
+         | val_def        { $$ = take($1); }
+         | func_def       { $$ = take($1); }
+         | type_alias_def { $$ = take($1); }
+           /* A function whose signature is in error is still worth looking
+              inside for more errors, though it can't be kept */
+         | DEF error body { $$ = nullptr; (void)$3; /* deleted as it's popped */ }
          ;
 
 expr: literal   { std::swap($$, $1); }
     | binary_op { std::swap($$, $1); }
     | unary_op  { std::swap($$, $1); }
-    | lambda    { nth::Expression *expr = $1; std::swap($$, expr); }
-    | if_else   { nth::Expression *expr = $1; std::swap($$, expr); }
-    | func_call { nth::Expression *expr = $1; std::swap($$, expr); }
-    | "(" expr ")"
+    | lambda    { $$ = take($1); }
+    | if_else   { $$ = take($1); }
+    | func_call { $$ = take($1); }
+    | "(" expr ")" { std::swap($$, $2); }
     ;
 
-literal: INT     { $$ = new nth::Integer($1); }
-       | FLOAT   { $$ = new nth::Float($1); }
-       | STRING  { $$ = new nth::String($1.substr(1, $1.size()-2)); }
-       | TRUE    { $$ = new nth::True; }
-       | FALSE   { $$ = new nth::False; }
-       | IDENT   { $$ = new nth::Identifier($1); }
+literal: INT     { BUILD($$ = new (driver.context) nth::Integer($1)); }
+       | BIGINT  { BUILD($$ = new (driver.context) nth::BigInteger(driver.constants.bigInteger($1))); }
+       | FLOAT   { BUILD($$ = new (driver.context) nth::Float($1)); }
+       | STRING  { BUILD($$ = new (driver.context) nth::String(driver.constants.string($1))); }
+       | interpolated_string { $$ = take($1); }
+       | TRUE    { BUILD($$ = new (driver.context) nth::True); }
+       | FALSE   { BUILD($$ = new (driver.context) nth::False); }
+       | IDENT   { BUILD($$ = new (driver.context) nth::Identifier(driver.names.get($1))); }
        | compound_literal { std::swap($$, $1); }
        ;
 
-compound_literal: array { nth::Expression *e = $1; std::swap($$, e); }
-                | map   { nth::Expression *e = $1; std::swap($$, e); }
-                | range { nth::Expression *e = $1; std::swap($$, e); }
-                | tuple { nth::Expression *e = $1; std::swap($$, e); }
+compound_literal: array { $$ = take($1); }
+                | map   { $$ = take($1); }
+                | range { $$ = take($1); }
+                | tuple { $$ = take($1); }
                 ;
 
 
-  /* Array */
-array: "[" exprlist "]" { $$ = new nth::Array(*$2); }
-     | "[" "]"          { $$ = new nth::Array(); }
+  /* Lists are built left-recursively, so that the parser's stack doesn't
+     grow with their length, and each is moved into the node that ends up
+     holding it rather than copied. */
+
+  /* Array. Elements that are all constants of one kind are packed as
+     they're reduced (see nth::PackedArray). */
+array: "[" elements "]" { BUILD($$ = $2.build(driver.context)); }
+     | "[" "]"          { BUILD($$ = new (driver.context) nth::Array()); }
      ;
 
-exprlist: expr               { $$ = new nth::ExpressionList(1, $1); }
-        | exprlist "," expr  { std::swap($$, $1); $$->push_back($3); }
+elements: expr               { BUILD($$.push_back(take($1), driver.context)); }
+        | elements "," expr  { BUILD($$ = take($1); $$.push_back(take($3), driver.context)); }
+        ;
+
+exprlist: expr               { BUILD($$.push_back(take($1))); }
+        | exprlist "," expr  { BUILD($$ = take($1); $$.push_back(take($3))); }
         ;
 
 
   /* Map */
-map: "{" key_val_list "}" { $$ = new nth::Map(*$2); }
-    | "{" "}"              { $$ = new nth::Map(); }
+map: "{" key_val_list "}" { BUILD($$ = new (driver.context) nth::Map(take($2))); }
+    | "{" "}"              { BUILD($$ = new (driver.context) nth::Map()); }
     ;
 
-key_val_list: key_value                   { $$ = new nth::ExpressionMap(); $$->push_back($1); }
-            | key_val_list "," key_value  { std::swap($$, $1); $$->push_back($3); }
+key_val_list: key_value                   { BUILD($$.push_back(take($1))); }
+            | key_val_list "," key_value  { BUILD($$ = take($1); $$.push_back(take($3))); }
             ;
 
-key_value: key ":" expr { $$ = std::make_pair($1, $3); }
+key_value: key ":" expr { $$ = std::make_pair(take($1), take($3)); }
          ;
 
-key: STRING { $$ = new nth::String($1.substr(1, $1.size()-2)); }
+key: STRING { BUILD($$ = new (driver.context) nth::String(driver.constants.string($1))); }
    ;
 
 
+  /* Interpolated strings arrive in pieces: "a#{x}b#{y}c" is scanned as
+     STRING_HEAD(a) x STRING_MID(b) y STRING_TAIL(c) */
+interpolated_string: interpolation STRING_TAIL { BUILD(std::swap($$, $1); $$->addLiteral($2.str())); }
+                   ;
+
+interpolation: STRING_HEAD expr { BUILD($$ = new (driver.context) nth::InterpolatedString(); $$->addLiteral($1.str()); $$->addExpression(take($2))); }
+             | interpolation STRING_MID expr { BUILD(std::swap($$, $1); $$->addLiteral($2.str()); $$->addExpression(take($3))); }
+             ;
+
+
   /* Range */
-range: INT ".." INT   { $$ = new nth::Range(new nth::Integer($1), new nth::Integer($3), nth::Range::Exclusivity::Exclusive); }
-     | INT "..." INT  { $$ = new nth::Range(new nth::Integer($1), new nth::Integer($3), nth::Range::Exclusivity::Inclusive); }
+range: INT ".." INT   { BUILD($$ = new (driver.context) nth::Range(new (driver.context) nth::Integer($1), new (driver.context) nth::Integer($3), nth::Range::Exclusivity::Exclusive)); }
+     | INT "..." INT  { BUILD($$ = new (driver.context) nth::Range(new (driver.context) nth::Integer($1), new (driver.context) nth::Integer($3), nth::Range::Exclusivity::Inclusive)); }
      ;
 
 
   /* Tuple */
-tuple: "(" exprlist ")" { $$ = new nth::Tuple(*$2); }
+tuple: "(" exprlist ")" { BUILD($$ = new (driver.context) nth::Tuple(take($2))); }
      ;
 
   /* end literals */
 
 
-binary_op: boolean_op     { nth::Expression *e = $1; std::swap($$, e); }
-         | comparison_op  { nth::Expression *e = $1; std::swap($$, e); }
-         | math_op        { nth::Expression *e = $1; std::swap($$, e); }
-         | bitwise_op     { nth::Expression *e = $1; std::swap($$, e); }
-         | subscript      { nth::Expression *e = $1; std::swap($$, e); }
-         | field_access { nth::Expression *e = $1; std::swap($$, e); }
+binary_op: boolean_op     { $$ = take($1); }
+         | comparison_op  { $$ = take($1); }
+         | math_op        { $$ = take($1); }
+         | bitwise_op     { $$ = take($1); }
+         | subscript      { $$ = take($1); }
+         | field_access { $$ = take($1); }
          ;
 
-boolean_op: expr "&&" expr  { $$ = new nth::LogicalAnd(nth::ExpressionPtr($1), nth::ExpressionPtr($3)); }
-          | expr "||" expr  { $$ = new nth::LogicalOr(nth::ExpressionPtr($1), nth::ExpressionPtr($3)); }
+boolean_op: expr "&&" expr  { BUILD($$ = new (driver.context) nth::LogicalAnd(nth::ExpressionPtr(take($1)), nth::ExpressionPtr(take($3)))); }
+          | expr "||" expr  { BUILD($$ = new (driver.context) nth::LogicalOr(nth::ExpressionPtr(take($1)), nth::ExpressionPtr(take($3)))); }
           ;
 
-comparison_op: expr CMP expr { $$ = new nth::Comparison(nth::ExpressionPtr($1), nth::ExpressionPtr($3), $2); }
+comparison_op: expr CMP expr { BUILD($$ = new (driver.context) nth::Comparison(nth::ExpressionPtr(take($1)), nth::ExpressionPtr(take($3)), $2)); }
              ;
 
-math_op: expr "+" expr  { $$ = new nth::Add(nth::ExpressionPtr($1), nth::ExpressionPtr($3)); }
-       | expr "-" expr  { $$ = new nth::Subtract(nth::ExpressionPtr($1), nth::ExpressionPtr($3)); }
-       | expr "*" expr  { $$ = new nth::Multiply(nth::ExpressionPtr($1), nth::ExpressionPtr($3)); }
-       | expr "/" expr  { $$ = new nth::Divide(nth::ExpressionPtr($1), nth::ExpressionPtr($3)); }
-       | expr "^" expr  { $$ = new nth::Exponentiate(nth::ExpressionPtr($1), nth::ExpressionPtr($3)); }
-       | expr "%" expr  { $$ = new nth::Modulo(nth::ExpressionPtr($1), nth::ExpressionPtr($3)); }
+math_op: expr "+" expr  { BUILD($$ = new (driver.context) nth::Add(nth::ExpressionPtr(take($1)), nth::ExpressionPtr(take($3)))); }
+       | expr "-" expr  { BUILD($$ = new (driver.context) nth::Subtract(nth::ExpressionPtr(take($1)), nth::ExpressionPtr(take($3)))); }
+       | expr "*" expr  { BUILD($$ = new (driver.context) nth::Multiply(nth::ExpressionPtr(take($1)), nth::ExpressionPtr(take($3)))); }
+       | expr "/" expr  { BUILD($$ = new (driver.context) nth::Divide(nth::ExpressionPtr(take($1)), nth::ExpressionPtr(take($3)))); }
+       | expr "^" expr  { BUILD($$ = new (driver.context) nth::Exponentiate(nth::ExpressionPtr(take($1)), nth::ExpressionPtr(take($3)))); }
+       | expr "%" expr  { BUILD($$ = new (driver.context) nth::Modulo(nth::ExpressionPtr(take($1)), nth::ExpressionPtr(take($3)))); }
        ;
 
-bitwise_op: expr "<<" INT { $$ = new nth::BitShiftLeft(nth::ExpressionPtr($1), std::unique_ptr<nth::Integer>(new nth::Integer($3))); }
-          | expr ">>" INT { $$ = new nth::BitShiftRight(nth::ExpressionPtr($1), std::unique_ptr<nth::Integer>(new nth::Integer($3))); }
-          | expr "|" expr { $$ = new nth::BitwiseOr(nth::ExpressionPtr($1), nth::ExpressionPtr($3)); }
-          | expr "&" expr { $$ = new nth::BitwiseAnd(nth::ExpressionPtr($1), nth::ExpressionPtr($3)); }
+bitwise_op: expr "<<" INT { BUILD($$ = new (driver.context) nth::BitShiftLeft(nth::ExpressionPtr(take($1)), std::unique_ptr<nth::Integer>(new (driver.context) nth::Integer($3)))); }
+          | expr ">>" INT { BUILD($$ = new (driver.context) nth::BitShiftRight(nth::ExpressionPtr(take($1)), std::unique_ptr<nth::Integer>(new (driver.context) nth::Integer($3)))); }
+          | expr "|" expr { BUILD($$ = new (driver.context) nth::BitwiseOr(nth::ExpressionPtr(take($1)), nth::ExpressionPtr(take($3)))); }
+          | expr "&" expr { BUILD($$ = new (driver.context) nth::BitwiseAnd(nth::ExpressionPtr(take($1)), nth::ExpressionPtr(take($3)))); }
           ;
 
-unary_op: "!" expr %prec NOT      { $$ = new nth::LogicalNot(nth::ExpressionPtr($2)); }
-        | "~" expr %prec BIT_NOT  { $$ = new nth::BitwiseNot(nth::ExpressionPtr($2)); }
+unary_op: "!" expr %prec NOT      { BUILD($$ = new (driver.context) nth::LogicalNot(nth::ExpressionPtr(take($2)))); }
+        | "~" expr %prec BIT_NOT  { BUILD($$ = new (driver.context) nth::BitwiseNot(nth::ExpressionPtr(take($2)))); }
         ;
 
-subscript: expr "[" expr "]" { $$ = new nth::Subscript($1, $3); }
+subscript: expr "[" expr "]" { BUILD($$ = new (driver.context) nth::Subscript(take($1), take($3))); }
          ;
 
-field_access: expr "." IDENT { $$ = new nth::FieldAccess($1, new nth::Identifier($IDENT, @IDENT)); }
-            | expr "." INT   { $$ = new nth::TupleFieldAccess($1, new nth::Integer($INT)); }
+field_access: expr "." IDENT { BUILD($$ = new (driver.context) nth::FieldAccess(take($1), new (driver.context) nth::Identifier(driver.names.get($IDENT), @IDENT))); }
+            | expr "." INT   { BUILD($$ = new (driver.context) nth::TupleFieldAccess(take($1), new (driver.context) nth::Integer($INT))); }
             ;
 
 
@@ -233,81 +313,90 @@ field_access: expr "." IDENT { $$ = new nth::FieldAccess($1, new nth::Identifier
   /* Functions */
 block: "{" statements "}"  { std::swap($$, $2); }
 
+body: block  { $$.block = take($1); }
+    | BODY   { $$.parser = take($1); }
+    ;
+
 func_def: func_def_without_type_param { std::swap($$, $1); }
         | func_def_with_type_param    { std::swap($$, $1); }
         ;
 
-func_def_with_type_param: DEF IDENT type_param "(" arglist ")" ":" typeref block {
-            $$ = new nth::FunctionDef(
-              new nth::Identifier($2),
-              *$5, $8, $9, *$3
-            );
+func_def_with_type_param: DEF IDENT type_param "(" arglist ")" ":" typeref body {
+            BUILD($$ = new (driver.context) nth::FunctionDef(
+                new (driver.context) nth::Identifier(driver.names.get($2)),
+                take($5), take($8), take($9), take($3)
+              ));
           }
         ;
 
-func_def_without_type_param: DEF IDENT "(" arglist ")" ":" typeref block {
-            $$ = new nth::FunctionDef(
-              new nth::Identifier($2),
-              *$4, $7, $8, *(new nth::TypeDefList)
-            );
+func_def_without_type_param: DEF IDENT "(" arglist ")" ":" typeref body {
+            BUILD($$ = new (driver.context) nth::FunctionDef(
+                new (driver.context) nth::Identifier(driver.names.get($2)),
+                take($4), take($7), take($8), nth::TypeDefList()
+              ));
           }
         ;
 
-type_param: "[" type_param_list "]"  { std::swap($$, $2); }
+type_param: "[" type_param_list "]"  { $$ = take($2); }
               ;
 
-type_alias_def: TYPE IDENT "=" typeref { $$ = new nth::TypeAliasDef(new nth::SimpleTypeDef(new nth::Identifier($2)), $4); }
+type_alias_def: TYPE IDENT "=" typeref { BUILD($$ = new (driver.context) nth::TypeAliasDef(new (driver.context) nth::SimpleTypeDef(new (driver.context) nth::Identifier(driver.names.get($2))), take($4))); }
               ;
 
-lambda: "(" arglist ")" ":" typeref "=>" expr { $$ = new nth::LambdaDef(*$2, $5, $7); }
+lambda: "(" arglist ")" ":" typeref "=>" expr { BUILD($$ = new (driver.context) nth::LambdaDef(take($2), take($5), take($7))); }
       ;
 
-arglist: arg               { $$ = new nth::ArgList(1, $1); }
-       | arg "," arglist   { std::swap($$, $3); $$->push_front($1); }
-       | /* no arguments */{ $$ = new nth::ArgList(); }
+  /* A trailing comma is allowed */
+arglist: args      { $$ = take($1); }
+       | args ","  { $$ = take($1); }
+       | %empty    { $$ = nth::ArgList(); }
        ;
 
-arg: IDENT ":" typeref { $$ = new nth::Argument(new nth::Identifier($1), $3); }
+args: arg           { BUILD($$.push_back(take($1))); }
+    | args "," arg  { BUILD($$ = take($1); $$.push_back(take($3))); }
+    ;
+
+arg: IDENT ":" typeref { BUILD($$ = new (driver.context) nth::Argument(new (driver.context) nth::Identifier(driver.names.get($1)), take($3))); }
    ;
 
-func_call: expr "(" exprlist ")"  { $$ = new nth::FunctionCall($1, *$3); }
-         | expr "(" ")"           { $$ = new nth::FunctionCall($1, *(new nth::ExpressionList)); }
+func_call: expr "(" exprlist ")"  { BUILD($$ = new (driver.context) nth::FunctionCall(take($1), take($3))); }
+         | expr "(" ")"           { BUILD($$ = new (driver.context) nth::FunctionCall(take($1), nth::ExpressionList())); }
          ;
 
   /* Variables */
 val_def: VAL IDENT ":" typeref "=" expr {
-           $$ = new nth::VariableDef(new nth::Identifier($2), $4, $6);
+           BUILD($$ = new (driver.context) nth::VariableDef(new (driver.context) nth::Identifier(driver.names.get($2)), take($4), take($6)));
          }
        ;
 
   /* Control Flow */
 
-if_else: IF "(" expr ")" block             { $$ = new nth::IfElse($3, $5, nullptr); }
-       | IF "(" expr ")" block ELSE block  { $$ = new nth::IfElse($3, $5, $7); }
+if_else: IF "(" expr ")" block             { BUILD($$ = new (driver.context) nth::IfElse(take($3), take($5), nullptr)); }
+       | IF "(" expr ")" block ELSE block  { BUILD($$ = new (driver.context) nth::IfElse(take($3), take($5), take($7))); }
        ;
 
   /* Types */
 
-typeref_list: typeref                  { $$ = new nth::TypeRefList(1, $1); }
-           | typeref "," typeref_list  { std::swap($$, $3); $$->push_front($1); }
-           ;
+typeref_list: typeref                   { BUILD($$.push_back(take($1))); }
+            | typeref_list "," typeref  { BUILD($$ = take($1); $$.push_back(take($3))); }
+            ;
 
-typeref: IDENT                          { $$ = new nth::SimpleTypeRef(new nth::Identifier($IDENT, @IDENT)); }
-       | IDENT "[" typeref_list "]"      { $$ = new nth::TemplatedTypeRef(new nth::Identifier($1), *$3); }
-       | "(" typeref_list ")"            { $$ = new nth::TupleTypeRef(*$2); } /* TODO: replace N with length of typeref_list */
-       | "(" typeref_list ")" "=>" typeref  { $$ = new nth::FunctionTypeRef(*$2, $5); } /* TODO: look up typeref instance by string */
-       | "(" ")" "=>" typeref              { $$ = new nth::FunctionTypeRef(*(new nth::TypeRefList()), $4); }
+typeref: IDENT                          { BUILD($$ = new (driver.context) nth::SimpleTypeRef(new (driver.context) nth::Identifier(driver.names.get($IDENT), @IDENT))); }
+       | IDENT "[" typeref_list "]"      { BUILD($$ = new (driver.context) nth::TemplatedTypeRef(new (driver.context) nth::Identifier(driver.names.get($1)), take($3))); }
+       | "(" typeref_list ")"            { BUILD($$ = new (driver.context) nth::TupleTypeRef(take($2))); } /* TODO: replace N with length of typeref_list */
+       | "(" typeref_list ")" "=>" typeref  { BUILD($$ = new (driver.context) nth::FunctionTypeRef(take($2), take($5))); } /* TODO: look up typeref instance by string */
+       | "(" ")" "=>" typeref              { BUILD($$ = new (driver.context) nth::FunctionTypeRef(nth::TypeRefList(), take($4))); }
        ;
 
-type_param_list: typedef                    { $$ = new nth::TypeDefList(1, $1); }
-               | typedef "," type_param_list  { std::swap($$, $3); $$->push_front($1); }
+type_param_list: typedef                      { BUILD($$.push_back(take($1))); }
+               | type_param_list "," typedef  { BUILD($$ = take($1); $$.push_back(take($3))); }
                ;
 
-typedef: IDENT  { $$ = new nth::SimpleTypeDef(new nth::Identifier($1)); }
+typedef: IDENT  { BUILD($$ = new (driver.context) nth::SimpleTypeDef(new (driver.context) nth::Identifier(driver.names.get($1)))); }
        ;
        
 %%
 
 void yy::parser::error(const location_type& l, const std::string& m) {
-  driver.error(l, m);
+  driver.syntaxError(l, m);
 }
@@ -0,0 +1,533 @@
+//
+//  pratt_parser.cc
+//  nth
+//
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "driver.h"
+#include "pratt_parser.h"
+
+using namespace nth;
+
+namespace {
+
+typedef yy::parser::symbol_kind K;
+
+// Binding powers follow the %left declarations in parse.y, weakest first.
+// Those of "!" and "~" are how tightly they hold on to their operand.
+const int kNotPower = 9;
+const int kBitNotPower = 8;
+
+int bindingPower(yy::parser::symbol_kind::symbol_kind_type kind) {
+  switch (kind) {
+    case K::S_PLUS: case K::S_MINUS: return 3;
+    case K::S_TIMES: case K::S_DIVIDE: return 4;
+    case K::S_MODULO: case K::S_BIT_OR: case K::S_POW: case K::S_BIT_AND: return 5;
+    case K::S_LSHIFT: case K::S_RSHIFT: return 6;
+    case K::S_CMP: return 7;
+    case K::S_AND: case K::S_OR: return 10;
+    default: return 0;
+  }
+}
+
+std::string text(const yy::parser::symbol_type &symbol) {
+  return symbol.value.as<StringRef>().str();
+}
+
+void deleteItem(ASTNode *node) { delete node; }
+void deleteItem(const KeyValuePair &pair) {
+  delete pair.first;
+  delete pair.second;
+}
+
+// Deletes what's in a list should a syntax error give up on it half built.
+// Once the list is handed on, it's let go of.
+template <typename List>
+class ListGuard {
+ public:
+  explicit ListGuard(List &list) : list(&list) {}
+  ~ListGuard() {
+    if (!list) return;
+    for (auto &item : *list) deleteItem(item);
+  }
+  void release() { list = nullptr; }
+
+ private:
+  List *list;
+};
+
+}
+
+PrattParser::PrattParser(Driver &driver) : driver(driver), quiet(0) {}
+
+Name PrattParser::nameOf(const Symbol &ident) {
+  return driver.names.get(ident.value.as<StringRef>());
+}
+
+int PrattParser::parse() {
+  try {
+    parseTopLevel();
+  } catch (Abort &) {
+    return 1;
+  }
+  return 0;
+}
+
+PrattParser::Kind PrattParser::peek(size_t ahead) {
+  while (lookahead.size() <= ahead) {
+    lookahead.push_back(driver.lex());
+  }
+  return lookahead[ahead].kind();
+}
+
+const yy::location &PrattParser::peekLocation() {
+  peek();
+  return lookahead.front().location;
+}
+
+PrattParser::Symbol PrattParser::take() {
+  peek();
+  Symbol symbol(std::move(lookahead.front()));
+  lookahead.pop_front();
+  if (quiet) --quiet;
+  return symbol;
+}
+
+PrattParser::Symbol PrattParser::expect(Kind kind) {
+  if (peek() != kind) fail({kind});
+  return take();
+}
+
+bool PrattParser::accept(Kind kind) {
+  if (peek() != kind) return false;
+  take();
+  return true;
+}
+
+void PrattParser::fail(std::initializer_list<Kind> expected) {
+  if (!quiet) {
+    // Worded as bison words it, which lists what it was expecting only
+    // when that's no more than four tokens, in the order it numbers them
+    std::string message = "syntax error, unexpected " + yy::parser::symbol_name(peek());
+    std::vector<Kind> kinds(expected);
+    std::sort(kinds.begin(), kinds.end());
+    for (size_t i = 0; i < kinds.size(); ++i) {
+      message += (i ? " or " : ", expecting ") + yy::parser::symbol_name(kinds[i]);
+    }
+    driver.syntaxError(peekLocation(), message);
+  }
+  throw SyntaxError();
+}
+
+template <typename Resumes>
+void PrattParser::recover(Resumes resumes) {
+  // A token that was in error before any other was accepted can't be
+  // carried on from either
+  if (quiet == 3) {
+    if (peek() == K::S_YYEOF) throw Abort();
+    lookahead.pop_front();
+  }
+  quiet = 3;
+  while (!resumes(peek())) {
+    if (peek() == K::S_YYEOF) throw Abort();
+    lookahead.pop_front();
+  }
+}
+
+bool PrattParser::startsExpression(Kind kind) {
+  switch (kind) {
+    case K::S_INT: case K::S_BIGINT: case K::S_FLOAT: case K::S_STRING:
+    case K::S_STRING_HEAD: case K::S_TRUE: case K::S_FALSE: case K::S_IDENT:
+    case K::S_LBRACKET: case K::S_LCURLY: case K::S_LPAREN:
+    case K::S_NOT: case K::S_BIT_NOT: case K::S_IF:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool PrattParser::startsStatement(Kind kind) {
+  return startsExpression(kind) || kind == K::S_VAL || kind == K::S_DEF || kind == K::S_TYPE;
+}
+
+// Statements
+
+void PrattParser::parseTopLevel() {
+  // As in parse.y, there must be at least one statement, and the Block is
+  // made the driver's result as soon as the first is done with
+  do {
+    try {
+      if (!startsStatement(peek())) fail();
+      yy::location location = peekLocation();
+      ASTNode *statement = parseStatement();
+      if (!driver.result) driver.result = new (driver.context) Block();
+      driver.addTopLevelStatement(driver.result, statement, location);
+    } catch (SyntaxError &) {
+      if (!driver.result) driver.result = new (driver.context) Block();
+      recover([](Kind kind) { return kind == K::S_YYEOF || startsStatement(kind); });
+    }
+  } while (peek() != K::S_YYEOF);
+}
+
+Block *PrattParser::parseBlock() {
+  take(); // "{"
+  std::unique_ptr<Block> block(new (driver.context) Block());
+  do {
+    try {
+      if (!startsStatement(peek())) fail();
+      ASTNode *statement = parseStatement();
+      if (statement) block->insertAfter(statement);
+    } catch (SyntaxError &) {
+      recover([](Kind kind) { return kind == K::S_RCURLY || startsStatement(kind); });
+    }
+  } while (peek() != K::S_RCURLY);
+  take();
+  return block.release();
+}
+
+FunctionBody PrattParser::parseBody() {
+  FunctionBody body = {nullptr, nullptr};
+  if (peek() == K::S_BODY) {
+    // The token would otherwise delete its parser as it goes (see parse.y)
+    Symbol token = take();
+    std::swap(body.parser, token.value.as<BlockParser *>());
+  } else if (peek() == K::S_LCURLY) {
+    body.block = parseBlock();
+  } else {
+    fail({K::S_LCURLY, K::S_BODY});
+  }
+  return body;
+}
+
+ASTNode *PrattParser::parseStatement() {
+  switch (peek()) {
+    case K::S_VAL: return parseValDef();
+    case K::S_DEF: return parseFunctionDef();
+    case K::S_TYPE: return parseTypeAliasDef();
+    default: return parseExpr();
+  }
+}
+
+ASTNode *PrattParser::parseFunctionDef() {
+  take(); // "def"
+  try {
+    Symbol name = expect(K::S_IDENT);
+    TypeDefList typeParams;
+    ListGuard<TypeDefList> typeParamsGuard(typeParams);
+    if (accept(K::S_LBRACKET)) {
+      do {
+        typeParams.push_back(new (driver.context) SimpleTypeDef(new (driver.context) Identifier(nameOf(expect(K::S_IDENT)))));
+      } while (accept(K::S_COMMA));
+      if (!accept(K::S_RBRACKET)) fail({K::S_COMMA, K::S_RBRACKET});
+      expect(K::S_LPAREN);
+    } else if (!accept(K::S_LPAREN)) {
+      fail({K::S_LPAREN, K::S_LBRACKET});
+    }
+    ArgList args = parseArgList();
+    ListGuard<ArgList> argsGuard(args);
+    expect(K::S_COLON);
+    std::unique_ptr<TypeRef> returnType(parseTypeRef());
+    FunctionBody body = parseBody();
+    typeParamsGuard.release();
+    argsGuard.release();
+    return new (driver.context) FunctionDef(new (driver.context) Identifier(nameOf(name)), std::move(args), returnType.release(),
+                           body, std::move(typeParams));
+  } catch (SyntaxError &) {
+    // A function whose signature is in error is still worth looking
+    // inside for more errors, though it can't be kept
+    recover([](Kind kind) { return kind == K::S_LCURLY || kind == K::S_BODY; });
+    FunctionBody body = parseBody();
+    delete body.block;
+    delete body.parser;
+    return nullptr;
+  }
+}
+
+VariableDef *PrattParser::parseValDef() {
+  take(); // "val"
+  Symbol name = expect(K::S_IDENT);
+  expect(K::S_COLON);
+  std::unique_ptr<TypeRef> type(parseTypeRef());
+  expect(K::S_ASSIGN);
+  Expression *value = parseExpr();
+  return new (driver.context) VariableDef(new (driver.context) Identifier(nameOf(name)), type.release(), value);
+}
+
+TypeAliasDef *PrattParser::parseTypeAliasDef() {
+  take(); // "type"
+  Symbol name = expect(K::S_IDENT);
+  expect(K::S_ASSIGN);
+  return new (driver.context) TypeAliasDef(new (driver.context) SimpleTypeDef(new (driver.context) Identifier(nameOf(name))), parseTypeRef());
+}
+
+// Expressions
+
+Expression *PrattParser::parseExpr(int minPower) {
+  ExpressionPtr left(parsePrimary());
+  for (;;) {
+    // Calls, subscripts and field access bind tighter than any operator
+    Kind kind = peek();
+    if (kind == K::S_LPAREN) {
+      take();
+      ExpressionList args;
+      if (!accept(K::S_RPAREN)) args = parseExprList(K::S_RPAREN);
+      left.reset(new (driver.context) FunctionCall(left.release(), std::move(args)));
+      continue;
+    }
+    if (kind == K::S_LBRACKET) {
+      take();
+      ExpressionPtr index(parseExpr());
+      if (!accept(K::S_RBRACKET)) fail();
+      left.reset(new (driver.context) Subscript(left.release(), index.release()));
+      continue;
+    }
+    if (kind == K::S_PERIOD) {
+      take();
+      if (peek() == K::S_IDENT) {
+        Symbol field = take();
+        left.reset(new (driver.context) FieldAccess(left.release(), new (driver.context) Identifier(nameOf(field), field.location)));
+      } else if (peek() == K::S_INT) {
+        left.reset(new (driver.context) TupleFieldAccess(left.release(), new (driver.context) Integer(take().value.as<long>())));
+      } else {
+        fail({K::S_INT, K::S_IDENT});
+      }
+      continue;
+    }
+
+    int power = bindingPower(kind);
+    if (power <= minPower) {
+      return left.release();
+    }
+    Symbol op = take();
+
+    // Only a literal can be shifted by
+    if (kind == K::S_LSHIFT || kind == K::S_RSHIFT) {
+      std::unique_ptr<Integer> bits(new (driver.context) Integer(expect(K::S_INT).value.as<long>()));
+      if (kind == K::S_LSHIFT) {
+        left.reset(new (driver.context) BitShiftLeft(std::move(left), std::move(bits)));
+      } else {
+        left.reset(new (driver.context) BitShiftRight(std::move(left), std::move(bits)));
+      }
+      continue;
+    }
+
+    ExpressionPtr right(parseExpr(power));
+    switch (kind) {
+      case K::S_PLUS: left.reset(new (driver.context) Add(std::move(left), std::move(right))); break;
+      case K::S_MINUS: left.reset(new (driver.context) Subtract(std::move(left), std::move(right))); break;
+      case K::S_TIMES: left.reset(new (driver.context) Multiply(std::move(left), std::move(right))); break;
+      case K::S_DIVIDE: left.reset(new (driver.context) Divide(std::move(left), std::move(right))); break;
+      case K::S_POW: left.reset(new (driver.context) Exponentiate(std::move(left), std::move(right))); break;
+      case K::S_MODULO: left.reset(new (driver.context) Modulo(std::move(left), std::move(right))); break;
+      case K::S_BIT_OR: left.reset(new (driver.context) BitwiseOr(std::move(left), std::move(right))); break;
+      case K::S_BIT_AND: left.reset(new (driver.context) BitwiseAnd(std::move(left), std::move(right))); break;
+      case K::S_AND: left.reset(new (driver.context) LogicalAnd(std::move(left), std::move(right))); break;
+      case K::S_OR: left.reset(new (driver.context) LogicalOr(std::move(left), std::move(right))); break;
+      case K::S_CMP:
+        left.reset(new (driver.context) Comparison(std::move(left), std::move(right),
+                                  op.value.as<Comparison::Type>()));
+        break;
+      default: break;
+    }
+  }
+}
+
+Expression *PrattParser::parsePrimary() {
+  switch (peek()) {
+    case K::S_INT: {
+      long value = take().value.as<long>();
+      Range::Exclusivity exclusivity;
+      if (accept(K::S_DOUBLE_DOT)) {
+        exclusivity = Range::Exclusivity::Exclusive;
+      } else if (accept(K::S_TRIPLE_DOT)) {
+        exclusivity = Range::Exclusivity::Inclusive;
+      } else {
+        return new (driver.context) Integer(value);
+      }
+      long end = expect(K::S_INT).value.as<long>();
+      return new (driver.context) Range(new (driver.context) Integer(value), new (driver.context) Integer(end), exclusivity);
+    }
+    case K::S_BIGINT: {
+      StringRef digits = take().value.as<StringRef>();
+      return new (driver.context) BigInteger(driver.constants.bigInteger(digits));
+    }
+    case K::S_FLOAT: return new (driver.context) Float(take().value.as<double>());
+    case K::S_STRING: return new (driver.context) String(driver.constants.string(take().value.as<StringRef>()));
+    case K::S_STRING_HEAD: return parseInterpolatedString();
+    case K::S_TRUE: take(); return new (driver.context) True;
+    case K::S_FALSE: take(); return new (driver.context) False;
+    case K::S_IDENT: return new (driver.context) Identifier(nameOf(take()));
+
+    case K::S_LBRACKET: {
+      take();
+      if (accept(K::S_RBRACKET)) return new (driver.context) Array();
+      ArrayBuilder elements;
+      try {
+        do {
+          elements.push_back(parseExpr(), driver.context);
+        } while (accept(K::S_COMMA));
+        if (!accept(K::S_RBRACKET)) fail({K::S_COMMA, K::S_RBRACKET});
+      } catch (...) {
+        elements.discard();
+        throw;
+      }
+      return elements.build(driver.context);
+    }
+
+    case K::S_LCURLY: {
+      take();
+      if (accept(K::S_RCURLY)) return new (driver.context) Map();
+      if (peek() != K::S_STRING) fail({K::S_RCURLY, K::S_STRING});
+      ExpressionMap values;
+      ListGuard<ExpressionMap> guard(values);
+      do {
+        StringRef keyText = expect(K::S_STRING).value.as<StringRef>();
+        std::unique_ptr<String> key(new (driver.context) String(driver.constants.string(keyText)));
+        expect(K::S_COLON);
+        Expression *value = parseExpr();
+        values.push_back(std::make_pair(key.release(), value));
+      } while (accept(K::S_COMMA));
+      if (!accept(K::S_RCURLY)) fail({K::S_COMMA, K::S_RCURLY});
+      guard.release();
+      return new (driver.context) Map(std::move(values));
+    }
+
+    case K::S_LPAREN: return parseParenthesized();
+    case K::S_NOT: take(); return new (driver.context) LogicalNot(ExpressionPtr(parseExpr(kNotPower)));
+    case K::S_BIT_NOT: take(); return new (driver.context) BitwiseNot(ExpressionPtr(parseExpr(kBitNotPower)));
+    case K::S_IF: return parseIfElse();
+
+    default:
+      fail();
+  }
+}
+
+Expression *PrattParser::parseParenthesized() {
+  // "()" and "(name:" can only begin a lambda
+  if (peek(1) == K::S_RPAREN || (peek(1) == K::S_IDENT && peek(2) == K::S_COLON)) {
+    return parseLambda();
+  }
+  take(); // "("
+  // bison takes anything else for the end of an empty parameter list
+  if (!startsExpression(peek())) fail({K::S_RPAREN});
+
+  ExpressionPtr first(parseExpr());
+  if (accept(K::S_RPAREN)) return first.release();
+  if (peek() != K::S_COMMA) fail({K::S_COMMA, K::S_RPAREN});
+  take();
+  ExpressionList values = parseExprList(K::S_RPAREN);
+  values.insert(values.begin(), first.release());
+  return new (driver.context) Tuple(std::move(values));
+}
+
+Expression *PrattParser::parseInterpolatedString() {
+  std::unique_ptr<InterpolatedString> string(new (driver.context) InterpolatedString());
+  string->addLiteral(text(take()));
+  string->addExpression(parseExpr());
+  while (peek() == K::S_STRING_MID) {
+    string->addLiteral(text(take()));
+    string->addExpression(parseExpr());
+  }
+  if (peek() != K::S_STRING_TAIL) fail({K::S_STRING_MID, K::S_STRING_TAIL});
+  string->addLiteral(text(take()));
+  return string.release();
+}
+
+Expression *PrattParser::parseIfElse() {
+  take(); // "if"
+  expect(K::S_LPAREN);
+  ExpressionPtr condition(parseExpr());
+  if (!accept(K::S_RPAREN)) fail();
+  if (peek() != K::S_LCURLY) fail({K::S_LCURLY});
+  std::unique_ptr<Block> then(parseBlock());
+  std::unique_ptr<Block> otherwise;
+  if (accept(K::S_ELSE)) {
+    if (peek() != K::S_LCURLY) fail({K::S_LCURLY});
+    otherwise.reset(parseBlock());
+  }
+  return new (driver.context) IfElse(condition.release(), then.release(), otherwise.release());
+}
+
+LambdaDef *PrattParser::parseLambda() {
+  take(); // "("
+  ArgList args = parseArgList();
+  ListGuard<ArgList> argsGuard(args);
+  expect(K::S_COLON);
+  std::unique_ptr<TypeRef> returnType(parseTypeRef());
+  expect(K::S_HASH_ROCKET);
+  Expression *body = parseExpr();
+  argsGuard.release();
+  return new (driver.context) LambdaDef(std::move(args), returnType.release(), body);
+}
+
+ExpressionList PrattParser::parseExprList(Kind close) {
+  ExpressionList values;
+  ListGuard<ExpressionList> guard(values);
+  do {
+    values.push_back(parseExpr());
+  } while (accept(K::S_COMMA));
+  if (!accept(close)) fail({K::S_COMMA, close});
+  guard.release();
+  return values;
+}
+
+ArgList PrattParser::parseArgList() {
+  // Ends at ")", which may follow a trailing ","
+  ArgList args;
+  ListGuard<ArgList> guard(args);
+  while (peek() == K::S_IDENT) {
+    Symbol name = take();
+    expect(K::S_COLON);
+    TypeRef *type = parseTypeRef();
+    args.push_back(new (driver.context) Argument(new (driver.context) Identifier(nameOf(name)), type));
+    if (!accept(K::S_COMMA)) break;
+  }
+  expect(K::S_RPAREN);
+  guard.release();
+  return args;
+}
+
+// Types
+
+TypeRef *PrattParser::parseTypeRef() {
+  if (peek() == K::S_IDENT) {
+    Symbol name = take();
+    if (!accept(K::S_LBRACKET)) {
+      return new (driver.context) SimpleTypeRef(new (driver.context) Identifier(nameOf(name), name.location));
+    }
+    TypeRefList types = parseTypeRefList(K::S_RBRACKET);
+    return new (driver.context) TemplatedTypeRef(new (driver.context) Identifier(nameOf(name)), std::move(types));
+  }
+
+  if (!accept(K::S_LPAREN)) fail({K::S_LPAREN, K::S_IDENT});
+  if (accept(K::S_RPAREN)) {
+    expect(K::S_HASH_ROCKET);
+    return new (driver.context) FunctionTypeRef(TypeRefList(), parseTypeRef());
+  }
+  if (peek() != K::S_IDENT && peek() != K::S_LPAREN) {
+    fail({K::S_LPAREN, K::S_RPAREN, K::S_IDENT});
+  }
+  TypeRefList types = parseTypeRefList(K::S_RPAREN);
+  ListGuard<TypeRefList> guard(types);
+  if (accept(K::S_HASH_ROCKET)) {
+    TypeRef *returnType = parseTypeRef();
+    guard.release();
+    return new (driver.context) FunctionTypeRef(std::move(types), returnType);
+  }
+  guard.release();
+  return new (driver.context) TupleTypeRef(std::move(types));
+}
+
+TypeRefList PrattParser::parseTypeRefList(Kind close) {
+  TypeRefList types;
+  ListGuard<TypeRefList> guard(types);
+  do {
+    types.push_back(parseTypeRef());
+  } while (accept(K::S_COMMA));
+  if (!accept(close)) fail({K::S_COMMA, close});
+  guard.release();
+  return types;
+}
@@ -0,0 +1,104 @@
+//
+//  pratt_parser.h
+//  nth
+//
+
+#ifndef __nth__pratt_parser__
+#define __nth__pratt_parser__
+
+#include <deque>
+#include <initializer_list>
+#include "parse.hh"
+
+namespace nth {
+
+class Driver;
+
+// Hand-written replacement for the bison parser in parse.y. Statements are
+// parsed by recursive descent and expressions by precedence climbing, with
+// a binding power for each operator rather than an LR state machine, and
+// the result is the same tree, built from the same tokens (see
+// Driver::lex), as parse.y would build.
+//
+// Syntax errors are recovered from as bison does, so that the same errors
+// are reported at the same places and the same statements are kept: the
+// innermost block (or the top level, or the signature of a "def") gives
+// up on the statement in error, tokens are dropped until one can carry on
+// from there, and further errors are kept quiet until three tokens have
+// been accepted. Where bison would list the tokens it was expecting, so
+// does this, as far as it can tell. Whatever is given up on is deleted,
+// as parse.y's %destructor deletes it.
+class PrattParser {
+ public:
+  explicit PrattParser(Driver &driver);
+
+  // Returns as yy::parser::parse() would: 0 if the input was accepted,
+  // even with errors that were recovered from, or 1 if it had to give up.
+  int parse();
+
+ protected:
+  typedef yy::parser::symbol_type Symbol;
+  typedef yy::parser::symbol_kind::symbol_kind_type Kind;
+
+  // Thrown once a syntax error has been reported, and caught wherever it
+  // can be recovered from
+  struct SyntaxError {};
+
+  // Thrown when the input ends before an error can be recovered from
+  struct Abort {};
+
+  Kind peek(size_t ahead = 0);
+  const yy::location &peekLocation();
+  Symbol take();
+  Symbol expect(Kind kind);
+  bool accept(Kind kind);
+
+  // Reports an unexpected token, unless errors are being kept quiet, and
+  // throws SyntaxError
+  [[noreturn]] void fail(std::initializer_list<Kind> expected = {});
+
+  // Drops tokens until one for which resumes is true, having given up on
+  // the statement or signature in error
+  template <typename Resumes> void recover(Resumes resumes);
+
+  // The interned name of an IDENT
+  Name nameOf(const Symbol &ident);
+
+  static bool startsExpression(Kind kind);
+  static bool startsStatement(Kind kind);
+
+  void parseTopLevel();
+  Block *parseBlock();
+  FunctionBody parseBody();
+  ASTNode *parseStatement();
+  ASTNode *parseFunctionDef();
+  VariableDef *parseValDef();
+  TypeAliasDef *parseTypeAliasDef();
+
+  // Parses operators binding tighter than minPower, and their operands
+  Expression *parseExpr(int minPower = 0);
+  Expression *parsePrimary();
+  Expression *parseParenthesized();
+  Expression *parseInterpolatedString();
+  Expression *parseIfElse();
+  LambdaDef *parseLambda();
+
+  // A list of at least one expression, up to and including close
+  ExpressionList parseExprList(Kind close);
+
+  // Arguments up to and including ")", with a trailing "," allowed
+  ArgList parseArgList();
+  TypeRef *parseTypeRef();
+  TypeRefList parseTypeRefList(Kind close);
+
+  Driver &driver;
+  std::deque<Symbol> lookahead;
+
+  // Tokens still to be accepted before errors are reported again; three
+  // after recovering, as bison has it
+  int quiet;
+};
+
+}
+
+#endif /* defined(__nth__pratt_parser__) */
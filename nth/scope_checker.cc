@@ -32,7 +32,7 @@ IdentifierList &ScopeChecker::getUnknownIdentifiers() {
 }
 
 void ScopeChecker::withNewScope(ASTNode *node, std::function<void(SymbolTable&)> scopedFun) {
-  symbolTables.push(symbolTables.top()->beget());
+  symbolTables.push(symbolTables.top()->beget(node->getContext()));
   node->setSymbolTable(symbolTables.top());
   scopedFun(*symbolTables.top());
   symbolTables.pop();
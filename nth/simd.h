@@ -0,0 +1,80 @@
+//
+//  simd.h
+//  nth
+//
+
+#ifndef __nth__simd__
+#define __nth__simd__
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Thin wrappers over whichever byte vectors the target has, so that
+// scanning loops can be written once for AVX2 and SSE2. Code using them is
+// guarded by the same #if and keeps a scalar version for other targets.
+
+#if defined(__AVX2__) || defined(__SSE2__)
+
+namespace nth {
+namespace simd {
+
+#if defined(__AVX2__)
+typedef __m256i Vector;
+const ptrdiff_t kVectorSize = 32;
+const uint32_t kAllLanes = 0xffffffff;
+inline Vector load(const char *p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+inline Vector splat(char c) { return _mm256_set1_epi8(c); }
+inline Vector equal(Vector a, Vector b) { return _mm256_cmpeq_epi8(a, b); }
+inline Vector greater(Vector a, Vector b) { return _mm256_cmpgt_epi8(a, b); }
+inline Vector either(Vector a, Vector b) { return _mm256_or_si256(a, b); }
+inline Vector both(Vector a, Vector b) { return _mm256_and_si256(a, b); }
+inline Vector differ(Vector a, Vector b) { return _mm256_xor_si256(a, b); }
+inline uint32_t lanes(Vector v) { return _mm256_movemask_epi8(v); }
+
+// Bytes of current shifted up by N lanes, with the last N of previous
+// shifted in below them
+template <int N>
+inline Vector shiftIn(Vector current, Vector previous) {
+  return _mm256_alignr_epi8(current, _mm256_permute2x128_si256(previous, current, 0x21),
+                            16 - N);
+}
+#else
+typedef __m128i Vector;
+const ptrdiff_t kVectorSize = 16;
+const uint32_t kAllLanes = 0xffff;
+inline Vector load(const char *p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+inline Vector splat(char c) { return _mm_set1_epi8(c); }
+inline Vector equal(Vector a, Vector b) { return _mm_cmpeq_epi8(a, b); }
+inline Vector greater(Vector a, Vector b) { return _mm_cmpgt_epi8(a, b); }
+inline Vector either(Vector a, Vector b) { return _mm_or_si128(a, b); }
+inline Vector both(Vector a, Vector b) { return _mm_and_si128(a, b); }
+inline Vector differ(Vector a, Vector b) { return _mm_xor_si128(a, b); }
+inline uint32_t lanes(Vector v) { return _mm_movemask_epi8(v); }
+
+template <int N>
+inline Vector shiftIn(Vector current, Vector previous) {
+  return _mm_or_si128(_mm_slli_si128(current, N), _mm_srli_si128(previous, 16 - N));
+}
+#endif
+
+// Comparisons are signed: bytes >= 0x80 compare as negative
+inline Vector inRange(Vector v, char lo, char hi) {
+  return both(greater(v, splat(lo - 1)), greater(splat(hi + 1), v));
+}
+
+}
+}
+
+#endif
+
+#endif /* defined(__nth__simd__) */
@@ -0,0 +1,113 @@
+//
+//  source_buffer.cc
+//  nth
+//
+
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "source_buffer.h"
+
+using namespace nth;
+
+SourceBuffer *SourceBuffer::mapFile(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return nullptr;
+
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    int saved = errno;
+    close(fd);
+    errno = saved;
+    return nullptr;
+  }
+  if (!S_ISREG(st.st_mode)) {
+    close(fd);
+    errno = ENODEV;
+    return nullptr;
+  }
+
+  size_t size = st.st_size;
+  size_t pageSize = sysconf(_SC_PAGESIZE);
+  size_t length = (size + kSentinelSize + pageSize - 1) / pageSize * pageSize;
+
+  // Reserve zero-filled memory for the file plus its sentinels, then map the
+  // file over the front of it. Bytes past the end of the file are zero
+  // whether they land in the file's last page or in the reserved tail, so
+  // the sentinels never have to be written (or the file copied) by hand.
+  void *base = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANON, -1, 0);
+  if (base == MAP_FAILED) {
+    int saved = errno;
+    close(fd);
+    errno = saved;
+    return nullptr;
+  }
+
+  if (size > 0) {
+    void *mapped = mmap(base, size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_FIXED, fd, 0);
+    if (mapped == MAP_FAILED) {
+      int saved = errno;
+      munmap(base, length);
+      close(fd);
+      errno = saved;
+      return nullptr;
+    }
+    madvise(mapped, size, MADV_SEQUENTIAL);
+  }
+  close(fd);
+
+  return new SourceBuffer(static_cast<char*>(base), size, length);
+}
+
+SourceBuffer *SourceBuffer::readStream(FILE *in) {
+  size_t capacity = 64 * 1024;
+  size_t size = 0;
+  char *data = static_cast<char*>(malloc(capacity));
+  if (!data) return nullptr;
+
+  for (;;) {
+    if (capacity - size < kSentinelSize + 1) {
+      char *grown = static_cast<char*>(realloc(data, capacity * 2));
+      if (!grown) {
+        free(data);
+        errno = ENOMEM;
+        return nullptr;
+      }
+      data = grown;
+      capacity *= 2;
+    }
+
+    size_t n = fread(data + size, 1, capacity - size - kSentinelSize, in);
+    size += n;
+    if (n == 0) {
+      if (ferror(in)) {
+        if (errno == EINTR) {
+          clearerr(in);
+          continue;
+        }
+        int saved = errno;
+        free(data);
+        errno = saved;
+        return nullptr;
+      }
+      break;
+    }
+  }
+
+  data[size] = data[size + 1] = '\0';
+  return new SourceBuffer(data, size, 0);
+}
+
+SourceBuffer::~SourceBuffer() {
+  if (mappedLength) {
+    munmap(data, mappedLength);
+  } else {
+    free(data);
+  }
+}
@@ -0,0 +1,55 @@
+//
+//  source_buffer.h
+//  nth
+//
+
+#ifndef __nth__source_buffer__
+#define __nth__source_buffer__
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+namespace nth {
+
+// The complete contents of an input file, mapped into memory and followed
+// by the two NUL bytes flex needs to scan a buffer in place (see
+// yy_scan_buffer). Mapping avoids reading the file through stdio and then
+// copying it again into the scanner's own buffer.
+class SourceBuffer {
+ public:
+  // Returns nullptr (with errno set) if the file cannot be opened or is not
+  // a regular file, e.g. a pipe or terminal, which cannot be mapped.
+  static SourceBuffer *mapFile(const std::string &path);
+
+  // Reads everything remaining in a stream that can't be mapped.
+  // Returns nullptr (with errno set) on a read error.
+  static SourceBuffer *readStream(FILE *in);
+
+  ~SourceBuffer();
+
+  // Start of the input. The mapping is private and writable because flex
+  // temporarily NUL-terminates each token it matches.
+  char *getBufferStart() { return data; }
+  size_t getBufferSize() { return size; }
+
+  // Size including the trailing sentinel bytes
+  size_t getScanSize() { return size + kSentinelSize; }
+
+  static const size_t kSentinelSize = 2;
+
+ protected:
+  SourceBuffer(char *data, size_t size, size_t mappedLength)
+    : data(data), size(size), mappedLength(mappedLength) {}
+
+  SourceBuffer(const SourceBuffer &) = delete;
+  SourceBuffer &operator=(const SourceBuffer &) = delete;
+
+  char *data;
+  size_t size;
+  size_t mappedLength; // zero when data was read onto the heap
+};
+
+}
+
+#endif /* defined(__nth__source_buffer__) */
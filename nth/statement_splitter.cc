@@ -0,0 +1,159 @@
+//
+//  statement_splitter.cc
+//  nth
+//
+
+#include <cstring>
+
+#include "statement_splitter.h"
+
+using namespace nth;
+
+namespace {
+
+inline bool isLetter(char c) { return (c | 0x20) >= 'a' && (c | 0x20) <= 'z'; }
+inline bool isIdentifierChar(char c) {
+  return isLetter(c) || (c >= '0' && c <= '9') || c == '_';
+}
+
+}
+
+const char *nth::skipSpaceAndComments(const char *p, const char *end) {
+  while (p < end) {
+    if (*p == ' ' || *p == '\t' || *p == '\n') {
+      ++p;
+    } else if (*p == '/' && p + 1 < end && p[1] == '/') {
+      const void *newline = memchr(p, '\n', end - p);
+      p = newline ? static_cast<const char *>(newline) : end;
+    } else if (*p == '/' && p + 1 < end && p[1] == '*') {
+      const char *q = p + 2;
+      while (q < end && !(*q == '*' && q + 1 < end && q[1] == '/')) ++q;
+      if (q == end) return p;
+      p = q + 2;
+    } else {
+      break;
+    }
+  }
+  return p;
+}
+
+bool nth::startsStatement(const char *p, const char *end) {
+  // A word other than else, a number, a string, a map or a prefix operator
+  p = skipSpaceAndComments(p, end);
+  if (p == end) return false;
+
+  if (isLetter(*p)) {
+    return end - p < 4 || memcmp(p, "else", 4) != 0 ||
+           (end - p > 4 && isIdentifierChar(p[4]));
+  }
+  if (*p & 0x80) return true; // an identifier, or an error either way
+
+  switch (*p) {
+    case '0': case '1': case '2': case '3': case '4':
+    case '5': case '6': case '7': case '8': case '9':
+    case '"':
+    case '{':
+    case '~':
+      return true;
+    case '!':
+      return p + 1 == end || p[1] != '=';
+    default:
+      return false;
+  }
+}
+
+std::vector<StatementGroup> nth::splitTopLevel(const char *begin, const char *end,
+                                               size_t count) {
+  std::vector<StatementGroup> groups(1, StatementGroup{begin, end, 1});
+  if (count < 2) return groups;
+
+  // What's left is shared evenly between the groups still to be made
+  const char *target = begin + (end - begin) / count;
+  int line = 1;
+  int depth = 0;                    // brackets open, in code
+  std::vector<int> interpolations;  // braces open in each #{...}, innermost last
+  bool inString = false;
+
+  const char *p = begin;
+  while (p < end) {
+    if (inString) {
+      // Text runs to the closing quote or the next #{
+      for (; p < end; ++p) {
+        if (*p == '\n') {
+          ++line;
+        } else if (*p == '\\') {
+          if (p + 1 < end && *++p == '\n') ++line;
+        } else if (*p == '"') {
+          ++p;
+          inString = false;
+          break;
+        } else if (*p == '#' && p + 1 < end && p[1] == '{') {
+          p += 2;
+          interpolations.push_back(0);
+          inString = false;
+          break;
+        }
+      }
+      continue;
+    }
+
+    switch (*p++) {
+      case '\n':
+        ++line;
+        if (p >= target && depth == 0 && interpolations.empty() && startsStatement(p, end)) {
+          groups.back().end = p;
+          groups.push_back(StatementGroup{p, end, line});
+          if (groups.size() == count) return groups;
+          target = p + (end - p) / (count - groups.size() + 1);
+        }
+        break;
+
+      case '/':
+        if (p < end && *p == '/') {
+          // The newline ending it is left to be seen above
+          const void *newline = memchr(p, '\n', end - p);
+          p = newline ? static_cast<const char *>(newline) : end;
+        } else if (p < end && *p == '*') {
+          for (++p; p < end && !(*p == '*' && p + 1 < end && p[1] == '/'); ++p) {
+            if (*p == '\n') ++line;
+          }
+          if (p < end) p += 2;
+        }
+        break;
+
+      case '"':
+        inString = true;
+        break;
+
+      case '(':
+      case '[':
+        ++depth;
+        break;
+      case ')':
+      case ']':
+        --depth;
+        break;
+
+      case '{':
+        if (!interpolations.empty()) ++interpolations.back();
+        ++depth;
+        break;
+      case '}':
+        if (!interpolations.empty()) {
+          if (interpolations.back() == 0) {
+            // Ends the interpolation; the string's text resumes
+            interpolations.pop_back();
+            inString = true;
+            break;
+          }
+          --interpolations.back();
+        }
+        --depth;
+        break;
+
+      default:
+        break;
+    }
+  }
+  return groups;
+}
@@ -0,0 +1,47 @@
+//
+//  statement_splitter.h
+//  nth
+//
+
+#ifndef __nth__statement_splitter__
+#define __nth__statement_splitter__
+
+#include <cstddef>
+#include <vector>
+
+namespace nth {
+
+// A run of whole top-level statements, starting at the beginning of the
+// given line
+struct StatementGroup {
+  const char *begin;
+  const char *end;
+  int line;
+};
+
+// Driver makes groups no smaller than this, as below it the threads cost
+// more than they save
+const size_t kMinimumStatementGroupSize = 256 * 1024;
+
+// Cuts [begin, end) into up to count groups of about the same size, each of
+// which can be parsed on its own. This is only a quick pass over the bytes,
+// not a scan: a cut is made at the start of a line outside any brackets,
+// comment or string, whose first token can begin a statement but not carry
+// on the one before it (so not an operator, "(", "[" or else).
+//
+// Statements aren't separated, so a cut can still land inside one that
+// runs over several lines; the groups either side of it then fail to
+// parse. The groups always cover the whole input, in order.
+std::vector<StatementGroup> splitTopLevel(const char *begin, const char *end, size_t count);
+
+// The first byte at or after p that isn't a blank, a newline or part of a
+// comment (an unfinished block comment is left in place)
+const char *skipSpaceAndComments(const char *p, const char *end);
+
+// Whether the first token at or after p can only begin a statement, by the
+// rule above
+bool startsStatement(const char *p, const char *end);
+
+}
+
+#endif /* defined(__nth__statement_splitter__) */
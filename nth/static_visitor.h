@@ -0,0 +1,171 @@
+//
+//  static_visitor.h
+//  nth
+//
+
+#ifndef __nth__static_visitor__
+#define __nth__static_visitor__
+
+#include "ast.h"
+#include "type_literal.h"
+
+namespace nth {
+
+// Visits nodes through a switch on their kind rather than through
+// accept(), for passes that can do without a virtual call per node.
+// Derived defines visitBlock(Block*), visitInteger(Integer*) and so on for
+// the kinds it cares about. Each such visit hides only the default of the
+// same name, and dispatch() calls it directly.
+//
+// The defaults dispatch on each child, in the order Visitor visits them.
+// Operators go on to visitBinaryOperation() or visitUnaryOperation(),
+// whose defaults do the same for the operands. A Derived that has to see
+// every node can define a dispatch() of its own, which calls this one.
+template <typename Derived>
+class StaticVisitor {
+ public:
+  void dispatch(ASTNode *node) {
+    switch (node->getKind()) {
+#define NODE(Class) \
+      case ASTNode::Kind::Class: \
+        return derived().visit##Class(static_cast<Class*>(node));
+#include "ast_nodes.def"
+    }
+  }
+
+  void visitDummyNode(DummyNode *dummy) {}
+
+  void visitBlock(Block *block) {
+    for (auto node : block->getNodes()) derived().dispatch(node);
+  }
+
+  void visitString(String *string) {}
+
+  void visitInterpolatedString(InterpolatedString *string) {
+    for (auto expr : string->getExpressions()) derived().dispatch(expr);
+  }
+
+  void visitInteger(Integer *integer) {}
+  void visitBigInteger(BigInteger *integer) {}
+  void visitFloat(Float *flt) {}
+  void visitTrue(True *tru) {}
+  void visitFalse(False *flse) {}
+  void visitIdentifier(Identifier *ident) {}
+
+  void visitArray(Array *array) {
+    for (auto value : array->getValues()) derived().dispatch(value);
+  }
+
+  void visitPackedArray(PackedArray *array) {}
+
+  void visitMap(Map *map) {
+    for (auto &keyValue : map->getValues()) {
+      derived().dispatch(keyValue.second);
+      derived().dispatch(keyValue.first);
+    }
+  }
+
+  void visitUnaryOperation(UnaryOperation *un_op) {
+    derived().dispatch(un_op->getValue().get());
+  }
+
+  void visitBinaryOperation(BinaryOperation *bin_op) {
+    derived().dispatch(bin_op->getLeftValue().get());
+    derived().dispatch(bin_op->getRightValue().get());
+  }
+
+#define UNARY(Class) \
+  void visit##Class(Class *un_op) { derived().visitUnaryOperation(un_op); }
+#define BINARY(Class) \
+  void visit##Class(Class *bin_op) { derived().visitBinaryOperation(bin_op); }
+  UNARY(BitwiseNot)
+  UNARY(LogicalNot)
+  BINARY(Add)
+  BINARY(Subtract)
+  BINARY(Multiply)
+  BINARY(Divide)
+  BINARY(Exponentiate)
+  BINARY(Modulo)
+  BINARY(BitShiftLeft)
+  BINARY(BitShiftRight)
+  BINARY(BitwiseOr)
+  BINARY(BitwiseAnd)
+  BINARY(LogicalOr)
+  BINARY(LogicalAnd)
+  BINARY(Comparison)
+  BINARY(Subscript)
+  BINARY(FieldAccess)
+  BINARY(TupleFieldAccess)
+#undef UNARY
+#undef BINARY
+
+  void visitRange(Range *range) {
+    derived().dispatch(range->getStart());
+    derived().dispatch(range->getEnd());
+  }
+
+  void visitTuple(Tuple *tuple) {
+    for (auto value : tuple->getValues()) derived().dispatch(value);
+  }
+
+  void visitFunctionDef(FunctionDef *functionDef) {
+    derived().dispatch(functionDef->getName());
+    for (auto typeParam : functionDef->getTypeParameters()) derived().dispatch(typeParam);
+    for (auto arg : functionDef->getArguments()) derived().dispatch(arg);
+    derived().dispatch(functionDef->getReturnType());
+    derived().dispatch(functionDef->getBlock());
+  }
+
+  void visitLambdaDef(LambdaDef *lambdaDef) {
+    for (auto arg : lambdaDef->getArguments()) derived().dispatch(arg);
+    derived().dispatch(lambdaDef->getReturnType());
+    derived().dispatch(lambdaDef->getBody());
+  }
+
+  void visitFunctionCall(FunctionCall *functionCall) {
+    derived().dispatch(functionCall->getCallable());
+    for (auto argExpr : functionCall->getArguments()) derived().dispatch(argExpr);
+  }
+
+  void visitVariableDef(VariableDef *variableDef) {
+    derived().dispatch(variableDef->getName());
+    derived().dispatch(variableDef->getVarType());
+    derived().dispatch(variableDef->getValue());
+  }
+
+  void visitArgument(Argument *argument) {
+    derived().dispatch(argument->getName());
+    derived().dispatch(argument->getType());
+  }
+
+  void visitIfElse(IfElse *ifElse) {
+    derived().dispatch(ifElse->getCond());
+    derived().dispatch(ifElse->getIfBlock());
+    if (ifElse->getElseBlock()) derived().dispatch(ifElse->getElseBlock());
+  }
+
+  void visitTypeAliasDef(TypeAliasDef *typeAliasDef) {
+    derived().dispatch(typeAliasDef->getLType());
+    derived().dispatch(typeAliasDef->getRType());
+  }
+
+  void visitSimpleTypeRef(SimpleTypeRef *type) { derived().dispatch(type->getName()); }
+  void visitSimpleTypeDef(SimpleTypeDef *type) { derived().dispatch(type->getName()); }
+
+  void visitTemplatedTypeRef(TemplatedTypeRef *type) {
+    derived().dispatch(type->getName());
+    for (auto subtype : type->getSubtypes()) derived().dispatch(subtype);
+  }
+
+  void visitTemplatedTypeDef(TemplatedTypeDef *type) {
+    derived().dispatch(type->getName());
+    for (auto subtype : type->getSubtypes()) derived().dispatch(subtype);
+  }
+
+ protected:
+  Derived &derived() { return *static_cast<Derived*>(this); }
+};
+
+}
+
+#endif /* defined(__nth__static_visitor__) */
@@ -0,0 +1,60 @@
+//
+//  string_escapes.h
+//  nth
+//
+
+#ifndef __nth__string_escapes__
+#define __nth__string_escapes__
+
+#include <string>
+
+namespace nth {
+
+// Escape sequences accepted in string literals. Sets decoded to the
+// character that c stands for after a backslash, or returns false if
+// that isn't a recognized escape.
+inline bool decodeEscape(char c, char &decoded) {
+  switch (c) {
+    case 'n': decoded = '\n'; return true;
+    case 't': decoded = '\t'; return true;
+    case 'r': decoded = '\r'; return true;
+    case '0': decoded = '\0'; return true;
+    case '\\':
+    case '"':
+    case '\'':
+    case '#':
+      decoded = c;
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Inverse of decodeEscape: renders text as it would appear between the
+// quotes of a literal
+inline std::string escapeString(const std::string &text) {
+  std::string escaped;
+  escaped.reserve(text.size());
+  for (size_t i = 0; i < text.size(); ++i) {
+    switch (text[i]) {
+      case '\n': escaped += "\\n"; break;
+      case '\t': escaped += "\\t"; break;
+      case '\r': escaped += "\\r"; break;
+      case '\0': escaped += "\\0"; break;
+      case '\\': escaped += "\\\\"; break;
+      case '"':  escaped += "\\\""; break;
+      case '#':
+        // Only where it would otherwise begin an interpolation
+        escaped += i + 1 < text.size() && text[i + 1] == '{' ? "\\#" : "#";
+        break;
+      default:
+        escaped += text[i];
+        break;
+    }
+  }
+  return escaped;
+}
+
+}
+
+#endif /* defined(__nth__string_escapes__) */
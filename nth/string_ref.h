@@ -0,0 +1,125 @@
+//
+//  string_ref.h
+//  nth
+//
+
+#ifndef __nth__string_ref__
+#define __nth__string_ref__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace nth {
+
+// A non-owning view of size bytes at data, used for token text so that
+// scanning doesn't allocate. Whoever hands one out guarantees the bytes
+// outlive it (see Driver::keepText); call str() for an owned copy.
+class StringRef {
+ public:
+  StringRef() : _data(""), _size(0) {}
+  StringRef(const char *data, size_t size) : _data(data), _size(size) {}
+  explicit StringRef(const std::string &s) : _data(s.data()), _size(s.size()) {}
+
+  const char *data() const { return _data; }
+  size_t size() const { return _size; }
+  bool empty() const { return _size == 0; }
+
+  const char *begin() const { return _data; }
+  const char *end() const { return _data + _size; }
+  char operator[](size_t i) const { return _data[i]; }
+
+  StringRef substr(size_t start, size_t n = std::string::npos) const {
+    if (start > _size) start = _size;
+    if (n > _size - start) n = _size - start;
+    return StringRef(_data + start, n);
+  }
+
+  std::string str() const { return std::string(_data, _size); }
+
+  bool operator==(const StringRef &other) const {
+    return _size == other._size && !memcmp(_data, other._data, _size);
+  }
+  bool operator!=(const StringRef &other) const { return !(*this == other); }
+  bool operator==(const char *s) const { return *this == StringRef(s, strlen(s)); }
+
+ private:
+  const char *_data;
+  size_t _size;
+};
+
+inline std::ostream &operator<<(std::ostream &os, const StringRef &s) {
+  return os.write(s.data(), s.size());
+}
+
+// Immutable text, NUL-terminated, in an allocation of its own that copies
+// share. The last copy to go frees it, whichever thread that's on.
+class SharedText {
+ public:
+  SharedText() : rep(nullptr) {}
+  explicit SharedText(StringRef text) {
+    if (text.size() > UINT32_MAX) throw std::length_error("text too long to share");
+    void *memory = malloc(sizeof(Rep) + text.size());
+    if (!memory) throw std::bad_alloc();
+    rep = new (memory) Rep(text.size());
+    memcpy(rep->text, text.data(), text.size());
+    rep->text[text.size()] = '\0';
+  }
+  SharedText(const SharedText &other) : rep(other.rep) {
+    if (rep) rep->refs.fetch_add(1, std::memory_order_relaxed);
+  }
+  SharedText(SharedText &&other) : rep(other.rep) { other.rep = nullptr; }
+  SharedText &operator=(SharedText other) {
+    std::swap(rep, other.rep);
+    return *this;
+  }
+  ~SharedText() {
+    if (rep && rep->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      rep->~Rep();
+      free(rep);
+    }
+  }
+
+  // False for a default-constructed SharedText, which has no text at all
+  explicit operator bool() const { return rep != nullptr; }
+
+  StringRef ref() const { return rep ? StringRef(rep->text, rep->size) : StringRef(); }
+  const char *c_str() const { return rep ? rep->text : ""; }
+
+  // Whether this is the only copy
+  bool unique() const { return rep && rep->refs.load(std::memory_order_acquire) == 1; }
+
+ private:
+  // Counts and sizes are 32 bits, so that short text fits the smallest of
+  // malloc's chunks
+  struct Rep {
+    explicit Rep(size_t size) : refs(1), size(static_cast<uint32_t>(size)) {}
+    std::atomic<uint32_t> refs;
+    uint32_t size;
+    char text[1];
+  };
+  Rep *rep;
+};
+
+// FNV-1a over the bytes, for keying hash tables on StringRef
+struct StringRefHash {
+  size_t operator()(const StringRef &s) const {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : s) {
+      hash ^= (unsigned char)c;
+      hash *= 1099511628211ull;
+    }
+    return (size_t)hash;
+  }
+};
+
+}
+
+#endif /* defined(__nth__string_ref__) */
@@ -3,44 +3,51 @@
 
 #include "symbol_table.h"
 #include "ast.h"
+#include "ast_context.h"
 
 using namespace nth;
 
-SymbolTable::SymbolTable() : parent(nullptr) {}
-SymbolTable::SymbolTable(SymbolTable *parent) : parent(parent) {}
+SymbolTable::SymbolTable() : parent(nullptr), context(nullptr) {}
+SymbolTable::SymbolTable(SymbolTable *parent, ASTContext *context)
+ : parent(parent), context(context) {}
 SymbolTable::SymbolTable(std::initializer_list<Identifier*> identifierList)
- : parent(nullptr) {
+ : parent(nullptr), context(nullptr) {
    for (auto ident : identifierList) {
      addSymbol(ident);
    }
 }
-SymbolTable *SymbolTable::beget() {
+SymbolTable *SymbolTable::beget(ASTContext *context) {
+  if (context) return context->make<SymbolTable>(this, context);
   return new SymbolTable(this);
 }
 
-Symbol *SymbolTable::findLocalSymbol(Identifier *ident) {
+Symbol *SymbolTable::findLocalSymbol(Name name) {
   for (auto it=scope.rbegin(); it != scope.rend(); ++it) {
-    if(**it == ident) return *it;
+    if(**it == name) return *it;
   }
   return nullptr;
 }
 
 Symbol *SymbolTable::findSymbol(Identifier *ident) {
-  if (Symbol *symbol = findLocalSymbol(ident)) {
+  return findSymbol(ident->getName());
+}
+
+Symbol *SymbolTable::findSymbol(Name name) {
+  if (Symbol *symbol = findLocalSymbol(name)) {
     return symbol;
   } else if (parent != nullptr) {
-    return parent->findSymbol(ident);
+    return parent->findSymbol(name);
   } else {
     return nullptr;
   }
 }
 
 Symbol *SymbolTable::findSymbol(std::string name) {
-  return findSymbol(new Identifier(name));
+  return findSymbol(Name(name));
 }
 
 bool SymbolTable::checkSymbol(Identifier *ident) {
-  if (findLocalSymbol(ident) != nullptr) {
+  if (findLocalSymbol(ident->getName()) != nullptr) {
     return true;
   }
   return false;
@@ -59,7 +66,7 @@ Symbol &SymbolTable::addSymbol(Identifier *ident) {
     throw std::runtime_error(ident->getValue() + " is already defined in this scope");
   }
 
-  Symbol *symbol = new Symbol(ident);
+  Symbol *symbol = context ? context->make<Symbol>(ident) : new Symbol(ident);
   scope.push_back(symbol);
   return *symbol;
 }
@@ -95,7 +102,7 @@ std::list<SymbolTable*> SymbolTable::getScopes() {
 // Symbol method definitions
 // -------------------------
 
-Symbol::Symbol(Identifier *ident) : name(ident->getValue()) {}
+Symbol::Symbol(Identifier *ident) : name(ident->getName()) {}
 
 void Symbol::setType(Type &type) {
   _type = &type;
@@ -108,13 +115,13 @@ bool Symbol::operator==(Symbol &rhs) {
 }
 
 bool Symbol::operator==(Identifier *ident) {
-  return name == ident->getValue();
+  return name == ident->getName();
 }
 
 bool Symbol::operator==(std::string str) {
-  return name == str;
+  return name == StringRef(str);
 }
 
 bool Symbol::operator==(const char *str) {
-  return name == str;
+  return name == StringRef(str, strlen(str));
 }
@@ -5,8 +5,11 @@
 #include <string>
 #include <list>
 
+#include "name.h"
+
 namespace nth {
 
+  class ASTContext;
   class Symbol;
   class Identifier;
   class Type;
@@ -14,15 +17,20 @@ namespace nth {
   class SymbolTable {
   public:
     SymbolTable();
-    SymbolTable(SymbolTable *parent);
+    SymbolTable(SymbolTable *parent, ASTContext *context = nullptr);
     SymbolTable(std::initializer_list<Identifier*> identifierList);
-    // Return new child table
-    SymbolTable *beget();
+    // Return new child table, made in context if one is given, where it
+    // and its symbols last as long as the context does
+    SymbolTable *beget(ASTContext *context = nullptr);
 
     // Search this scope and parents for this identifier
     Symbol *findSymbol(Identifier *ident);
+    Symbol *findSymbol(Name name);
     Symbol *findSymbol(std::string name);
-    
+    // Search this scope only
+    Symbol *findLocalSymbol(Name name);
+    SymbolTable *getParent() { return parent; }
+
     Symbol &addSymbol(Identifier *ident);
     Symbol &addSymbol(Identifier *ident, Type &type);
 
@@ -34,8 +42,8 @@ namespace nth {
   protected:
     std::deque<nth::Symbol*> scope;
 
-    Symbol *findLocalSymbol(Identifier *ident);
     SymbolTable *parent;
+    ASTContext *context; // where symbols are made, if not on the heap
 
   };
 
@@ -46,12 +54,14 @@ namespace nth {
     Type *getType();
     bool operator==(Symbol &rhs);
     bool operator==(Identifier *ident);
+    bool operator==(Name other) { return name == other; }
     bool operator==(std::string str);
     bool operator==(const char *str);
-    operator std::string() const { return name; }
+    operator std::string() const { return name.str(); }
     operator const char *() const { return name.c_str(); }
+    Name getName() const { return name; }
   protected:
-    std::string name;
+    Name name;
     Type *_type;
   };
   
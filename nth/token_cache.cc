@@ -0,0 +1,287 @@
+//
+//  token_cache.cc
+//  nth
+//
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "token_cache.h"
+
+using namespace nth;
+
+namespace {
+
+const char kMagic[4] = { 'N', 'T', 'O', 'K' };
+
+// magic, format, source hash, source size, stream size, stream checksum
+const size_t kHeaderSize = 4 + 8 * 5;
+
+const uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+const uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+
+inline uint64_t rotateLeft(uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+// Token kinds are the parser's symbol numbers, which shift whenever a
+// token is added to the grammar. Tying the format to the token names
+// retires every old cache when that happens.
+uint64_t formatFingerprint() {
+  static const uint64_t fingerprint = []() {
+    std::string names = "ntok 1";
+    for (int kind = 0; kind < yy::parser::YYNTOKENS; ++kind) {
+      names += '\0';
+      names += yy::parser::symbol_name(static_cast<yy::parser::symbol_kind_type>(kind));
+    }
+    return hashSource(names.data(), names.size());
+  }();
+  return fingerprint;
+}
+
+void putFixed64(std::string &out, uint64_t value) {
+  for (int i = 0; i < 8; ++i) {
+    out += static_cast<char>(value >> (8 * i));
+  }
+}
+
+uint64_t getFixed64(const char *in) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; ++i) {
+    value |= static_cast<uint64_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+  }
+  return value;
+}
+
+void putVarint(std::string &out, uint64_t value) {
+  while (value >= 0x80) {
+    out += static_cast<char>(value | 0x80);
+    value >>= 7;
+  }
+  out += static_cast<char>(value);
+}
+
+// Zigzag encoding keeps small negative numbers short
+void putSignedVarint(std::string &out, int64_t value) {
+  putVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+bool isStringKind(int kind) {
+  switch (kind) {
+    case yy::parser::symbol_kind::S_STRING:
+    case yy::parser::symbol_kind::S_STRING_HEAD:
+    case yy::parser::symbol_kind::S_STRING_MID:
+    case yy::parser::symbol_kind::S_STRING_TAIL:
+    case yy::parser::symbol_kind::S_IDENT:
+    case yy::parser::symbol_kind::S_BIGINT:
+      return true;
+    default:
+      return false;
+  }
+}
+
+}
+
+namespace nth {
+
+uint64_t hashSource(const char *data, size_t size) {
+  // One 64-bit lane in the style of xxHash: fast enough that hashing a
+  // file costs a small fraction of scanning it
+  uint64_t h = size * kPrime1;
+  const char *p = data;
+  for (const char *stop = data + size / 8 * 8; p != stop; p += 8) {
+    uint64_t word;
+    memcpy(&word, p, 8);
+    h = rotateLeft(h ^ (word * kPrime2), 31) * kPrime1;
+  }
+  if (size % 8) {
+    uint64_t word = 0;
+    memcpy(&word, p, size % 8);
+    h = rotateLeft(h ^ (word * kPrime2), 31) * kPrime1;
+  }
+
+  h ^= h >> 33;
+  h *= kPrime2;
+  h ^= h >> 29;
+  h *= kPrime1;
+  h ^= h >> 32;
+  return h;
+}
+
+std::string tokenCachePath(const std::string &dir, uint64_t hash) {
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.ntok", static_cast<unsigned long long>(hash));
+  return dir + "/" + name;
+}
+
+}
+
+TokenCacheWriter::TokenCacheWriter(const std::string &path, uint64_t hash,
+                                   size_t sourceSize)
+  : path(path), hash(hash), sourceSize(sourceSize) {
+  // Records are seldom longer than the text they were scanned from
+  stream.reserve(sourceSize + sourceSize / 4);
+}
+
+void TokenCacheWriter::record(const yy::parser::symbol_type &symbol) {
+  int kind = symbol.kind();
+  stream += static_cast<char>(kind);
+
+  const yy::location &loc = symbol.location;
+  putSignedVarint(stream, loc.begin.line - last.line);
+  putSignedVarint(stream, loc.begin.column - last.column);
+  putSignedVarint(stream, loc.end.line - loc.begin.line);
+  putSignedVarint(stream, loc.end.column - loc.begin.column);
+  last = loc.end;
+
+  if (isStringKind(kind)) {
+    const StringRef &text = symbol.value.as<StringRef>();
+    putVarint(stream, text.size());
+    stream.append(text.data(), text.size());
+    return;
+  }
+
+  switch (kind) {
+    case yy::parser::symbol_kind::S_INT:
+      putSignedVarint(stream, symbol.value.as<long>());
+      break;
+    case yy::parser::symbol_kind::S_FLOAT: {
+      uint64_t bits;
+      double value = symbol.value.as<double>();
+      memcpy(&bits, &value, sizeof(bits));
+      putFixed64(stream, bits);
+      break;
+    }
+    case yy::parser::symbol_kind::S_CMP:
+      putVarint(stream, static_cast<uint64_t>(symbol.value.as<Comparison::Type>()));
+      break;
+    default:
+      break;
+  }
+}
+
+bool TokenCacheWriter::commit() {
+  std::string header(kMagic, sizeof(kMagic));
+  putFixed64(header, formatFingerprint());
+  putFixed64(header, hash);
+  putFixed64(header, sourceSize);
+  putFixed64(header, stream.size());
+  putFixed64(header, hashSource(stream.data(), stream.size()));
+
+  std::string temp = path + ".XXXXXX";
+  int fd = mkstemp(&temp[0]);
+  if (fd < 0 && errno == ENOENT) {
+    // Create the cache directory on first use
+    std::string dir = path.substr(0, path.rfind('/'));
+    if (mkdir(dir.c_str(), 0777) < 0 && errno != EEXIST) return false;
+    temp = path + ".XXXXXX";
+    fd = mkstemp(&temp[0]);
+  }
+  if (fd < 0) return false;
+
+  FILE *out = fdopen(fd, "w");
+  if (!out) {
+    int saved = errno;
+    close(fd);
+    unlink(temp.c_str());
+    errno = saved;
+    return false;
+  }
+
+  bool written = fwrite(header.data(), 1, header.size(), out) == header.size() &&
+                 fwrite(stream.data(), 1, stream.size(), out) == stream.size();
+  int saved = errno;
+  if (fclose(out) != 0 && written) {
+    written = false;
+    saved = errno;
+  }
+  if (written && rename(temp.c_str(), path.c_str()) == 0) {
+    return true;
+  }
+  if (written) saved = errno;
+
+  unlink(temp.c_str());
+  errno = saved;
+  return false;
+}
+
+TokenCacheReader *TokenCacheReader::open(const std::string &path, uint64_t hash,
+                                         size_t sourceSize) {
+  std::unique_ptr<SourceBuffer> file(SourceBuffer::mapFile(path));
+  if (!file || file->getBufferSize() < kHeaderSize) return nullptr;
+
+  const char *data = file->getBufferStart();
+  uint64_t streamSize = getFixed64(data + 28);
+  const char *stream = data + kHeaderSize;
+  if (memcmp(data, kMagic, sizeof(kMagic)) != 0 ||
+      getFixed64(data + 4) != formatFingerprint() ||
+      getFixed64(data + 12) != hash ||
+      getFixed64(data + 20) != sourceSize ||
+      streamSize != file->getBufferSize() - kHeaderSize ||
+      getFixed64(data + 36) != hashSource(stream, streamSize)) {
+    return nullptr;
+  }
+
+  return new TokenCacheReader(file.release(), stream, stream + streamSize);
+}
+
+uint64_t TokenCacheReader::readVarint() {
+  uint64_t value = 0;
+  for (int shift = 0; cursor != end && shift < 64; shift += 7) {
+    unsigned char byte = *cursor++;
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) break;
+  }
+  return value;
+}
+
+int64_t TokenCacheReader::readSignedVarint() {
+  uint64_t value = readVarint();
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+yy::parser::symbol_type TokenCacheReader::next(yy::location &loc) {
+  if (cursor == end) {
+    loc.step();
+    return yy::parser::make_END(loc);
+  }
+
+  int kind = static_cast<unsigned char>(*cursor++);
+  loc.begin.line = last.line + readSignedVarint();
+  loc.begin.column = last.column + readSignedVarint();
+  loc.end.line = loc.begin.line + readSignedVarint();
+  loc.end.column = loc.begin.column + readSignedVarint();
+  last = loc.end;
+
+  if (isStringKind(kind)) {
+    size_t size = readVarint();
+    if (size > static_cast<size_t>(end - cursor)) {
+      size = end - cursor;
+    }
+    StringRef text(cursor, size);
+    cursor += size;
+    return yy::parser::symbol_type(kind, text, loc);
+  }
+
+  switch (kind) {
+    case yy::parser::symbol_kind::S_INT:
+      return yy::parser::symbol_type(kind, static_cast<long>(readSignedVarint()), loc);
+    case yy::parser::symbol_kind::S_FLOAT: {
+      double value = 0;
+      if (end - cursor >= 8) {
+        uint64_t bits = getFixed64(cursor);
+        memcpy(&value, &bits, sizeof(value));
+        cursor += 8;
+      }
+      return yy::parser::symbol_type(kind, value, loc);
+    }
+    case yy::parser::symbol_kind::S_CMP:
+      return yy::parser::symbol_type(
+        kind, static_cast<Comparison::Type>(readVarint()), loc);
+    default:
+      return yy::parser::symbol_type(kind, loc);
+  }
+}
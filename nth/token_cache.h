@@ -0,0 +1,83 @@
+//
+//  token_cache.h
+//  nth
+//
+
+#ifndef __nth__token_cache__
+#define __nth__token_cache__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "parse.hh"
+#include "source_buffer.h"
+
+namespace nth {
+
+// Token streams are saved between runs in .ntok files named for a hash of
+// the source they were scanned from, so that a file which hasn't changed
+// can be parsed without being scanned again.
+//
+// A cache file is a fixed header (magic, format version, source hash and
+// size, and a checksum of what follows) and then one record per token: its
+// kind, its location as deltas from the previous token, and its decoded
+// value if it has one. Integers are little-endian or varints, so files can
+// be shared between machines.
+
+// Hash of size bytes at data, used to name and validate cache files
+uint64_t hashSource(const char *data, size_t size);
+
+// Path of the cache file for source with this hash
+std::string tokenCachePath(const std::string &dir, uint64_t hash);
+
+// Accumulates the tokens of one scan in memory and writes them out once
+// the scan has reached the end of its input
+class TokenCacheWriter {
+ public:
+  TokenCacheWriter(const std::string &path, uint64_t hash, size_t sourceSize);
+
+  void record(const yy::parser::symbol_type &symbol);
+
+  // Writes a temporary file and renames it into place, so that other
+  // processes never see a partly written cache. Returns false with errno
+  // set on failure.
+  bool commit();
+
+ protected:
+  std::string path;
+  uint64_t hash;
+  uint64_t sourceSize;
+  std::string stream;
+  yy::position last; // end of the previous token
+};
+
+// Replays a stream saved by TokenCacheWriter. String values are views into
+// the mapped cache file and stay valid as long as the reader.
+class TokenCacheReader {
+ public:
+  // Returns nullptr if there is no cache file for this source, or if the
+  // one there is stale, truncated or otherwise doesn't check out.
+  static TokenCacheReader *open(const std::string &path, uint64_t hash,
+                                size_t sourceSize);
+
+  // Next token, with its location also stored in loc (as the scanners do
+  // with Driver::location). Returns END once the stream is exhausted.
+  yy::parser::symbol_type next(yy::location &loc);
+
+ protected:
+  TokenCacheReader(SourceBuffer *file, const char *begin, const char *end)
+    : file(file), cursor(begin), end(end) {}
+
+  uint64_t readVarint();
+  int64_t readSignedVarint();
+
+  std::unique_ptr<SourceBuffer> file;
+  const char *cursor;
+  const char *end;
+  yy::position last;
+};
+
+}
+
+#endif /* defined(__nth__token_cache__) */
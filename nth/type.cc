@@ -6,8 +6,8 @@
 
 using namespace nth;
 
-Type::Type(Identifier *name, VariableSet variables, MethodSet methods, Type *parent)
-: name(name), variables(variables), methods(methods), parent(parent) {}
+Type::Type(Kind kind, Identifier *name, VariableSet variables, MethodSet methods, Type *parent)
+: kind(kind), name(name), variables(variables), methods(methods), parent(parent) {}
 
 bool Type::operator==(Type &rhs) {
   return *this == &rhs;
@@ -67,20 +67,19 @@ Type *Type::objectType() {
   return _objectType;
 }
 
-Type *Type::findMethodReturnTypeForArgs(std::string methodSymbolName, std::list<Type*> args) {
+Type *Type::findMethodReturnTypeForArgs(Name methodName, std::list<Type*> args) {
+  Name expectedFunctionTypeName = Identifier::templatedTypeName("Function", args.size());
   for (auto &method : methods) {
     // look for named symbol with type Function1[T1, R]
     // sepcialize that type into Function1[rightType, R]
     // that accepts a single argument of type right->getType()
 
     // TODO: clean this up
-    if(*method == methodSymbolName) {
+    if(*method == methodName) {
       FunctionType *methodType;
 
-      if ((methodType = dynamic_cast<FunctionType*>(method->getType()))) {
-        Identifier *expectedFunctionTypeName = Identifier::forTemplatedType("Function", args.size());
-
-        if (*methodType->getName() == *expectedFunctionTypeName) {
+      if ((methodType = dyn_cast_or_null<FunctionType>(method->getType()))) {
+        if (methodType->getName()->getName() == expectedFunctionTypeName) {
 
 //          auto subtypes = methodType->getSubtypes();
 //          Type *returnType = subtypes.back();
@@ -110,15 +109,17 @@ Type *Type::findMethodReturnTypeForArgs(std::string methodSymbolName, std::list<
 
   // no matches yet? try the parent type
   if (parent) {
-    return parent->findMethodReturnTypeForArgs(methodSymbolName, args);
+    return parent->findMethodReturnTypeForArgs(methodName, args);
   }
   // TODO: actually save this Error and output to cout
   // instead of throwing exception
   throw "type checker: no method found with specified arguments";
 }
 
-TemplatedType *TemplatedType::specialize(TypeList subtypes) {
-  auto type = new TemplatedType(getName(), variables, methods, getParent(), subtypes);
+TemplatedType *TemplatedType::specialize(TypeList subtypes, ASTContext *context) {
+  auto type = context
+    ? context->make<TemplatedType>(getName(), variables, methods, getParent(), subtypes)
+    : new TemplatedType(getName(), variables, methods, getParent(), subtypes);
   type->specialized = true;
   return type;
 }
@@ -130,6 +131,7 @@ TypeList FunctionType::concat_ctr_args(TypeList argList, Type *returnType) {
 
 FunctionType::FunctionType(TypeList argTypes, Type *returnType)
 : TemplatedType(
+    Kind::Function,
     Identifier::forTemplatedType("Function", argTypes.size()),
     VariableSet(),
     MethodSet(),
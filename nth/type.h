@@ -15,7 +15,13 @@ typedef std::set<Symbol*> MethodSet;
 // parser
 class Type {
  public:
-  Type(Identifier *name, VariableSet variables, MethodSet methods, Type *parent);
+  // The class of type, for isa<> and dyn_cast<>
+  enum class Kind : uint8_t { Simple, Templated, Function };
+
+  Type(Kind kind, Identifier *name, VariableSet variables, MethodSet methods, Type *parent);
+
+  Kind getKind() const { return kind; }
+  static bool classof(const Type *type) { return true; }
 
   // TODO: define operators that allow comparison of parent/child types
   virtual bool operator==(Type &rhs);
@@ -32,11 +38,12 @@ class Type {
   MethodSet &getMethods() { return methods; }
 
   // recursively find method that matches signature required by arg types
-  Type *findMethodReturnTypeForArgs(std::string methodSymbolName, std::list<Type*> args);
+  Type *findMethodReturnTypeForArgs(Name methodName, std::list<Type*> args);
 
   virtual ~Type() {}
 
  protected:
+  Kind kind;
   bool concrete=true; // TODO: use this
   Identifier *name;
   Type *parent;
@@ -50,7 +57,9 @@ class Type {
 class SimpleType : public Type {
  public:
   SimpleType(Identifier *name, VariableSet variables, MethodSet methods, Type* parent)
-   : Type(name, variables, methods, parent) {}
+   : Type(Kind::Simple, name, variables, methods, parent) {}
+
+  static bool classof(const Type *type) { return type->getKind() == Kind::Simple; }
 
   ~SimpleType() {}
 };
@@ -59,14 +68,23 @@ class SimpleType : public Type {
 class TemplatedType : public Type {
  public:
   TemplatedType(Identifier *name, VariableSet variables, MethodSet methods, Type *parent, TypeList subtypes)
-   : Type(name, variables, methods, parent), _subtypes(subtypes) {}
+   : TemplatedType(Kind::Templated, name, variables, methods, parent, subtypes) {}
 
-  // List[A] -> List[Int]
-  TemplatedType *specialize(TypeList subtypes);
+  // FunctionTypes are TemplatedTypes too
+  static bool classof(const Type *type) {
+    return type->getKind() == Kind::Templated || type->getKind() == Kind::Function;
+  }
+
+  // List[A] -> List[Int], made in context if one is given
+  TemplatedType *specialize(TypeList subtypes, ASTContext *context = nullptr);
   TypeList getSubtypes() { return _subtypes; }
   
   ~TemplatedType() {}
  protected:
+  TemplatedType(Kind kind, Identifier *name, VariableSet variables, MethodSet methods,
+                Type *parent, TypeList subtypes)
+   : Type(kind, name, variables, methods, parent), _subtypes(subtypes) {}
+
   VariableSet variables;
   MethodSet methods;
   TypeList _subtypes; // TODO: describe subtype relationships more fully
@@ -77,6 +95,8 @@ class FunctionType : public TemplatedType {
  public:
   // TODO: functions as objects have methods (namely, apply())
   FunctionType(TypeList argTypes, Type *returnType);
+
+  static bool classof(const Type *type) { return type->getKind() == Kind::Function; }
   TypeList concat_ctr_args(TypeList argList, Type *returnType);
 
   TypeList getArgTypes();
@@ -14,17 +14,65 @@
 
 using namespace nth;
 
-void TypeChecker::setTypeForString(Expression *node, std::string typeName) {
-  Symbol *symbol = node->getNearestSymbolTable()->findSymbol(typeName);
-  if (!symbol) throw std::string("type checker: unable to find symbol for '") + typeName + "'";
+namespace {
+
+// The built-in types the checker looks up, interned once
+const Name kObject("Object"), kString("String"), kInteger("Integer"),
+  kFloat("Float"), kBoolean("Boolean"), kArray("Array"), kMap("Map"),
+  kInt("Int"), kRange("Range");
+
+}
+
+TypeChecker::ScopeGuard::ScopeGuard(TypeChecker &checker, SymbolTable *table)
+  : checker(checker), entered(table != nullptr) {
+  if (entered) checker.scopes.push_back(Scope{ table, {} });
+}
+
+TypeChecker::ScopeGuard::~ScopeGuard() {
+  if (entered) checker.scopes.pop_back();
+}
+
+Symbol *TypeChecker::findSymbol(ASTNode *node, Name name) {
+  // Checking that began below every scope the checker knows of
+  if (scopes.empty()) return node->getNearestSymbolTable()->findSymbol(name);
+
+  // Out from the innermost scope, through any tables between each one and
+  // the next, until some scope either has the name or has found it before
+  Symbol *symbol = nullptr;
+  size_t i = scopes.size();
+  while (!symbol && i > 0) {
+    Scope &scope = scopes[--i];
+    auto found = scope.found.find(name);
+    if (found != scope.found.end()) {
+      symbol = found->second;
+      break;
+    }
+    SymbolTable *outer = i > 0 ? scopes[i - 1].table : nullptr;
+    for (SymbolTable *table = scope.table; table && table != outer && !symbol;
+         table = table->getParent()) {
+      symbol = table->findLocalSymbol(name);
+    }
+  }
+  if (!symbol) return nullptr;
+
+  for (; i < scopes.size(); i++) scopes[i].found[name] = symbol;
+  return symbol;
+}
+
+void TypeChecker::setTypeForString(Expression *node, Name typeName) {
+  Symbol *symbol = findSymbol(node, typeName);
+  if (!symbol) throw std::string("type checker: unable to find symbol for '") + typeName.str() + "'";
   node->setType(symbol->getType());
 }
 
 void TypeChecker::visit(Block *block) {
-  SymbolTable *table = block->getNearestSymbolTable();
-  if (!table) throw "type checker: no symbol table found";
+  // A block without a table of its own is in the scope around it, which
+  // is looked for once if checking begins here
+  SymbolTable *table = block->getSymbolTable();
+  if (!table && scopes.empty()) table = block->getNearestSymbolTable();
+  ScopeGuard guard(*this, table);
 
-  Symbol *sym = table->findSymbol("Object");
+  Symbol *sym = findSymbol(block, kObject);
   if (!sym) throw "type checker: no symbol named Object found";
   
   Type *lastExprType = sym->getType();
@@ -34,7 +82,7 @@ void TypeChecker::visit(Block *block) {
   for (auto node : block->getNodes()) {
     node->accept(*this);
     Expression *possibleExpr;
-    if ((possibleExpr = dynamic_cast<Expression*>(node))) {
+    if ((possibleExpr = dyn_cast<Expression>(node))) {
       lastExprType = possibleExpr->getType();
     }
   }
@@ -42,23 +90,34 @@ void TypeChecker::visit(Block *block) {
   block->setType(lastExprType);
 }
 void TypeChecker::visit(String *string) {
-  setTypeForString(string, "String");
+  setTypeForString(string, kString);
+}
+
+void TypeChecker::visit(InterpolatedString *string) {
+  for (auto expr : string->getExpressions()) {
+    expr->accept(*this);
+  }
+  setTypeForString(string, kString);
 }
 
 void TypeChecker::visit(Integer *integer) {
-  setTypeForString(integer, "Integer");
+  setTypeForString(integer, kInteger);
+}
+
+void TypeChecker::visit(BigInteger *integer) {
+  setTypeForString(integer, kInteger);
 }
 
 void TypeChecker::visit(Float *flt) {
-  setTypeForString(flt, "Float");
+  setTypeForString(flt, kFloat);
 }
 
 void TypeChecker::visit(True *tru) {
-  setTypeForString(tru, "Boolean");
+  setTypeForString(tru, kBoolean);
 }
 
 void TypeChecker::visit(False *flse) {
-  setTypeForString(flse, "Boolean");
+  setTypeForString(flse, kBoolean);
 }
 
 void TypeChecker::visit(Identifier *ident) {
@@ -72,10 +131,27 @@ void TypeChecker::visit(Array *array) {
   }
   Type *lubType = Type::computeLUB(arrayElementTypes);
 
-  Symbol *arraySym = array->getNearestSymbolTable()->findSymbol(new Identifier("Array"));
+  Symbol *arraySym = findSymbol(array, kArray);
+
+  TemplatedType *arrayType = cast<TemplatedType>(arraySym->getType());
+  TemplatedType *specializedType = arrayType->specialize({ lubType }, array->getContext());
+
+  array->setType(specializedType);
+}
+
+void TypeChecker::visit(PackedArray *array) {
+  // Every element is a literal of the same kind, whose type is looked up
+  // as the array's own to begin with
+  switch (array->getValues().getKind()) {
+    case PackedValues::Kind::Integer: setTypeForString(array, kInteger); break;
+    case PackedValues::Kind::Float: setTypeForString(array, kFloat); break;
+    default: setTypeForString(array, kString); break;
+  }
+
+  Symbol *arraySym = findSymbol(array, kArray);
 
-  TemplatedType *arrayType = dynamic_cast<TemplatedType*>(arraySym->getType());
-  TemplatedType *specializedType = arrayType->specialize({ lubType });
+  TemplatedType *arrayType = cast<TemplatedType>(arraySym->getType());
+  TemplatedType *specializedType = arrayType->specialize({ array->getType() }, array->getContext());
 
   array->setType(specializedType);
 }
@@ -92,10 +168,10 @@ void TypeChecker::visit(Map *map) {
   Type *keyLUBType = Type::computeLUB(mapKeyTypes);
   Type *valueLUBType = Type::computeLUB(mapValueTypes);
 
-  Symbol *mapSym = map->getNearestSymbolTable()->findSymbol(new Identifier("Map"));
+  Symbol *mapSym = findSymbol(map, kMap);
 
-  TemplatedType *mapType = dynamic_cast<TemplatedType*>(mapSym->getType());
-  TemplatedType *specializedType = mapType->specialize({ keyLUBType, valueLUBType });
+  TemplatedType *mapType = cast<TemplatedType>(mapSym->getType());
+  TemplatedType *specializedType = mapType->specialize({ keyLUBType, valueLUBType }, map->getContext());
 
   map->setType(specializedType);
 }
@@ -107,7 +183,7 @@ void TypeChecker::checkBinaryOp(BinaryOperation *bin_op, std::string symbolName)
   left->accept(*this);
   right->accept(*this);
 
-  Type *returnType = left->getType()->findMethodReturnTypeForArgs("+", { right->getType() });
+  Type *returnType = left->getType()->findMethodReturnTypeForArgs(Name("+"), { right->getType() });
   bin_op->setType(returnType);
 }
 
@@ -117,10 +193,11 @@ void TypeChecker::checkUnaryOp(UnaryOperation *un_op, std::string symbolName) {
   value->accept(*this);
 
   // TODO: raise appropriate errors here
+  Name bang("!");
   for(auto method : value->getType()->getMethods()) {
-    if(*method == "!") {
+    if(*method == bang) {
       TemplatedType *methodType;
-      if ((methodType = dynamic_cast<TemplatedType*>(method->getType()))) {
+      if ((methodType = dyn_cast_or_null<TemplatedType>(method->getType()))) {
         if (*methodType->getName() == "Function0") {
           if (methodType->getSubtypes().size() == 1) {
             Type *returnType = methodType->getSubtypes().back();
@@ -181,13 +258,13 @@ void TypeChecker::visit(Range *range) {
   Type *startType = range->getStart()->getType();
   Type *endType = range->getEnd()->getType();
 
-  Type *intType = range->getNearestSymbolTable()->findSymbol("Int")->getType();
+  Type *intType = findSymbol(range, kInt)->getType();
 
   if (*startType != intType || *endType != intType) {
     throw "type checker: range with invalid types";
   }
 
-  Symbol *rangeSymbol = range->getNearestSymbolTable()->findSymbol("Range");
+  Symbol *rangeSymbol = findSymbol(range, kRange);
   if (!rangeSymbol)
     throw "type checker: Range symbol not found";
 
@@ -216,11 +293,11 @@ void TypeChecker::visit(FunctionCall *functionCall) {
   // specified by FunctionN[T0, T1, ... TN-1, R]
 
   TemplatedType *callableFunctionType;
-  Identifier *expectedFunctionTypeName =
-    Identifier::forTemplatedType("Function", functionCall->getArguments().size());
+  Name expectedFunctionTypeName =
+    Identifier::templatedTypeName("Function", functionCall->getArguments().size());
 
-  if ((callableFunctionType = dynamic_cast<TemplatedType*>(callableExprType))) {
-    if (*callableFunctionType->getName() == *expectedFunctionTypeName) {
+  if ((callableFunctionType = dyn_cast_or_null<TemplatedType>(callableExprType))) {
+    if (callableFunctionType->getName()->getName() == expectedFunctionTypeName) {
       Type *returnType = callableFunctionType->getSubtypes().back();
       functionCall->setType(returnType);
     }
@@ -239,7 +316,7 @@ void TypeChecker::visit(IfElse *ifElse) {
 
   // Check that if conditional expression evaluates to a boolean
   Type *condType = condExpr->getType();
-  Symbol *boolSymbol = ifElse->getNearestSymbolTable()->findSymbol("Boolean");
+  Symbol *boolSymbol = findSymbol(ifElse, kBoolean);
 
   if (condType != boolSymbol->getType()) {
     throw "type checker: condition is not a boolean";
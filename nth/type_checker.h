@@ -10,25 +10,36 @@
 #define __nth__type_checker__
 
 #include <stdio.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include "ast_visitor.h"
+#include "name.h"
 
 // Takes an alterantive approach to the visitor pattern
 // An experiment to see if that makes sending information
 // up and down the tree easier
 namespace nth {
 
+class ASTNode;
 class Expression;
+class Symbol;
+class SymbolTable;
 
 class TypeChecker : public Visitor {
  public:
   virtual void visit(Block *block);
   virtual void visit(String *string);
+  virtual void visit(InterpolatedString *string);
   virtual void visit(Integer *integer);
+  virtual void visit(BigInteger *integer);
   virtual void visit(Float *flt);
   virtual void visit(True *tru);
   virtual void visit(False *flse);
   virtual void visit(Identifier *ident);
   virtual void visit(Array *array);
+  virtual void visit(PackedArray *array);
   virtual void visit(Map *map);
   virtual void visit(BinaryOperation *bin_op);
   virtual void visit(UnaryOperation *un_op);
@@ -66,9 +77,32 @@ class TypeChecker : public Visitor {
   virtual void visit(TypeAliasDef *typeAliasDef);
 
  private:
-  void setTypeForString(Expression *node, std::string typeName);
+  // A scope that the checker is inside, with the symbols found from it so far
+  struct Scope {
+    SymbolTable *table;
+    std::unordered_map<Name, Symbol*, NameHash> found;
+  };
+
+  // Enters a block's own scope, if it has one, for as long as it lives
+  class ScopeGuard {
+   public:
+    ScopeGuard(TypeChecker &checker, SymbolTable *table);
+    ~ScopeGuard();
+   private:
+    TypeChecker &checker;
+    bool entered;
+  };
+
+  // What name refers to where node is. The checker carries its scope down
+  // the tree rather than walking up from every node, and remembers what it
+  // finds, so that the cost doesn't grow with how deeply node is nested.
+  Symbol *findSymbol(ASTNode *node, Name name);
+
+  void setTypeForString(Expression *node, Name typeName);
   void checkBinaryOp(BinaryOperation *bin_op, std::string symbolName);
   void checkUnaryOp(UnaryOperation *un_op, std::string symbolName);
+
+  std::vector<Scope> scopes; // innermost last
 };
 
 }
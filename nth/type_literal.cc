@@ -10,7 +10,18 @@
 
 using namespace nth;
 
-TypeRefList FunctionTypeRef::concat_ctr_args(TypeRefList argList, TypeRef *returnType) {
-  argList.push_back(returnType);
-  return argList;
-}
\ No newline at end of file
+TypeLiteral::~TypeLiteral() {
+  delete name;
+}
+
+TemplatedTypeRef::~TemplatedTypeRef() {
+  for (auto subtype : subtypes) {
+    delete subtype;
+  }
+}
+
+TemplatedTypeDef::~TemplatedTypeDef() {
+  for (auto subtype : subtypes) {
+    delete subtype;
+  }
+}
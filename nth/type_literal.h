@@ -17,7 +17,8 @@ namespace nth {
 // Represents a type reference or definition in the AST
 class TypeLiteral : public ASTNode {
 public:
-  TypeLiteral(Identifier *name) : name(name) {}
+  TypeLiteral(Kind kind, Identifier *name) : ASTNode(kind), name(name) {}
+  virtual ~TypeLiteral();
 
   Identifier *getName() { return name; }
 
@@ -37,17 +38,17 @@ public:
   virtual void accept(Visitor &v)=0;
 
 protected:
-  TypeRef(Identifier *name) : TypeLiteral(name) {}
+  TypeRef(Kind kind, Identifier *name) : TypeLiteral(kind, name) {}
 };
 
 class TypeDef : public TypeLiteral {
 protected:
-  TypeDef(Identifier *name) : TypeLiteral(name) {}
+  TypeDef(Kind kind, Identifier *name) : TypeLiteral(kind, name) {}
 };
 
 class SimpleTypeRef : public TypeRef {
 public:
-  SimpleTypeRef(Identifier *name) : TypeRef(name) {}
+  SimpleTypeRef(Identifier *name) : TypeRef(Kind::SimpleTypeRef, name) {}
 
   void accept(Visitor &v) { v.visit(this); }
 
@@ -56,7 +57,7 @@ public:
 
 class SimpleTypeDef : public TypeDef {
 public:
-  SimpleTypeDef(Identifier *name) : TypeDef(name) {}
+  SimpleTypeDef(Identifier *name) : TypeDef(Kind::SimpleTypeDef, name) {}
 
   void accept(Visitor &v) { v.visit(this); }
 
@@ -65,11 +66,9 @@ public:
 
 class TemplatedTypeRef : public TypeRef {
 public:
-  TemplatedTypeRef(Identifier *name, TypeRefList &subtypes)
-  : TypeRef(name), subtypes(subtypes) {}
-
   TemplatedTypeRef(Identifier *name, TypeRefList &&subtypes)
-  : TypeRef(name), subtypes(subtypes) {}
+  : TypeRef(Kind::TemplatedTypeRef, name), subtypes(std::move(subtypes)) {}
+  virtual ~TemplatedTypeRef();
 
   void accept(Visitor &v) { v.visit(this); }
 
@@ -83,11 +82,9 @@ protected:
 // Foo, A, and B are all being defined here
 class TemplatedTypeDef : public TypeDef {
 public:
-  TemplatedTypeDef(Identifier *name, TypeDefList &subtypes)
-  : TypeDef(name), subtypes(subtypes) {}
-
   TemplatedTypeDef(Identifier *name, TypeDefList &&subtypes)
-  : TypeDef(name), subtypes(subtypes) {}
+  : TypeDef(Kind::TemplatedTypeDef, name), subtypes(std::move(subtypes)) {}
+  virtual ~TemplatedTypeDef();
 
   void accept(Visitor &v) { v.visit(this); }
 
@@ -103,22 +100,23 @@ protected:
 
 class TupleTypeRef : public TemplatedTypeRef {
 public:
-  TupleTypeRef(TypeRefList &subtypes)
+  TupleTypeRef(TypeRefList &&subtypes)
   : TemplatedTypeRef(
                      Identifier::forTemplatedType("Tuple", subtypes.size()),
-                     subtypes
+                     std::move(subtypes)
                      ) {}
 };
 
 class FunctionTypeRef : public TemplatedTypeRef {
 public:
-  FunctionTypeRef(TypeRefList &argTypes, TypeRef *returnType)
+  // The return type follows the argument types among the subtypes
+  FunctionTypeRef(TypeRefList &&argTypes, TypeRef *returnType)
   : TemplatedTypeRef(
                      Identifier::forTemplatedType("Function", argTypes.size()),
-                     FunctionTypeRef::concat_ctr_args(argTypes, returnType)
-                     ) {}
-  
-  static TypeRefList concat_ctr_args(TypeRefList argList, TypeRef *returnType);
+                     std::move(argTypes)
+                     ) {
+    subtypes.push_back(returnType);
+  }
 };
 
 }
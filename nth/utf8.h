@@ -0,0 +1,75 @@
+//
+//  utf8.h
+//  nth
+//
+
+#ifndef __nth__utf8__
+#define __nth__utf8__
+
+#include <cstddef>
+#include <cstdint>
+
+namespace nth {
+
+// Source is UTF-8. Identifiers are ASCII letters, digits and underscores
+// as before, or any characters with the Unicode XID_Start and XID_Continue
+// properties; other non-ASCII characters are only allowed in strings and
+// comments. A byte that isn't part of a well-formed sequence is reported
+// wherever it turns up, one byte at a time, by both scanners.
+
+// Length of the well-formed UTF-8 sequence at p, storing the character it
+// encodes in c, or 0 if the bytes at p don't begin one. Overlong forms,
+// surrogates and anything past U+10FFFF are malformed.
+inline size_t decodeUtf8(const char *p, const char *end, uint32_t &c) {
+  unsigned char lead = *p;
+  if (lead < 0x80) {
+    c = lead;
+    return 1;
+  }
+
+  size_t length;
+  uint32_t least;
+  if (lead < 0xc2) {
+    return 0;
+  } else if (lead < 0xe0) {
+    length = 2;
+    least = 0x80;
+    c = lead & 0x1f;
+  } else if (lead < 0xf0) {
+    length = 3;
+    least = 0x800;
+    c = lead & 0x0f;
+  } else if (lead < 0xf5) {
+    length = 4;
+    least = 0x10000;
+    c = lead & 0x07;
+  } else {
+    return 0;
+  }
+
+  if (end - p < static_cast<ptrdiff_t>(length)) return 0;
+  for (size_t i = 1; i < length; ++i) {
+    unsigned char next = p[i];
+    if ((next & 0xc0) != 0x80) return 0;
+    c = c << 6 | (next & 0x3f);
+  }
+  if (c < least || c > 0x10ffff || (c >= 0xd800 && c <= 0xdfff)) return 0;
+  return length;
+}
+
+// First byte in [begin, end) that doesn't begin a well-formed sequence,
+// decoding from begin, or end if there is none. Runs a vector at a time
+// where the target supports SSE2 or AVX2.
+const char *findInvalidUtf8(const char *begin, const char *end);
+
+// Whether a non-ASCII character may begin or continue an identifier
+bool isIdentifierStart(uint32_t c);
+bool isIdentifierContinue(uint32_t c);
+
+// Length of the identifier at the start of well-formed [begin, end), or 0
+// if what's there can't begin one
+size_t identifierLength(const char *begin, const char *end);
+
+}
+
+#endif /* defined(__nth__utf8__) */